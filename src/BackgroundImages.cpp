@@ -0,0 +1,143 @@
+#include "BackgroundImages.h"
+
+#if __has_include("BinaryData.h")
+ #include "BinaryData.h"
+ #define METROG_HAVE_BINDATA 1
+#else
+ #define METROG_HAVE_BINDATA 0
+#endif
+
+#if __has_include("MetroAssets.h")
+ #include "MetroAssets.h"
+ #define METROG_HAVE_METROASSETS 1
+#else
+ #define METROG_HAVE_METROASSETS 0
+#endif
+
+// Decodes the two background images, trying embedded BinaryData, our MetroAssets fallback, then disk
+static void decodeBackgroundImages (juce::Image& bgA, juce::Image& bgB)
+{
+    // Try embedded BinaryData first for reliable asset access inside DAWs
+#if METROG_HAVE_BINDATA
+    // Try direct symbol names generated by juce_add_binary_data
+    if (! bgA.isValid())
+    {
+        #if defined(BinaryData_metrognome_a_png)
+        if (BinaryData::metrognome_a_pngSize > 0)
+            bgA = juce::ImageFileFormat::loadFrom(BinaryData::metrognome_a_png, BinaryData::metrognome_a_pngSize);
+        #else
+        // Also try via getNamedResource in case symbol names differ
+        int sz = 0;
+        if (auto* d = BinaryData::getNamedResource("metrognome-a_png", sz))
+            bgA = juce::ImageFileFormat::loadFrom(d, (size_t)sz);
+        if (! bgA.isValid())
+            if (auto* d2 = BinaryData::getNamedResource("metrognome_a_png", sz))
+                bgA = juce::ImageFileFormat::loadFrom(d2, (size_t)sz);
+        #endif
+    }
+    if (! bgB.isValid())
+    {
+        #if defined(BinaryData_metrognome_b_png)
+        if (BinaryData::metrognome_b_pngSize > 0)
+            bgB = juce::ImageFileFormat::loadFrom(BinaryData::metrognome_b_png, BinaryData::metrognome_b_pngSize);
+        #else
+        int sz = 0;
+        if (auto* d = BinaryData::getNamedResource("metrognome-b_png", sz))
+            bgB = juce::ImageFileFormat::loadFrom(d, (size_t)sz);
+        if (! bgB.isValid())
+            if (auto* d2 = BinaryData::getNamedResource("metrognome_b_png", sz))
+                bgB = juce::ImageFileFormat::loadFrom(d2, (size_t)sz);
+        #endif
+    }
+#endif
+
+#if METROG_HAVE_METROASSETS
+    // Our in-repo fallback embedded resources (namespace MetroAssets)
+    if (! bgA.isValid())
+    {
+        if (MetroAssets::metrognomea_pngSize > 0)
+            bgA = juce::ImageFileFormat::loadFrom(MetroAssets::metrognomea_png, MetroAssets::metrognomea_pngSize);
+        if (! bgA.isValid())
+        {
+            int sz = 0;
+            if (auto* d = MetroAssets::getNamedResource("metrognome-a_png", sz))
+                bgA = juce::ImageFileFormat::loadFrom(d, (size_t)sz);
+            if (! bgA.isValid())
+                if (auto* d2 = MetroAssets::getNamedResource("metrognome_a_png", sz))
+                    bgA = juce::ImageFileFormat::loadFrom(d2, (size_t)sz);
+            if (! bgA.isValid())
+                if (auto* d3 = MetroAssets::getNamedResource("metrognomea_png", sz))
+                    bgA = juce::ImageFileFormat::loadFrom(d3, (size_t)sz);
+        }
+    }
+    if (! bgB.isValid())
+    {
+        if (MetroAssets::metrognomeb_pngSize > 0)
+            bgB = juce::ImageFileFormat::loadFrom(MetroAssets::metrognomeb_png, MetroAssets::metrognomeb_pngSize);
+        if (! bgB.isValid())
+        {
+            int sz = 0;
+            if (auto* d = MetroAssets::getNamedResource("metrognome-b_png", sz))
+                bgB = juce::ImageFileFormat::loadFrom(d, (size_t)sz);
+            if (! bgB.isValid())
+                if (auto* d2 = MetroAssets::getNamedResource("metrognome_b_png", sz))
+                    bgB = juce::ImageFileFormat::loadFrom(d2, (size_t)sz);
+            if (! bgB.isValid())
+                if (auto* d3 = MetroAssets::getNamedResource("metrognomeb_png", sz))
+                    bgB = juce::ImageFileFormat::loadFrom(d3, (size_t)sz);
+        }
+    }
+#endif
+
+    // Fallback to disk paths (useful during development and standalone helper)
+    auto assetsDir = juce::File::getSpecialLocation(juce::File::currentApplicationFile).getSiblingFile("assets").getChildFile("images");
+    juce::File projDir = juce::File::getCurrentWorkingDirectory();
+    juce::File altDir = projDir.getChildFile("assets").getChildFile("images");
+
+    auto loadIfExists = [] (const juce::File& f) -> juce::Image
+    {
+        if (f.existsAsFile())
+            return juce::ImageFileFormat::loadFrom(f);
+        return {};
+    };
+
+    if (! bgA.isValid())
+    {
+        bgA = loadIfExists(assetsDir.getChildFile("metrognome-a.png"));
+        if (! bgA.isValid()) bgA = loadIfExists(altDir.getChildFile("metrognome-a.png"));
+    }
+    if (! bgB.isValid())
+    {
+        bgB = loadIfExists(assetsDir.getChildFile("metrognome-b.png"));
+        if (! bgB.isValid()) bgB = loadIfExists(altDir.getChildFile("metrognome-b.png"));
+    }
+}
+
+//==============================================================================
+BackgroundImageCache::BackgroundImageCache()
+    : juce::Thread ("MetroGnome image decode")
+{
+    startThread (juce::Thread::Priority::low);
+}
+
+BackgroundImageCache::~BackgroundImageCache()
+{
+    stopThread (5000);
+}
+
+void BackgroundImageCache::run()
+{
+    decodeBackgroundImages (imageA, imageB);
+    loaded.store (true, std::memory_order_release);
+    sendChangeMessage(); // delivered asynchronously on the message thread
+}
+
+juce::Image BackgroundImageCache::getImageA() const
+{
+    return isLoaded() ? imageA : juce::Image();
+}
+
+juce::Image BackgroundImageCache::getImageB() const
+{
+    return isLoaded() ? imageB : juce::Image();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+
+// Process-wide cache of the editor background images, shared through juce::SharedResourcePointer so every
+// plugin instance and editor uses one decoded copy. Decoding runs once on a background thread; listeners
+// get a change message (on the message thread) when the images are ready.
+class BackgroundImageCache : public juce::ChangeBroadcaster,
+                             private juce::Thread
+{
+public:
+    BackgroundImageCache();
+    ~BackgroundImageCache() override;
+
+    bool isLoaded() const noexcept { return loaded.load (std::memory_order_acquire); }
+
+    // Invalid until isLoaded(); afterwards the (possibly invalid, if no asset was found) decoded images
+    juce::Image getImageA() const;
+    juce::Image getImageB() const;
+
+private:
+    void run() override;
+
+    // Written by the decode thread before `loaded` is set, read-only afterwards
+    juce::Image imageA, imageB;
+    std::atomic<bool> loaded { false };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BackgroundImageCache)
+};
@@ -0,0 +1,152 @@
+#include "ClickExport.h"
+#include "PluginProcessor.h"
+#include "OfflineTransport.h"
+
+static constexpr const char* kParamTimeSigNum = "timeSigNum";
+
+// Samples the writer thread can fall behind by (per channel); when full the render waits for it
+static constexpr int kWriterFifoSamples = 1 << 16;
+
+namespace metrog
+{
+    static int pluginNumerator (MetroGnomeAudioProcessor& renderer)
+    {
+        const auto* value = renderer.getAPVTS().getRawParameterValue(kParamTimeSigNum);
+        return juce::jlimit(1, 16, value != nullptr ? (int)value->load() : 4);
+    }
+
+    juce::int64 getClickTrackLength (MetroGnomeAudioProcessor& renderer, const ClickExportSettings& settings)
+    {
+        const double seconds = settings.tempoMap != nullptr
+            ? settings.tempoMap->secondsAtPpq(settings.tempoMap->ppqAtBar((double)settings.bars))
+            : (double)settings.bars * pluginNumerator(renderer) * 60.0 / settings.tempoBPM;
+        return (juce::int64)std::llround(seconds * settings.sampleRate);
+    }
+
+    juce::Result renderClickTrack (MetroGnomeAudioProcessor& renderer, const ClickExportSettings& settings,
+                                   std::atomic<float>* progress, const std::atomic<bool>* shouldCancel)
+    {
+        const auto& file = settings.file;
+        std::unique_ptr<juce::AudioFormat> format;
+        if (file.hasFileExtension("wav"))
+            format = std::make_unique<juce::WavAudioFormat>();
+        else if (file.hasFileExtension("flac"))
+            format = std::make_unique<juce::FlacAudioFormat>();
+        else
+            return juce::Result::fail("Unsupported file type (use .wav or .flac): " + file.getFileName());
+
+        if (settings.bars <= 0 || settings.tempoBPM <= 0.0 || settings.sampleRate <= 0.0 || settings.blockSize <= 0)
+            return juce::Result::fail("Invalid export settings");
+        if (! renderer.isOffline())
+            return juce::Result::fail("Click tracks render on an offline processor");
+
+        const int numChannels = juce::jmax(1, renderer.getMainBusNumOutputChannels());
+        const auto totalSamples = getClickTrackLength(renderer, settings);
+
+        // FileOutputStream appends to an existing file, so start from nothing
+        if (file.exists() && ! file.deleteFile())
+            return juce::Result::fail("Cannot overwrite " + file.getFullPathName());
+        auto stream = std::make_unique<juce::FileOutputStream>(file);
+        if (! stream->openedOk())
+            return juce::Result::fail("Cannot write " + file.getFullPathName() + ": " + stream->getStatus().getErrorMessage());
+        std::unique_ptr<juce::AudioFormatWriter> writer (format->createWriterFor(stream.get(), settings.sampleRate, (unsigned int)numChannels,
+                                                                                 settings.bitsPerSample, {}, 0));
+        if (writer == nullptr)
+        {
+            stream.reset();
+            file.deleteFile();
+            return juce::Result::fail(format->getFormatName() + " cannot be written at " + juce::String(settings.sampleRate)
+                                      + " Hz, " + juce::String(settings.bitsPerSample) + " bit");
+        }
+        stream.release(); // owned by the writer now
+
+        // Play starts a little before bar 1: the lookahead plus one sample. A start exactly on a bar line
+        // skips that boundary (the sequencer's start rule), so the rule spends itself on the pre-roll's
+        // first sample and the bar-1 downbeat sounds at sample 0. The pre-roll is rendered, not written.
+        const auto* map = settings.tempoMap.get();
+        const double startBpm = map != nullptr ? map->bpmAtPpq(0.0) : settings.tempoBPM;
+        const int preRollSamples = renderer.getLookaheadSamples(settings.sampleRate) + 1;
+        OfflineTransport transport;
+        transport.setSampleRate(settings.sampleRate);
+        transport.setTempo(startBpm);
+        transport.setTimeSigNumerator(map != nullptr ? map->meterAtPpq(0.0).numerator : pluginNumerator(renderer));
+        transport.setTimeSigDenominator(map != nullptr ? map->meterAtPpq(0.0).denominator : 4);
+        transport.setPpqPosition(-(double)preRollSamples * startBpm / 60.0 / settings.sampleRate);
+        transport.setPlaying(true);
+        renderer.setNonRealtime(true);
+        renderer.setPlayHead(&transport);
+        renderer.setRateAndBufferSizeDetails(settings.sampleRate, settings.blockSize);
+        renderer.prepareToPlay(settings.sampleRate, settings.blockSize);
+
+        juce::AudioBuffer<float> buffer (renderer.getTotalNumOutputChannels(), settings.blockSize);
+        juce::MidiBuffer midi;
+        for (int done = 0; done < preRollSamples;)
+        {
+            const int n = done == 0 ? 1 : juce::jmin(settings.blockSize, preRollSamples - done);
+            buffer.setSize(buffer.getNumChannels(), n, false, false, true);
+            renderer.processBlock(buffer, midi);
+            transport.advance(n);
+            done += n;
+        }
+        // Bar 1 exactly, and from here the map (if any) drives the transport
+        transport.setPpqPosition(0.0);
+        transport.setTempoMap(map);
+
+        bool cancelled = false;
+        {
+            juce::TimeSliceThread writerThread ("MetroGnome export writer");
+            writerThread.startThread();
+            juce::AudioFormatWriter::ThreadedWriter threadedWriter (writer.release(), writerThread, kWriterFifoSamples);
+
+            for (juce::int64 done = 0; done < totalSamples && ! cancelled;)
+            {
+                const int n = (int)juce::jmin<juce::int64>(transport.nextBlockSamples(settings.blockSize), totalSamples - done);
+                buffer.setSize(buffer.getNumChannels(), n, false, false, true);
+                renderer.processBlock(buffer, midi);
+                transport.advance(n);
+
+                // The main bus comes first in the buffer; wait while the writer catches up
+                while (! threadedWriter.write(buffer.getArrayOfReadPointers(), n))
+                {
+                    if (shouldCancel != nullptr && shouldCancel->load(std::memory_order_relaxed))
+                        break;
+                    juce::Thread::sleep(1);
+                }
+
+                done += n;
+                cancelled = shouldCancel != nullptr && shouldCancel->load(std::memory_order_relaxed);
+                if (progress != nullptr)
+                    progress->store((float)((double)done / (double)totalSamples), std::memory_order_relaxed);
+            }
+            // The ThreadedWriter flushes what's queued and closes the file before the thread stops
+        }
+        renderer.releaseResources();
+        renderer.setPlayHead(nullptr);
+
+        if (cancelled)
+        {
+            file.deleteFile();
+            return juce::Result::fail("Export cancelled");
+        }
+        return juce::Result::ok();
+    }
+
+    ClickExportJob::ClickExportJob (const juce::MemoryBlock& state, const ClickExportSettings& s)
+        : juce::Thread ("MetroGnome export"), renderer (std::make_unique<MetroGnomeAudioProcessor>(MetroGnomeAudioProcessor::Mode::offline)), settings (s)
+    {
+        renderer->setStateInformation(state.getData(), (int)state.getSize());
+        startThread();
+    }
+
+    ClickExportJob::~ClickExportJob()
+    {
+        cancel.store(true, std::memory_order_relaxed);
+        stopThread(10000);
+    }
+
+    void ClickExportJob::run()
+    {
+        result = renderClickTrack(*renderer, settings, &progress, &cancel);
+        finished.store(true, std::memory_order_release);
+    }
+}
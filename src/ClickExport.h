@@ -0,0 +1,66 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <memory>
+#include "TempoMap.h"
+
+class MetroGnomeAudioProcessor;
+
+namespace metrog
+{
+    struct ClickExportSettings
+    {
+        juce::File file;            // .wav or .flac, chosen by the extension
+        int bars = 16;
+        double tempoBPM = 120.0;
+        // Tempo and meter changes (e.g. read from a MIDI file); when set, tempoBPM is unused and bars follow
+        // the map's time signatures
+        std::shared_ptr<const TempoMap> tempoMap;
+        double sampleRate = 48000.0;
+        int bitsPerSample = 24;
+        int blockSize = 4096;       // render block; larger blocks render faster
+    };
+
+    // Renders a click track through renderer's processBlock from bar 1 (its downbeat at sample 0), at a
+    // fixed tempo or along the tempo map (main output only), as fast as the CPU allows.
+    // With a map, blocks split at tempo changes, so each change lands on its sample. The renderer must be an
+    // offline instance (MetroGnomeAudioProcessor::Mode::offline) that no other thread is using. Rendering runs on the calling thread; a ThreadedWriter encodes and
+    // writes on its own thread through a fixed FIFO, so memory stays bounded however long the track.
+    // progress (0..1) and shouldCancel may be null. A cancelled or failed render deletes the file.
+    juce::Result renderClickTrack (MetroGnomeAudioProcessor& renderer, const ClickExportSettings& settings,
+                                   std::atomic<float>* progress = nullptr, const std::atomic<bool>* shouldCancel = nullptr);
+
+    // Length in samples of the track renderClickTrack writes for these settings
+    juce::int64 getClickTrackLength (MetroGnomeAudioProcessor& renderer, const ClickExportSettings& settings);
+
+    // An export for the editor: a separate offline processor loaded with a copy of the plugin's state renders
+    // on a background thread, leaving the host's instance alone. Create, poll and destroy on the message
+    // thread; destroying a running job cancels it. The message thread creates the renderer and loads the
+    // state before the job's thread starts; from then until that thread has finished, the job's thread is
+    // the only one using it. The message thread destroys it after the thread has stopped.
+    class ClickExportJob : private juce::Thread
+    {
+    public:
+        ClickExportJob (const juce::MemoryBlock& state, const ClickExportSettings& settings);
+        ~ClickExportJob() override;
+
+        const ClickExportSettings& getSettings() const noexcept { return settings; }
+        float getProgress() const noexcept { return progress.load(std::memory_order_relaxed); }
+        bool isFinished() const noexcept { return finished.load(std::memory_order_acquire); }
+        // Outcome once isFinished()
+        const juce::Result& getResult() const noexcept { return result; }
+
+    private:
+        void run() override;
+
+        std::unique_ptr<MetroGnomeAudioProcessor> renderer;
+        const ClickExportSettings settings;
+        std::atomic<float> progress { 0.0f };
+        std::atomic<bool> cancel { false };
+        std::atomic<bool> finished { false };
+        juce::Result result { juce::Result::ok() };
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ClickExportJob)
+    };
+}
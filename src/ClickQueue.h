@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace metrog
+{
+    // A click waiting for its sample on the audio thread's running sample clock
+    struct ScheduledClick
+    {
+        int64_t due = 0;        // sample clock value at which the click starts
+        float level = 1.0f;
+        int16_t voice = 0;      // which voice plays it (lane index; 0 for the main sequencer)
+        bool accent = false;
+    };
+
+    // Clicks scheduled ahead of time, kept in due order in a fixed-capacity ring. Clicks usually arrive in
+    // time order, so a push just appends; an earlier one moves the later ones back a slot. Clicks with the
+    // same due sample keep their push order. A push into a full queue drops the click. Audio thread only.
+    template <int Capacity>
+    class ClickQueue
+    {
+        static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "ClickQueue capacity must be a power of two");
+
+    public:
+        bool push (const ScheduledClick& click) noexcept
+        {
+            if (count == Capacity)
+                return false;
+            int pos = count++;
+            for (; pos > 0 && at(pos - 1).due > click.due; --pos)
+                at(pos) = at(pos - 1);
+            at(pos) = click;
+            return true;
+        }
+
+        bool empty() const noexcept { return count == 0; }
+        int size() const noexcept { return count; }
+        const ScheduledClick& front() const noexcept { return items[(size_t)head]; }
+
+        void pop() noexcept
+        {
+            if (count == 0)
+                return;
+            head = (head + 1) & (Capacity - 1);
+            --count;
+        }
+
+        void clear() noexcept { head = count = 0; }
+
+        // Moves every click to the same time at another sample rate (ratio = new rate / old), counted
+        // from the clock value now. Due order is kept.
+        void rescale (int64_t now, double ratio) noexcept
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                auto& click = at(i);
+                click.due = now + std::llround((double)(click.due - now) * ratio);
+            }
+        }
+
+    private:
+        ScheduledClick& at (int i) noexcept { return items[(size_t)((head + i) & (Capacity - 1))]; }
+
+        std::array<ScheduledClick, Capacity> items{};
+        int head = 0, count = 0;
+    };
+}
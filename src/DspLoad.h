@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+namespace metrog
+{
+    // Monotonic timestamp used for audio-thread telemetry (vDSO/QPC-backed; no syscalls or locks)
+    inline uint64_t monotonicNanos() noexcept
+    {
+        using namespace std::chrono;
+        return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+    }
+
+    // One processBlock callback: when it started, how long it ran and how long it was allowed to run.
+    struct DspLoadSample
+    {
+        uint64_t startNs = 0;    // monotonicNanos() at callback entry
+        uint32_t elapsedNs = 0;  // callback duration
+        uint32_t budgetNs = 0;   // numSamples / sampleRate, i.e. the real-time deadline
+
+        float load() const noexcept { return budgetNs > 0 ? static_cast<float>(elapsedNs) / static_cast<float>(budgetNs) : 0.0f; }
+    };
+
+    // Consumer-side aggregation of DspLoadSamples (editor meter, soak tests). Not thread-safe; owned by the reader.
+    class DspLoadStats
+    {
+    public:
+        // Loads at or above this fraction of the budget count as xrun risk; above 1.0 the deadline was missed.
+        static constexpr float kRiskThreshold = 0.7f;
+        static constexpr uint64_t kPeakHoldNs = 1500000000ull; // 1.5 s
+
+        void add (const DspLoadSample& s) noexcept
+        {
+            const float l = s.load();
+            current = l;
+            average = (blocks == 0) ? l : average + 0.05f * (l - average);
+            maxLoad = std::max(maxLoad, l);
+            ++blocks;
+            if (l >= kRiskThreshold) { ++riskBlocks; lastRiskNs = s.startNs; }
+            if (l > 1.0f) ++overBudgetBlocks;
+
+            // Peak hold: latch the highest load, release to the current load once the hold time has passed
+            if (l >= peak || s.startNs - peakNs > kPeakHoldNs)
+            {
+                peak = l;
+                peakNs = s.startNs;
+            }
+            lastNs = s.startNs;
+        }
+
+        float getCurrentLoad() const noexcept { return current; }
+        float getAverageLoad() const noexcept { return average; }
+        float getPeakHoldLoad() const noexcept { return peak; }
+        float getMaxLoad() const noexcept { return maxLoad; }
+        uint64_t getBlockCount() const noexcept { return blocks; }
+        uint64_t getRiskBlockCount() const noexcept { return riskBlocks; }
+        uint64_t getOverBudgetCount() const noexcept { return overBudgetBlocks; }
+
+        // True if a block reached the risk threshold within the peak-hold window of the latest sample
+        bool hasRecentXrunRisk() const noexcept { return riskBlocks > 0 && lastNs - lastRiskNs <= kPeakHoldNs; }
+
+        void reset() noexcept { *this = DspLoadStats{}; }
+
+    private:
+        float current = 0.0f, average = 0.0f, peak = 0.0f, maxLoad = 0.0f;
+        uint64_t peakNs = 0, lastNs = 0, lastRiskNs = 0;
+        uint64_t blocks = 0, riskBlocks = 0, overBudgetBlocks = 0;
+    };
+}
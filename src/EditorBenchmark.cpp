@@ -0,0 +1,143 @@
+// Headless editor paint benchmark: builds MetroGnomeAudioProcessorEditor without a window and renders
+// frames into a software image with paintEntireComponent, sweeping step count, dance mode, editor size
+// and display scale while the processor plays. Every frame repaints the whole editor (there is no peer
+// to collect dirty regions), so the numbers are the worst case a frame can cost. Reports ms/frame and
+// heap allocations/frame (counted by RtInterposer.cpp). A measuring tool, not a test: not run by ctest.
+//
+//   MetroGnome_EditorBenchmark [--frames N]     (default 200 per configuration)
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include "PluginProcessor.h"
+#include "PluginEditor.h"
+#include "BackgroundImages.h"
+#include "OfflineTransport.h"
+#include "RtInterposer.h"
+
+namespace
+{
+    struct FrameStats
+    {
+        double firstFrameMs = 0.0;   // includes building the layer caches for this size/scale
+        double meanMs = 0.0;
+        double p99Ms = 0.0;
+        double allocationsPerFrame = 0.0;
+    };
+
+    int frameCount (int argc, char** argv)
+    {
+        for (int i = 1; i + 1 < argc; ++i)
+            if (juce::String(argv[i]) == "--frames")
+                return juce::jmax(1, juce::String(argv[i + 1]).getIntValue());
+        return 200;
+    }
+
+    void setParam (MetroGnomeAudioProcessor& proc, const char* id, float value)
+    {
+        if (auto* p = proc.getAPVTS().getParameter(id))
+            p->setValueNotifyingHost(p->convertTo0to1(value));
+    }
+
+    double millisecondsSince (juce::int64 startTicks)
+    {
+        return juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks) * 1000.0;
+    }
+}
+
+static int runBenchmark (int frames)
+{
+    const juce::ScopedJuceInitialiser_GUI juceInit;
+
+    // Wait for the shared background decode so every configuration paints the real images
+    juce::SharedResourcePointer<BackgroundImageCache> images;
+    while (! images->isLoaded())
+        juce::Thread::sleep(1);
+
+    constexpr double sampleRate = 48000.0;
+    constexpr int blockSize = 800; // one 60 Hz frame of audio per rendered frame
+
+    MetroGnomeAudioProcessor proc;
+    metrog::OfflineTransport transport;
+    transport.setSampleRate(sampleRate);
+    transport.setTempo(120.0);
+    transport.setPlaying(true);
+    proc.setPlayHead(&transport);
+    proc.setRateAndBufferSizeDetails(sampleRate, blockSize);
+    proc.prepareToPlay(sampleRate, blockSize);
+
+    juce::AudioBuffer<float> buffer (2, blockSize);
+    juce::MidiBuffer midi;
+
+    MetroGnomeAudioProcessorEditor editor (proc);
+    const int designW = editor.getWidth(), designH = editor.getHeight();
+
+    std::printf("%-6s %-6s %-5s %-6s %10s %10s %10s %13s\n",
+                "steps", "dance", "size", "scale", "first ms", "mean ms", "p99 ms", "allocs/frame");
+
+    const int stepCounts[] = { 4, 8, 16, 128 };
+    const float editorSizes[] = { 1.0f, 1.5f };
+    const float displayScales[] = { 1.0f, 2.0f };
+    std::vector<double> frameMs ((size_t)frames);
+
+    for (int steps : stepCounts)
+    for (bool dance : { false, true })
+    for (float size : editorSizes)
+    for (float displayScale : displayScales)
+    {
+        setParam(proc, "stepCount", (float)steps);
+        setParam(proc, "danceMode", dance ? 1.0f : 0.0f);
+        editor.setSize(juce::roundToInt((float)designW * size), juce::roundToInt((float)designH * size));
+
+        // Physical-pixel target, as a HiDPI peer would provide it
+        juce::Image target (juce::Image::ARGB,
+                            juce::roundToInt((float)editor.getWidth() * displayScale),
+                            juce::roundToInt((float)editor.getHeight() * displayScale),
+                            true, juce::SoftwareImageType());
+
+        auto renderFrame = [&]
+        {
+            midi.clear();
+            proc.processBlock(buffer, midi);
+            transport.advance(blockSize);
+            editor.refreshFrame();
+
+            juce::Graphics g (target);
+            g.addTransform(juce::AffineTransform::scale(displayScale));
+            editor.paintEntireComponent(g, true);
+        };
+
+        FrameStats stats;
+        auto start = juce::Time::getHighResolutionTicks();
+        renderFrame();
+        stats.firstFrameMs = millisecondsSince(start);
+
+        metrog::rt::resetInterposerStats();
+        for (int f = 0; f < frames; ++f)
+        {
+            start = juce::Time::getHighResolutionTicks();
+            renderFrame();
+            frameMs[(size_t)f] = millisecondsSince(start);
+        }
+        stats.allocationsPerFrame = (double)metrog::rt::getInterposerStats().allocations / (double)frames;
+
+        double total = 0.0;
+        for (double ms : frameMs)
+            total += ms;
+        stats.meanMs = total / (double)frames;
+        std::sort(frameMs.begin(), frameMs.end());
+        stats.p99Ms = frameMs[(size_t)((double)(frames - 1) * 0.99)];
+
+        std::printf("%-6d %-6s %-5.1f %-6.1f %10.3f %10.3f %10.3f %13.1f\n",
+                    steps, dance ? "on" : "off", (double)size, (double)displayScale,
+                    stats.firstFrameMs, stats.meanMs, stats.p99Ms, stats.allocationsPerFrame);
+    }
+
+    proc.releaseResources();
+    return 0;
+}
+
+int main (int argc, char** argv)
+{
+    return runBenchmark(frameCount(argc, argv));
+}
@@ -0,0 +1,139 @@
+// Click track export from the command line: renders a pattern through MetroGnomeAudioProcessor's
+// processBlock (metrog::renderClickTrack, the same path as the editor's export) to a WAV or FLAC file,
+// then reads the file back and checks its length and that it holds clicks. Prints the render speed.
+//
+//   MetroGnome_Export --out <file.wav|file.flac> [--bars N] [--bpm X] [--rate HZ] [--bits N] [--block N]
+//                     [--state <file>] [--numerator N] [--steps N] [--tempo-map <file.mid>] [--check-downbeat]
+//
+// --state loads a plugin state saved with getStateInformation (steps, velocities, lanes, timing feel...);
+// --numerator and --steps override what it sets. --tempo-map takes tempo and time signature changes from a
+// Standard MIDI File instead of --bpm. --check-downbeat also fails unless the first click starts at sample 0
+// (bar 1's downbeat; needs step 1 on and no early timing feel). Defaults: 16 bars, 120 BPM, 48 kHz, 24 bit.
+#include <JuceHeader.h>
+#include <fstream>
+#include <iostream>
+#include "PluginProcessor.h"
+#include "ClickExport.h"
+
+namespace
+{
+    juce::String argValue (int argc, char** argv, const char* name, const juce::String& fallback = {})
+    {
+        for (int i = 1; i + 1 < argc; ++i)
+            if (juce::String(argv[i]) == name)
+                return argv[i + 1];
+        return fallback;
+    }
+
+    void setParam (MetroGnomeAudioProcessor& proc, const char* id, float value)
+    {
+        if (auto* p = proc.getAPVTS().getParameter(id))
+            p->setValueNotifyingHost(p->convertTo0to1(value));
+    }
+}
+
+static int runExport (int argc, char** argv)
+{
+    const juce::ScopedJuceInitialiser_GUI juceInit;
+
+    metrog::ClickExportSettings settings;
+    const auto out = argValue(argc, argv, "--out");
+    if (out.isEmpty())
+    {
+        std::cerr << "usage: MetroGnome_Export --out <file.wav|file.flac> [--bars N] [--bpm X] [--rate HZ] [--bits N] "
+                     "[--block N] [--state <file>] [--numerator N] [--steps N] [--tempo-map <file.mid>] [--check-downbeat]\n";
+        return 2;
+    }
+    settings.file = juce::File::getCurrentWorkingDirectory().getChildFile(out);
+    settings.bars = argValue(argc, argv, "--bars", "16").getIntValue();
+    settings.tempoBPM = argValue(argc, argv, "--bpm", "120").getDoubleValue();
+    settings.sampleRate = argValue(argc, argv, "--rate", "48000").getDoubleValue();
+    settings.bitsPerSample = argValue(argc, argv, "--bits", "24").getIntValue();
+    settings.blockSize = argValue(argc, argv, "--block", "4096").getIntValue();
+
+    const auto tempoMapPath = argValue(argc, argv, "--tempo-map");
+    if (tempoMapPath.isNotEmpty())
+    {
+        const auto midiFile = juce::File::getCurrentWorkingDirectory().getChildFile(tempoMapPath);
+        std::ifstream in (midiFile.getFullPathName().toStdString(), std::ios::binary);
+        auto map = std::make_shared<metrog::TempoMap>();
+        std::string error;
+        if (! in || ! metrog::SmfTempoMapReader::read(in, *map, error))
+        {
+            std::cerr << "Cannot read a tempo map from " << tempoMapPath << (error.empty() ? "" : ": " + error) << "\n";
+            return 1;
+        }
+        std::cout << "Tempo map: " << map->getTempoPoints().size() << " tempos, " << map->getMeterPoints().size() << " time signatures\n";
+        settings.tempoMap = map;
+    }
+
+    MetroGnomeAudioProcessor proc (MetroGnomeAudioProcessor::Mode::offline);
+    const auto statePath = argValue(argc, argv, "--state");
+    if (statePath.isNotEmpty())
+    {
+        juce::MemoryBlock state;
+        if (! juce::File::getCurrentWorkingDirectory().getChildFile(statePath).loadFileAsData(state))
+        {
+            std::cerr << "Cannot read state file " << statePath << "\n";
+            return 1;
+        }
+        proc.setStateInformation(state.getData(), (int)state.getSize());
+    }
+    if (const auto numerator = argValue(argc, argv, "--numerator"); numerator.isNotEmpty())
+        setParam(proc, "timeSigNum", (float)numerator.getIntValue());
+    if (const auto steps = argValue(argc, argv, "--steps"); steps.isNotEmpty())
+        setParam(proc, "stepCount", (float)steps.getIntValue());
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    const auto result = metrog::renderClickTrack(proc, settings);
+    const double elapsed = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+    if (result.failed())
+    {
+        std::cerr << "Export failed: " << result.getErrorMessage() << "\n";
+        return 1;
+    }
+
+    // Read it back: the expected number of samples, and not silence
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+    std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor(settings.file));
+    if (reader == nullptr)
+    {
+        std::cerr << "Cannot read back " << settings.file.getFullPathName() << "\n";
+        return 1;
+    }
+    const auto expectedSamples = metrog::getClickTrackLength(proc, settings);
+    const double seconds = (double)expectedSamples / settings.sampleRate;
+    juce::Range<float> levels[1];
+    reader->readMaxLevels(0, reader->lengthInSamples, levels, 1);
+    const float peak = juce::jmax(std::abs(levels[0].getStart()), std::abs(levels[0].getEnd()));
+
+    std::cout << settings.file.getFullPathName() << ": " << reader->lengthInSamples << " samples, " << reader->numChannels
+              << " ch, " << reader->bitsPerSample << " bit, peak " << peak << "\n"
+              << "Rendered " << seconds << " s of audio in " << elapsed << " s (" << seconds / juce::jmax(elapsed, 1.0e-9) << "x real time)\n";
+
+    int failures = 0;
+    if (reader->lengthInSamples != expectedSamples) { std::cerr << "length " << reader->lengthInSamples << ", expected " << expectedSamples << "\n"; ++failures; }
+    if (peak <= 0.0f) { std::cerr << "the file is silent\n"; ++failures; }
+
+    // A click starts with sin(0) = 0, so one that starts at sample 0 is first heard at sample 1
+    bool checkDownbeat = false;
+    for (int i = 1; i < argc; ++i)
+        checkDownbeat = checkDownbeat || juce::String(argv[i]) == "--check-downbeat";
+    if (checkDownbeat)
+    {
+        juce::AudioBuffer<float> start (1, 64);
+        reader->read(&start, 0, start.getNumSamples(), 0, true, false);
+        int firstSound = -1;
+        for (int i = 0; i < start.getNumSamples() && firstSound < 0; ++i)
+            if (start.getSample(0, i) != 0.0f)
+                firstSound = i;
+        if (firstSound != 1) { std::cerr << "the first click does not start at sample 0 (first sound at " << firstSound << ")\n"; ++failures; }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+int main (int argc, char** argv)
+{
+    return runExport(argc, argv);
+}
@@ -0,0 +1,1165 @@
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include "Sequencer.h"
+#include "LaneSequencer.h"
+
+// Golden-render regression suite: scripted transports and patterns are rendered through metrog::Sequencer
+// (the exact path processBlock runs) at several sample rates and block sizes, and each render is hashed.
+//
+//   MetroGnome_GoldenRenderTests [--golden <file>]            check against the checked-in hashes
+//   MetroGnome_GoldenRenderTests --update [--golden <file>]   re-record hashes for this platform
+//   MetroGnome_GoldenRenderTests --dump <dir>                 write <case>.f32 (interleaved stereo) and <case>.gates
+//   MetroGnome_GoldenRenderTests --diff <dirA> <dirB>         report the first divergent sample and nearest gate
+//
+// Gate hashes (sample position, step, bar of every click) are platform independent and checked everywhere.
+// Audio hashes depend on libm's sin() and FP contraction, so they are stored per platform and only checked
+// where one has been recorded.
+
+#ifndef METROG_GOLDEN_FILE
+ #define METROG_GOLDEN_FILE "testdata/golden_renders.txt"
+#endif
+
+using namespace metrog;
+
+namespace
+{
+    constexpr int kNumChannels = 2;
+    constexpr float kVolume = 0.8f;
+
+    const char* platformTag()
+    {
+       #if defined (_WIN32)
+        #define METROG_OS "windows"
+       #elif defined (__APPLE__)
+        #define METROG_OS "macos"
+       #elif defined (__linux__)
+        #define METROG_OS "linux"
+       #else
+        #define METROG_OS "unknown"
+       #endif
+       #if defined (__x86_64__) || defined (_M_X64)
+        #define METROG_ARCH "x86_64"
+       #elif defined (__aarch64__) || defined (_M_ARM64)
+        #define METROG_ARCH "arm64"
+       #else
+        #define METROG_ARCH "other"
+       #endif
+        return METROG_OS "-" METROG_ARCH;
+    }
+
+    // One transport segment; ppq advances continuously unless jumpToPpq is set (loop/locate)
+    struct Segment
+    {
+        double seconds = 1.0;
+        bool playing = true;
+        double bpm = 120.0;
+        double jumpToPpq = -1.0;
+    };
+
+    struct Transport
+    {
+        const char* name;
+        double startPpq;
+        std::vector<Segment> segments;
+    };
+
+    struct Pattern
+    {
+        const char* name;
+        int numerator;
+        int stepCount;
+        uint32_t stepMask;
+    };
+
+    struct Gate
+    {
+        int64_t sample;
+        int step;
+        int bar;
+    };
+
+    struct Render
+    {
+        uint64_t audioHash = 0;
+        uint64_t gateHash = 0;
+        std::vector<float> audio; // interleaved; only kept when dumping
+        std::vector<Gate> gates;
+    };
+
+    // FNV-1a 64
+    struct Fnv
+    {
+        uint64_t h = 1469598103934665603ull;
+        void add (const void* data, size_t n)
+        {
+            const auto* p = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < n; ++i) { h ^= p[i]; h *= 1099511628211ull; }
+        }
+        template <typename T> void addValue (T v) { add(&v, sizeof(v)); }
+    };
+
+    const std::vector<Transport>& transports()
+    {
+        static const std::vector<Transport> t {
+            { "playFromZero", 0.0,  { { 6.0, true, 120.0 } } },
+            { "midBarStart",  2.37, { { 5.0, true, 133.0 } } },
+            { "stopRestart",  0.0,  { { 2.0, true, 120.0 }, { 0.5, false, 120.0 }, { 3.0, true, 120.0 } } },
+            { "loopJump",     0.0,  { { 3.1, true, 140.0 }, { 3.0, true, 140.0, 4.0 } } },
+            { "tempoChange",  0.0,  { { 2.0, true, 120.0 }, { 2.0, true, 90.0 }, { 2.0, true, 200.0 } } }
+        };
+        return t;
+    }
+
+    const std::vector<Pattern>& patterns()
+    {
+        static const std::vector<Pattern> p {
+            { "n4s8",  4, 8,  0x00ffu },
+            { "n3s5",  3, 5,  0x0016u },
+            { "n7s16", 7, 16, 0xa5a5u }
+        };
+        return p;
+    }
+
+    const double kSampleRates[] = { 44100.0, 48000.0, 96000.0 };
+    const int kBlockSizes[] = { 64, 333, 1024 };
+
+    struct Case
+    {
+        std::string name;
+        const Transport* transport;
+        const Pattern* pattern;
+        double sampleRate;
+        int blockSize;
+    };
+
+    std::vector<Case> allCases()
+    {
+        std::vector<Case> cases;
+        for (const auto& t : transports())
+            for (const auto& p : patterns())
+                for (double sr : kSampleRates)
+                    for (int bs : kBlockSizes)
+                        cases.push_back({ std::string(t.name) + "_" + p.name + "_" + std::to_string((int) sr) + "_" + std::to_string(bs),
+                                          &t, &p, sr, bs });
+        return cases;
+    }
+
+    // Mirrors processBlock: playhead → applyHostPosition → advance → clear + render, block by block
+    Render render (const Case& c, bool keepAudio)
+    {
+        Render out;
+        Sequencer seq;
+        seq.prepare(c.sampleRate, c.blockSize);
+        seq.setSubdivisionsPerBar(c.pattern->numerator);
+
+        SequencerParams params;
+        params.stepCount = c.pattern->stepCount;
+        params.stepMask = StepMask::fromBits(c.pattern->stepMask);
+
+        HostTransportInfo host;
+        host.sampleRate = c.sampleRate;
+
+        std::vector<float> channelData((size_t) (kNumChannels * c.blockSize));
+        float* channels[kNumChannels] = { channelData.data(), channelData.data() + c.blockSize };
+
+        Fnv audioHash, gateHash;
+        double ppq = c.transport->startPpq;
+        int64_t samplePos = 0;
+
+        for (const auto& seg : c.transport->segments)
+        {
+            if (seg.jumpToPpq >= 0.0)
+                ppq = seg.jumpToPpq;
+
+            int64_t remaining = (int64_t) std::llround(seg.seconds * c.sampleRate);
+            while (remaining > 0)
+            {
+                const int n = (int) std::min<int64_t>(remaining, c.blockSize);
+
+                HostPosition pos;
+                pos.isPlaying = seg.playing;
+                pos.bpm = seg.bpm;
+                pos.timeSigNumerator = c.pattern->numerator;
+                pos.ppqPosition = ppq;
+                applyHostPosition(host, pos);
+
+                const auto& block = seq.advance(host, params, n);
+                std::fill(channelData.begin(), channelData.end(), 0.0f);
+                seq.render(channels, kNumChannels, n, kVolume);
+
+                if (block.gateSample >= 0)
+                {
+                    const Gate g { samplePos + block.gateSample, block.gateStepIndex, block.gateBarIndex };
+                    out.gates.push_back(g);
+                    gateHash.addValue(g.sample);
+                    gateHash.addValue(g.step);
+                    gateHash.addValue(g.bar);
+                }
+
+                for (int s = 0; s < n; ++s)
+                    for (int ch = 0; ch < kNumChannels; ++ch)
+                    {
+                        const float v = channels[ch][s];
+                        uint32_t bits;
+                        std::memcpy(&bits, &v, sizeof(bits));
+                        audioHash.addValue(bits);
+                        if (keepAudio)
+                            out.audio.push_back(v);
+                    }
+
+                if (seg.playing)
+                    ppq += (double) n * (seg.bpm / 60.0) / c.sampleRate;
+                samplePos += n;
+                remaining -= n;
+            }
+        }
+
+        out.audioHash = audioHash.h;
+        out.gateHash = gateHash.h;
+        return out;
+    }
+
+    std::string hex (uint64_t v)
+    {
+        std::ostringstream ss;
+        ss << std::hex;
+        ss.width(16);
+        ss.fill('0');
+        ss << v;
+        return ss.str();
+    }
+
+    // <case> <gateHash> [<platform>:<audioHash> ...]
+    struct GoldenEntry
+    {
+        std::string gateHash;
+        std::map<std::string, std::string> audioHashes;
+    };
+
+    bool loadGolden (const std::string& path, std::map<std::string, GoldenEntry>& entries)
+    {
+        std::ifstream in(path);
+        if (! in.is_open())
+            return false;
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            std::istringstream ls(line);
+            std::string name, token;
+            GoldenEntry e;
+            ls >> name >> e.gateHash;
+            while (ls >> token)
+            {
+                const auto colon = token.find(':');
+                if (colon != std::string::npos)
+                    e.audioHashes[token.substr(0, colon)] = token.substr(colon + 1);
+            }
+            entries[name] = e;
+        }
+        return true;
+    }
+
+    bool saveGolden (const std::string& path, const std::vector<Case>& cases, const std::map<std::string, GoldenEntry>& entries)
+    {
+        std::ofstream out(path, std::ios::out | std::ios::trunc);
+        if (! out.is_open())
+            return false;
+        out << "# Golden render hashes: <case> <gateHash> <platform>:<audioHash> ...\n"
+            << "# Regenerate with: MetroGnome_GoldenRenderTests --update (keeps other platforms' audio hashes)\n";
+        for (const auto& c : cases)
+        {
+            const auto it = entries.find(c.name);
+            if (it == entries.end())
+                continue;
+            out << c.name << ' ' << it->second.gateHash;
+            for (const auto& kv : it->second.audioHashes)
+                out << ' ' << kv.first << ':' << kv.second;
+            out << '\n';
+        }
+        return true;
+    }
+
+    // Idle short-circuit: stopped blocks are skipped only while they would reproduce the previous one
+    int checkIdleBlocks()
+    {
+        int failures = 0;
+        auto expect = [&failures] (bool ok, const char* what)
+        {
+            if (! ok) { std::cerr << "idle: " << what << "\n"; ++failures; }
+        };
+
+        Sequencer seq;
+        seq.prepare(48000.0, 256);
+        seq.setSubdivisionsPerBar(4);
+        SequencerParams params;
+        params.stepCount = 4;
+        HostTransportInfo host;
+        host.sampleRate = 48000.0;
+        host.ppqPosition = 1.0;
+
+        expect(! seq.advance(host, params, 256).idle, "first block after prepare was idle");
+        expect(seq.getCurrentStepIndex() == 1, "stopped playhead not shown");
+        expect(seq.isIdle(host, params.stepCount), "isIdle() did not foresee an idle block"); // the processor's early exit
+        expect(seq.advance(host, params, 256).idle, "unchanged stopped block not idle");
+
+        host.ppqPosition = 2.0; // scrub while stopped
+        expect(! seq.isIdle(host, params.stepCount) && ! seq.isIdle(host, params.stepCount + 1), "isIdle() missed a scrub");
+        expect(! seq.advance(host, params, 256).idle && seq.getCurrentStepIndex() == 2, "scrub while stopped ignored");
+        params.stepCount = 2;
+        expect(! seq.advance(host, params, 256).idle && seq.getCurrentStepIndex() == 0, "step count change while stopped ignored");
+
+        // Play into a click (gate 240 samples in), then stop: the tail still renders before going idle
+        std::vector<float> channelData(512);
+        float* channels[1] = { channelData.data() };
+        auto block = [&] (int n) { const bool idle = seq.advance(host, params, n).idle; seq.render(channels, 1, n, kVolume); return idle; };
+
+        host.isPlaying = true;
+        host.ppqPosition = 2.99;
+        block(512);
+        host.isPlaying = false;
+        host.ppqPosition = 3.2;
+        block(16);
+        expect(seq.isClickActive() && ! seq.isIdle(host, params.stepCount), "no click ringing after stop");
+        expect(! block(16), "idle while a click tail was ringing");
+        for (int i = 0; i < 100 && seq.isClickActive(); ++i)
+            block(16);
+        block(16);
+        expect(block(16), "not idle after the tail ended");
+        return failures;
+    }
+
+    // Patterns longer than one mask word: only the enabled steps past 64 gate, once per cycle
+    int checkLongPattern()
+    {
+        Sequencer seq;
+        seq.prepare(48000.0, 4096);
+        seq.setSubdivisionsPerBar(4);
+        SequencerParams params;
+        params.stepCount = StepMask::kMaxSteps;
+        params.stepMask = StepMask{};
+        params.stepMask.set(100, true);
+        params.stepMask.set(127, true);
+        HostTransportInfo host;
+        host.sampleRate = 48000.0;
+        host.isPlaying = true;
+
+        std::vector<int> gatedSteps;
+        const double ppqPerBlock = (host.tempoBPM / 60.0) * (4096.0 / host.sampleRate);
+        while (host.ppqPosition < (double)StepMask::kMaxSteps)
+        {
+            const auto& block = seq.advance(host, params, 4096);
+            if (block.gateSample >= 0)
+                gatedSteps.push_back(block.gateStepIndex);
+            host.ppqPosition += ppqPerBlock;
+        }
+
+        if (gatedSteps != std::vector<int> { 100, 127 })
+        {
+            std::cerr << "long pattern: gated " << gatedSteps.size() << " steps, expected steps 100 and 127\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    // Bar-quantized pattern switch: the queued pattern takes over exactly at the bar line, including its
+    // subdivisions, and the steps before it still play the old pattern
+    int checkBarSwitch()
+    {
+        Sequencer seq;
+        seq.prepare(48000.0, 512);
+        seq.setSubdivisionsPerBar(4);
+        SequencerParams params;
+        params.stepCount = 4;
+        metrog::Pattern next;
+        next.stepCount = 4;
+        next.stepMask = StepMask::fromBits(0x4u); // step 2 only
+        next.subdivisionsPerBar = 8;
+        params.atNextBar = &next;
+
+        HostTransportInfo host;
+        host.sampleRate = 48000.0;
+        host.isPlaying = true;
+        host.ppqPosition = 0.5;
+
+        std::vector<int> gatedSteps;
+        double switchPpq = -1.0;
+        const double ppqPerBlock = (host.tempoBPM / 60.0) * (512.0 / host.sampleRate);
+        while (host.ppqPosition < 5.2)
+        {
+            const auto& block = seq.advance(host, params, 512);
+            if (block.gateSample >= 0)
+                gatedSteps.push_back(block.gateStepIndex);
+            if (block.barSwitch)
+            {
+                // What the processor does: the queued pattern becomes the current one
+                switchPpq = host.ppqPosition;
+                params.stepCount = next.stepCount;
+                params.stepMask = next.stepMask;
+                params.atNextBar = nullptr;
+            }
+            host.ppqPosition += ppqPerBlock;
+        }
+
+        int failures = 0;
+        if (! (switchPpq < 4.0 && switchPpq + ppqPerBlock > 4.0)) { std::cerr << "bar switch: switched at ppq " << switchPpq << ", expected the block containing 4\n"; ++failures; }
+        if (gatedSteps != std::vector<int> { 1, 2, 3, 2 }) { std::cerr << "bar switch: wrong steps gated around the switch (" << gatedSteps.size() << " gates)\n"; ++failures; }
+        if (seq.getSubdivisionsPerBar() != 8) { std::cerr << "bar switch: subdivisions not switched\n"; ++failures; }
+        return failures;
+    }
+
+    // Polymetric lanes (3 and 5 against the bar): every boundary fires once at its first sample, events come
+    // out sorted, and the rendered audio does not depend on the block size
+    int checkLanes()
+    {
+        constexpr double sr = 48000.0, startPpq = 0.25, endPpq = 8.25;
+        LaneConfig config;
+        config.numLanes = 2;
+        config.lanes[0].subdivisionsPerBar = 3;
+        config.lanes[0].stepCount = 3;
+        config.lanes[1].subdivisionsPerBar = 5;
+        config.lanes[1].stepCount = 5;
+        config.lanes[1].stepMask = StepMask::fromBits(0x1u); // first of every 5
+        config.lanes[1].clickHz = 1500.0f;
+
+        struct Run { std::vector<std::pair<long, int>> events; std::vector<float> audio; };
+        auto run = [&] (int blockSize)
+        {
+            LaneSequencer lanes;
+            lanes.prepare(sr);
+            lanes.setConfig(config);
+            HostTransportInfo host;
+            host.sampleRate = sr;
+            host.isPlaying = true;
+            SequencerBlock main;
+            const double beatsPerSample = host.tempoBPM / 60.0 / sr;
+            const long total = (long)std::ceil((endPpq - startPpq) / beatsPerSample);
+
+            Run r;
+            r.audio.assign((size_t)total, 0.0f);
+            for (long pos = 0; pos < total; pos += blockSize)
+            {
+                const int n = (int)std::min<long>(blockSize, total - pos);
+                host.ppqPosition = startPpq + (double)pos * beatsPerSample;
+                main.playStateChanged = (pos == 0);
+                lanes.advance(host, main, n);
+
+                int lastSample = -1;
+                for (int e = 0; e < lanes.getNumEvents(); ++e)
+                {
+                    const auto& ev = lanes.getEvents()[e];
+                    if (ev.sample < lastSample)
+                        r.events.push_back({ -1, -1 }); // out of order
+                    lastSample = ev.sample;
+                    r.events.push_back({ pos + ev.sample, ev.lane });
+                }
+                float* channels[1] = { r.audio.data() + pos };
+                lanes.render(channels, 1, n, kVolume);
+            }
+            return r;
+        };
+
+        int failures = 0;
+        const Run reference = run(333);
+
+        // Expected: lane 0 at every third of a bar, lane 1 at each bar line (step 0 of 5 per bar)
+        std::vector<std::pair<long, int>> expected;
+        const double beatsPerSample = 120.0 / 60.0 / sr;
+        for (int g = 1; g <= 6; ++g)
+            expected.push_back({ (long)std::ceil((g * 4.0 / 3.0 - startPpq) / beatsPerSample - 1e-9), 0 });
+        for (int bar = 1; bar <= 2; ++bar)
+            expected.push_back({ (long)std::ceil((bar * 4.0 - startPpq) / beatsPerSample - 1e-9), 1 });
+        std::sort(expected.begin(), expected.end());
+        if (reference.events != expected) { std::cerr << "lanes: " << reference.events.size() << " events, expected " << expected.size() << " at the lane boundaries\n"; ++failures; }
+
+        for (int blockSize : { 1, 64, 1024 })
+        {
+            const Run r = run(blockSize);
+            if (r.events != reference.events || r.audio != reference.audio) { std::cerr << "lanes: output differs at block size " << blockSize << "\n"; ++failures; }
+        }
+
+        // The main sequencer's clicks join the list in sample order (ties before the lanes'), and only the
+        // lanes' are rendered here
+        {
+            LaneSequencer lanes;
+            lanes.prepare(sr);
+            lanes.setConfig(config);
+            HostTransportInfo host;
+            host.sampleRate = sr;
+            host.isPlaying = true;
+            host.ppqPosition = 4.0 - 100.0 * host.tempoBPM / 60.0 / sr; // both lanes' bar line at sample 100
+            SequencerBlock main;
+            main.clicks[0] = { 50, 0, 1.0f, false, 3, 0 };
+            main.clicks[1] = { 100, 0, 1.0f, false, 0, 1 };
+            main.numClicks = 2;
+            lanes.advance(host, main, 512);
+            const auto* ev = lanes.getEvents();
+            if (lanes.getNumEvents() != 4 || ev[0].lane != LaneEvent::kMainLane || ev[0].sample != 50 || ev[0].step != 3
+                || ev[1].lane != LaneEvent::kMainLane || ev[1].sample != 100 || ev[2].lane != 0 || ev[2].sample != 100
+                || ev[3].lane != 1 || ev[3].sample != 100 || ev[3].bar != 1)
+                { std::cerr << "lanes: main sequencer's clicks not merged in order (" << lanes.getNumEvents() << " events)\n"; ++failures; }
+            std::vector<float> audio (512, 0.0f);
+            float* channels[1] = { audio.data() };
+            lanes.render(channels, 1, 512, kVolume);
+            if (std::any_of(audio.begin(), audio.begin() + 100, [] (float x) { return x != 0.0f; }) || audio[101] == 0.0f)
+                { std::cerr << "lanes: render did not play just the lane's click\n"; ++failures; }
+        }
+
+        // A lane denser than its share of a block clamps: kMaxEventsPerLane events, the rest skipped and
+        // counted, and the next block carries on from the following boundary rather than the skipped ones
+        {
+            LaneConfig dense;
+            dense.numLanes = 1;
+            dense.lanes[0].subdivisionsPerBar = LaneParams::kMaxSubdivisions; // one per 1500 samples at 120 BPM
+            LaneSequencer lanes;
+            lanes.prepare(sr);
+            lanes.setConfig(dense);
+            HostTransportInfo host;
+            host.sampleRate = sr;
+            host.isPlaying = true;
+            SequencerBlock main;
+            main.playStateChanged = true;
+            const int bigBlock = 30 * 1500;
+            lanes.advance(host, main, bigBlock);
+            const int first = lanes.getNumEvents();
+            const size_t skipped = lanes.getDroppedEvents();
+            main.playStateChanged = false;
+            host.ppqPosition = (double)bigBlock * host.tempoBPM / 60.0 / sr;
+            lanes.advance(host, main, 1500);
+            if (first != LaneSequencer::kMaxEventsPerLane || skipped != (size_t)(30 - LaneSequencer::kMaxEventsPerLane)
+                || lanes.getNumEvents() != 1 || lanes.getEvents()[0].sample != 0)
+                { std::cerr << "lanes: dense lane gave " << first << " events and skipped " << skipped << "; next block " << lanes.getNumEvents() << "\n"; ++failures; }
+        }
+
+        // A count-in from before bar 0: lanes fire only at their real (negative-ppq) boundaries, with the
+        // steps and bars counting back from bar 0, and each boundary once however the blocks fall
+        {
+            constexpr double countInPpq = -3.9;
+            LaneSequencer lanes;
+            lanes.prepare(sr);
+            lanes.setConfig(config);
+            HostTransportInfo host;
+            host.sampleRate = sr;
+            host.isPlaying = true;
+            SequencerBlock main;
+            const double beatsPerSample = host.tempoBPM / 60.0 / sr;
+            const long total = (long)std::ceil((endPpq - countInPpq) / beatsPerSample);
+            std::vector<std::array<long, 4>> got; // sample, lane, step, bar
+            for (long pos = 0; pos < total; pos += 512)
+            {
+                host.ppqPosition = countInPpq + (double)pos * beatsPerSample;
+                main.playStateChanged = (pos == 0);
+                lanes.advance(host, main, (int)std::min<long>(512, total - pos));
+                for (int e = 0; e < lanes.getNumEvents(); ++e)
+                {
+                    const auto& ev = lanes.getEvents()[e];
+                    got.push_back({ pos + ev.sample, ev.lane, ev.step, ev.bar });
+                }
+            }
+
+            std::vector<std::array<long, 4>> expected;
+            auto at = [&] (double ppq) { return (long)std::ceil((ppq - countInPpq) / beatsPerSample - 1e-9); };
+            for (long g = -2; g <= 6; ++g) // lane 0 from -8/3 quarters
+                expected.push_back({ at((double)g * 4.0 / 3.0), 0, ((g % 3) + 3) % 3, (long)std::floor((double)g / 3.0) });
+            for (long bar = 0; bar <= 2; ++bar)
+                expected.push_back({ at((double)bar * 4.0), 1, 0, bar });
+            std::sort(expected.begin(), expected.end());
+            std::sort(got.begin(), got.end());
+            if (got != expected) { std::cerr << "lanes: count-in from ppq " << countInPpq << " gave " << got.size() << " events, expected " << expected.size() << "\n"; ++failures; }
+        }
+        return failures;
+    }
+
+    // Velocity scales a click by velocityToGain; an accent (per step or on the downbeat) changes its pitch
+    int checkVelocityAndAccent()
+    {
+        struct Click { float peak = 0.0f; int signChanges = 0; };
+        auto renderClick = [] (int velocity, bool accentStep, bool accentDownbeats, double startPpq = 0.99)
+        {
+            AtomicStepVelocities velocities;
+            velocities.set(1, (uint8_t)velocity);
+            Sequencer seq;
+            seq.prepare(48000.0, 1024);
+            seq.setSubdivisionsPerBar(4);
+            SequencerParams params;
+            params.stepCount = 4;
+            params.velocities = &velocities;
+            params.accentMask.set(1, accentStep);
+            params.accentDownbeats = accentDownbeats;
+            HostTransportInfo host;
+            host.sampleRate = 48000.0;
+            host.isPlaying = true;
+            host.ppqPosition = startPpq; // 0.99: step 1, 240 samples in; 3.99: the next bar's downbeat
+
+            std::vector<float> out(1024, 0.0f);
+            float* channels[1] = { out.data() };
+            seq.advance(host, params, 1024);
+            seq.render(channels, 1, 1024, kVolume);
+
+            Click c;
+            for (size_t i = 1; i < out.size(); ++i)
+            {
+                c.peak = std::max(c.peak, std::abs(out[i]));
+                c.signChanges += (out[i - 1] < 0.0f) != (out[i] < 0.0f) ? 1 : 0;
+            }
+            return c;
+        };
+
+        int failures = 0;
+        const Click full = renderClick(127, false, false), half = renderClick(64, false, false);
+        const float expectedRatio = velocityToGain(64);
+        if (std::abs(half.peak / full.peak - expectedRatio) > 1.0e-4f) { std::cerr << "velocity: level ratio " << half.peak / full.peak << ", expected " << expectedRatio << "\n"; ++failures; }
+
+        const Click accented = renderClick(127, true, false);
+        if (accented.signChanges <= full.signChanges) { std::cerr << "accent: accented click not higher in pitch\n"; ++failures; }
+        const Click downbeatOnly = renderClick(127, false, true);
+        if (downbeatOnly.signChanges != full.signChanges) { std::cerr << "accent: off-beat step accented as a downbeat\n"; ++failures; }
+        if (renderClick(127, false, true, 3.99).signChanges <= full.signChanges) { std::cerr << "accent: downbeat not accented\n"; ++failures; }
+        return failures;
+    }
+
+    // Accent routing (the separate outputs): accented clicks go to the accent channels, the rest to the
+    // normal ones, and the two add up to exactly the single-output render
+    int checkAccentRouting()
+    {
+        constexpr int total = 96000, blockSize = 512;
+        auto run = [] (bool routed, std::vector<float>& normal, std::vector<float>& accents)
+        {
+            Sequencer seq;
+            seq.prepare(48000.0, blockSize);
+            seq.setSubdivisionsPerBar(4);
+            SequencerParams params;
+            params.stepCount = 4;
+            params.accentMask.set(2, true);
+            params.accentDownbeats = true;
+            HostTransportInfo host;
+            host.sampleRate = 48000.0;
+            host.isPlaying = true;
+            normal.assign((size_t)total, 0.0f);
+            accents.assign((size_t)total, 0.0f);
+            for (int pos = 0; pos < total; pos += blockSize)
+            {
+                host.ppqPosition = 0.5 + (double)pos * (host.tempoBPM / 60.0) / host.sampleRate;
+                float* n[1] = { normal.data() + pos };
+                float* a[1] = { accents.data() + pos };
+                seq.advance(host, params, blockSize);
+                if (routed)
+                    seq.render(n, 1, a, 1, blockSize, kVolume);
+                else
+                    seq.render(n, 1, blockSize, kVolume);
+            }
+        };
+
+        std::vector<float> mixed, unused, normal, accents;
+        run(false, mixed, unused);
+        run(true, normal, accents);
+
+        int failures = 0;
+        float normalEnergy = 0.0f, accentEnergy = 0.0f;
+        for (size_t i = 0; i < mixed.size(); ++i)
+        {
+            if (normal[i] + accents[i] != mixed[i]) { std::cerr << "accent routing: sum differs from the mix at sample " << i << "\n"; ++failures; break; }
+            if (normal[i] != 0.0f && accents[i] != 0.0f) { std::cerr << "accent routing: click on both outputs at sample " << i << "\n"; ++failures; break; }
+            normalEnergy += normal[i] * normal[i];
+            accentEnergy += accents[i] * accents[i];
+        }
+        if (normalEnergy <= 0.0f || accentEnergy <= 0.0f) { std::cerr << "accent routing: an output stayed silent\n"; ++failures; }
+        return failures;
+    }
+
+    // Plays seq from startPpq at 120 BPM for numSamples, in blocks of blockSize (the last one cut short), and
+    // returns the mono output. Each block's gate step is appended to gateSteps when given.
+    std::vector<float> renderSequencer (Sequencer& seq, const SequencerParams& params, double sampleRate, double startPpq,
+                                        int numSamples, int blockSize, std::vector<int>* gateSteps = nullptr)
+    {
+        HostTransportInfo host;
+        host.sampleRate = sampleRate;
+        host.isPlaying = true;
+        std::vector<float> out ((size_t)numSamples, 0.0f);
+        for (int pos = 0; pos < numSamples; pos += blockSize)
+        {
+            const int n = std::min(blockSize, numSamples - pos);
+            host.ppqPosition = startPpq + (double)pos * (host.tempoBPM / 60.0) / sampleRate;
+            const auto& block = seq.advance(host, params, n);
+            if (gateSteps != nullptr && block.gateSample >= 0)
+                gateSteps->push_back(block.gateStepIndex);
+            float* channels[1] = { out.data() + pos };
+            seq.render(channels, 1, n, kVolume);
+        }
+        return out;
+    }
+
+    // A click starts with sin(0) = 0, so its first sample is the last zero before the tone
+    std::vector<int> findOnsets (const std::vector<float>& out)
+    {
+        std::vector<int> found;
+        for (size_t i = 0; i + 1 < out.size(); ++i)
+            if (out[i] == 0.0f && out[i + 1] != 0.0f && (i == 0 || out[i - 1] == 0.0f))
+                found.push_back((int)i);
+        return found;
+    }
+
+    // Swing, groove and offsets: clicks move by the expected number of samples, early ones included (the
+    // sequencer looks ahead), and delays that cross block edges neither drop nor repeat clicks. Onsets may
+    // differ by a sample with the block size, as the grid positions themselves do.
+    int checkTimingFeel()
+    {
+        constexpr double sr = 48000.0;
+        constexpr int total = 120000; // 2.5 s from ppq 0.5: the clicks at ppq 1..5
+        auto onsets = [&] (const SequencerParams& params, int blockSize)
+        {
+            Sequencer seq;
+            seq.prepare(sr, blockSize);
+            seq.setSubdivisionsPerBar(4);
+            return findOnsets(renderSequencer(seq, params, sr, 0.5, total, blockSize));
+        };
+
+        auto near = [] (const std::vector<int>& a, const std::vector<int>& b)
+        {
+            if (a.size() != b.size())
+                return false;
+            for (size_t i = 0; i < a.size(); ++i)
+                if (std::abs(a[i] - b[i]) > 1)
+                    return false;
+            return true;
+        };
+
+        int failures = 0;
+        SequencerParams straight;
+        straight.stepCount = 4;
+        const std::vector<int> grid { 12000, 36000, 60000, 84000, 108000 }; // one beat (subdivision) = 24000 samples
+
+        SequencerParams swung = straight;
+        swung.swing = swingFromPercent(62.5f); // a quarter of a subdivision on the odd subdivisions
+        const std::vector<int> swungGrid { 12000 + 6000, 36000, 60000 + 6000, 84000, 108000 + 6000 };
+        if (! near(onsets(swung, 512), swungGrid)) { std::cerr << "timing feel: swing did not delay the odd subdivisions\n"; ++failures; }
+
+        SequencerParams early = straight;
+        early.lookaheadSamples = 2400;
+        early.offsetSamples = -1000;
+        std::vector<int> earlyGrid;
+        for (int g : grid)
+            earlyGrid.push_back(g - 1000);
+        if (! near(onsets(early, 64), earlyGrid)) { std::cerr << "timing feel: negative offset did not move clicks early\n"; ++failures; }
+
+        SequencerParams tooEarly = early;
+        tooEarly.offsetSamples = -5000; // clamped to the lookahead
+        std::vector<int> clampedGrid;
+        for (int g : grid)
+            clampedGrid.push_back(g - 2400);
+        if (! near(onsets(tooEarly, 64), clampedGrid)) { std::cerr << "timing feel: early offset not clamped to the lookahead\n"; ++failures; }
+
+        SequencerParams grooved = early;
+        grooved.swing = 0.2f;
+        grooved.groove = &grooveTemplates()[4];
+        grooved.offsetSamples = 700;
+        const auto reference = onsets(grooved, 333);
+        if (reference.size() != grid.size()) { std::cerr << "timing feel: grooved run has " << reference.size() << " clicks, expected " << grid.size() << "\n"; ++failures; }
+        for (int blockSize : { 1, 64, 4096 })
+            if (! near(onsets(grooved, blockSize), reference)) { std::cerr << "timing feel: clicks differ at block size " << blockSize << "\n"; ++failures; }
+
+        // Lanes take the same lookahead and offset
+        auto runLane = [&] (int lookahead, int offset)
+        {
+            LaneSequencer lanes;
+            lanes.prepare(sr);
+            LaneConfig config;
+            config.numLanes = 1;
+            lanes.setConfig(config);
+            HostTransportInfo host;
+            host.sampleRate = sr;
+            host.isPlaying = true;
+            SequencerBlock main;
+            std::vector<float> out((size_t)total, 0.0f);
+            for (int pos = 0; pos < total; pos += 64)
+            {
+                host.ppqPosition = 0.5 + (double)pos * (host.tempoBPM / 60.0) / sr;
+                main.playStateChanged = (pos == 0);
+                float* channels[1] = { out.data() + pos };
+                lanes.advance(host, main, 64, lookahead, offset);
+                lanes.render(channels, 1, 64, kVolume);
+            }
+            return findOnsets(out);
+        };
+        std::vector<int> laneGrid = runLane(0, 0);
+        for (auto& g : laneGrid)
+            g -= 400;
+        if (laneGrid.empty() || ! near(runLane(1000, -400), laneGrid)) { std::cerr << "timing feel: lane offset not applied\n"; ++failures; }
+        return failures;
+    }
+
+    // Ratchets: a step repeats evenly across its subdivision, the repeats land in whichever blocks they fall
+    // in (including the one that has the next step's gate), and the clicks are the same for any block size
+    int checkRatchets()
+    {
+        constexpr double sr = 48000.0;
+        constexpr int total = 120000; // from ppq 0.5: the steps at ppq 1..5, one beat = 24000 samples
+        AtomicStepRatchets ratchets;
+        ratchets.set(1, 4);
+        ratchets.set(2, 3);
+        auto onsets = [&] (int blockSize)
+        {
+            Sequencer seq;
+            seq.prepare(sr, blockSize);
+            seq.setSubdivisionsPerBar(4);
+            SequencerParams params;
+            params.stepCount = 4;
+            params.ratchets = &ratchets;
+            return findOnsets(renderSequencer(seq, params, sr, 0.5, total, blockSize));
+        };
+
+        const std::vector<int> expected { 12000, 18000, 24000, 30000,   // step 1 x4
+                                          36000, 44000, 52000,          // step 2 x3
+                                          60000, 84000,                 // steps 3 and 0
+                                          108000, 114000 };             // step 1 again, cut off by the end
+        int failures = 0;
+        for (int blockSize : { 64, 1000, 8192, 20000 })
+        {
+            const auto found = onsets(blockSize);
+            bool match = found.size() == expected.size();
+            for (size_t i = 0; match && i < found.size(); ++i)
+                match = std::abs(found[i] - expected[i]) <= 1;
+            if (! match) { std::cerr << "ratchets: " << found.size() << " clicks at block size " << blockSize << ", expected " << expected.size() << " at the repeats\n"; ++failures; }
+        }
+        return failures;
+    }
+
+    // Pre-roll: play started a sample before bar 1 (as the click export does) sounds the downbeat at its
+    // first sample with step 1, and the steps count on from there; the start rule only skips a boundary
+    // that play starts exactly on
+    int checkPreRoll()
+    {
+        constexpr double sr = 48000.0;
+        constexpr int blockSize = 512;
+        Sequencer seq;
+        seq.prepare(sr, blockSize);
+        seq.setSubdivisionsPerBar(4);
+        SequencerParams params;
+        params.stepCount = 3;
+        HostTransportInfo host;
+        host.sampleRate = sr;
+        host.isPlaying = true;
+        const double beatsPerSample = host.tempoBPM / 60.0 / sr;
+
+        host.ppqPosition = -beatsPerSample;
+        seq.advance(host, params, 1);
+        std::vector<std::pair<int, int>> gates; // sample from bar 1 (within the engine's one-sample rounding), step
+        for (int pos = 0; pos + blockSize <= 4 * 24000; pos += blockSize)
+        {
+            host.ppqPosition = (double)pos * beatsPerSample;
+            const auto& block = seq.advance(host, params, blockSize);
+            if (block.gateSample >= 0)
+                gates.push_back({ pos + block.gateSample, block.gateStepIndex });
+        }
+        const std::vector<std::pair<int, int>> expected { { 0, 0 }, { 24000, 1 }, { 48000, 2 }, { 72000, 0 } };
+        bool match = gates.size() == expected.size();
+        for (size_t i = 0; match && i < gates.size(); ++i)
+            match = std::abs(gates[i].first - expected[i].first) <= 1 && gates[i].second == expected[i].second;
+        if (! match || gates.front().first != 0)
+        {
+            std::cerr << "pre-roll: " << gates.size() << " gates, expected the downbeat at sample 0 with step 1 and every beat after\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    // Hot reconfiguration: a new block size or sample rate mid-playback, with clicks waiting in the
+    // lookahead queue, keeps every click (at the same time) and the step sequence
+    int checkReconfigure()
+    {
+        constexpr double sr = 48000.0;
+        constexpr double seconds = 2.5; // from ppq 0.5: the steps at ppq 1..5
+        struct Run { std::vector<double> onsets; std::vector<int> steps; int stepAfterSwitch = -2; };
+        auto run = [&] (int switchAt, double newRate, int newBlockSize)
+        {
+            Sequencer seq;
+            seq.prepare(sr, 512);
+            seq.setSubdivisionsPerBar(4);
+            SequencerParams params;
+            params.stepCount = 3;
+
+            Run result;
+            auto play = [&] (double rate, double startPpq, int numSamples, int blockSize)
+            {
+                params.lookaheadSamples = (int)std::lround(0.05 * rate);
+                params.offsetSamples = (int)std::lround(-1000.0 / sr * rate);
+                return renderSequencer(seq, params, rate, startPpq, numSamples, blockSize, &result.steps);
+            };
+
+            // Whole 512-sample blocks up to the first one at or after switchAt, then the rest at the new settings
+            const int before = 512 * (int)std::min(std::ceil(seconds * sr / 512.0), std::ceil(switchAt / 512.0));
+            const double switchTime = before / sr;
+            std::vector<float> out = play(sr, 0.5, before, 512);
+            if (switchTime < seconds)
+            {
+                const int stepBefore = seq.getCurrentStepIndex();
+                seq.reconfigure(newRate, newBlockSize);
+                result.stepAfterSwitch = seq.getCurrentStepIndex() == stepBefore ? stepBefore : -1;
+                const int after = newBlockSize * (int)std::ceil((seconds - switchTime) * newRate / newBlockSize);
+                const auto rest = play(newRate, 0.5 + switchTime * 120.0 / 60.0, after, newBlockSize);
+                out.insert(out.end(), rest.begin(), rest.end());
+            }
+            for (int i : findOnsets(out))
+                result.onsets.push_back(i < before ? i / sr : switchTime + (i - before) / newRate);
+            return result;
+        };
+
+        int failures = 0;
+        const auto reference = run(INT32_MAX, sr, 512);
+        if (reference.onsets.size() != 5) { std::cerr << "reconfigure: reference run has " << reference.onsets.size() << " clicks, expected 5\n"; return 1; }
+
+        // Just before the click at ppq 2 sounds, while it waits in the queue
+        const int switchAt = 36000 - 1000 - 512;
+        struct Case { const char* name; double rate; int blockSize; };
+        for (const Case& c : { Case { "block size", sr, 128 }, Case { "block size", sr, 2048 },
+                               Case { "sample rate", 96000.0, 256 }, Case { "sample rate", 44100.0, 512 } })
+        {
+            const auto got = run(switchAt, c.rate, c.blockSize);
+            bool match = got.onsets.size() == reference.onsets.size() && got.steps == reference.steps;
+            for (size_t i = 0; match && i < got.onsets.size(); ++i)
+                match = std::abs(got.onsets[i] - reference.onsets[i]) <= 1.5 / std::min(sr, c.rate);
+            if (! match) { std::cerr << "reconfigure: new " << c.name << " (" << c.rate << " Hz, " << c.blockSize << ") lost or moved clicks\n"; ++failures; }
+            if (got.stepAfterSwitch < 0) { std::cerr << "reconfigure: step index reset\n"; ++failures; }
+        }
+        return failures;
+    }
+
+    int runCheck (const std::string& goldenPath)
+    {
+        // Every check runs, so one failure does not hide the others or the hash comparison
+        const int checkFailures = checkIdleBlocks() + checkLongPattern() + checkBarSwitch() + checkLanes()
+                                + checkVelocityAndAccent() + checkAccentRouting() + checkTimingFeel() + checkRatchets()
+                                + checkReconfigure() + checkPreRoll();
+        if (checkFailures != 0)
+            std::cout << checkFailures << " behaviour check(s) failed." << std::endl;
+
+        std::map<std::string, GoldenEntry> golden;
+        if (! loadGolden(goldenPath, golden))
+        {
+            std::cerr << "Cannot read golden file " << goldenPath << "\n";
+            return 1;
+        }
+
+        const std::string platform = platformTag();
+        int failures = 0, audioChecked = 0;
+        const auto cases = allCases();
+        for (const auto& c : cases)
+        {
+            const auto it = golden.find(c.name);
+            if (it == golden.end())
+            {
+                std::cerr << c.name << ": no golden entry (run with --update)\n";
+                ++failures;
+                continue;
+            }
+
+            const Render r = render(c, false);
+            if (hex(r.gateHash) != it->second.gateHash)
+            {
+                std::cerr << c.name << ": gate hash " << hex(r.gateHash) << " expected " << it->second.gateHash << "\n";
+                ++failures;
+            }
+
+            const auto audio = it->second.audioHashes.find(platform);
+            if (audio != it->second.audioHashes.end())
+            {
+                ++audioChecked;
+                if (hex(r.audioHash) != audio->second)
+                {
+                    std::cerr << c.name << ": audio hash " << hex(r.audioHash) << " expected " << audio->second << "\n";
+                    ++failures;
+                }
+            }
+        }
+
+        if (audioChecked == 0)
+            std::cout << "No audio hashes recorded for " << platform << "; checked gates only." << std::endl;
+
+        if (failures == 0)
+            std::cout << "All " << cases.size() << " golden render tests passed." << std::endl;
+        else
+            std::cout << failures << " golden render test(s) failed. Use --dump/--diff to locate the divergence." << std::endl;
+
+        return failures == 0 && checkFailures == 0 ? 0 : 1;
+    }
+
+    int runUpdate (const std::string& goldenPath)
+    {
+        std::map<std::string, GoldenEntry> golden;
+        loadGolden(goldenPath, golden);
+
+        const std::string platform = platformTag();
+        const auto cases = allCases();
+        for (const auto& c : cases)
+        {
+            const Render r = render(c, false);
+            auto& e = golden[c.name];
+            if (! e.gateHash.empty() && e.gateHash != hex(r.gateHash))
+                e.audioHashes.clear(); // gates moved: other platforms' audio hashes are stale
+            e.gateHash = hex(r.gateHash);
+            e.audioHashes[platform] = hex(r.audioHash);
+        }
+
+        if (! saveGolden(goldenPath, cases, golden))
+        {
+            std::cerr << "Cannot write golden file " << goldenPath << "\n";
+            return 1;
+        }
+        std::cout << "Recorded " << cases.size() << " golden renders for " << platform << " in " << goldenPath << std::endl;
+        return 0;
+    }
+
+    int runDump (const std::string& dir)
+    {
+        for (const auto& c : allCases())
+        {
+            const Render r = render(c, true);
+            std::ofstream audio(dir + "/" + c.name + ".f32", std::ios::binary | std::ios::trunc);
+            std::ofstream gates(dir + "/" + c.name + ".gates", std::ios::trunc);
+            if (! audio.is_open() || ! gates.is_open())
+            {
+                std::cerr << "Cannot write to " << dir << "\n";
+                return 1;
+            }
+            audio.write(reinterpret_cast<const char*>(r.audio.data()), (std::streamsize) (r.audio.size() * sizeof(float)));
+            for (const auto& g : r.gates)
+                gates << g.sample << ' ' << g.step << ' ' << g.bar << '\n';
+        }
+        std::cout << "Dumped renders to " << dir << std::endl;
+        return 0;
+    }
+
+    std::vector<float> readFloats (const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<float> v;
+        float f;
+        while (in.read(reinterpret_cast<char*>(&f), sizeof(f)))
+            v.push_back(f);
+        return v;
+    }
+
+    std::vector<Gate> readGates (const std::string& path)
+    {
+        std::ifstream in(path);
+        std::vector<Gate> v;
+        Gate g;
+        while (in >> g.sample >> g.step >> g.bar)
+            v.push_back(g);
+        return v;
+    }
+
+    int runDiff (const std::string& dirA, const std::string& dirB)
+    {
+        int differing = 0;
+        for (const auto& c : allCases())
+        {
+            const auto a = readFloats(dirA + "/" + c.name + ".f32");
+            const auto b = readFloats(dirB + "/" + c.name + ".f32");
+            const auto gatesA = readGates(dirA + "/" + c.name + ".gates");
+            const auto gatesB = readGates(dirB + "/" + c.name + ".gates");
+
+            size_t firstGateDiff = std::min(gatesA.size(), gatesB.size());
+            for (size_t i = 0; i < std::min(gatesA.size(), gatesB.size()); ++i)
+                if (gatesA[i].sample != gatesB[i].sample || gatesA[i].step != gatesB[i].step || gatesA[i].bar != gatesB[i].bar)
+                {
+                    firstGateDiff = i;
+                    break;
+                }
+
+            size_t firstSampleDiff = std::min(a.size(), b.size());
+            for (size_t i = 0; i < std::min(a.size(), b.size()); ++i)
+                if (std::memcmp(&a[i], &b[i], sizeof(float)) != 0)
+                {
+                    firstSampleDiff = i;
+                    break;
+                }
+
+            const bool gatesDiffer = firstGateDiff < std::max(gatesA.size(), gatesB.size());
+            const bool audioDiffers = firstSampleDiff < std::max(a.size(), b.size());
+            if (! gatesDiffer && ! audioDiffers)
+                continue;
+
+            ++differing;
+            std::cout << c.name << ":\n";
+            if (audioDiffers)
+            {
+                const int64_t frame = (int64_t) (firstSampleDiff / kNumChannels);
+                std::cout << "  first divergent sample: frame " << frame << " channel " << (firstSampleDiff % kNumChannels);
+                if (firstSampleDiff < std::min(a.size(), b.size()))
+                    std::cout << " (" << a[firstSampleDiff] << " vs " << b[firstSampleDiff] << ")";
+                else
+                    std::cout << " (length " << a.size() / kNumChannels << " vs " << b.size() / kNumChannels << " frames)";
+                std::cout << "\n";
+
+                // Nearest gate at or before the divergence in the reference render
+                const Gate* nearest = nullptr;
+                for (const auto& g : gatesA)
+                    if (g.sample <= frame) nearest = &g;
+                if (nearest != nullptr)
+                    std::cout << "  nearest gate: sample " << nearest->sample << " step " << nearest->step << " bar " << nearest->bar
+                              << " (" << (frame - nearest->sample) << " samples earlier)\n";
+            }
+            if (gatesDiffer)
+            {
+                std::cout << "  first divergent gate #" << firstGateDiff << ": ";
+                if (firstGateDiff < gatesA.size()) std::cout << "A sample " << gatesA[firstGateDiff].sample << " step " << gatesA[firstGateDiff].step << " bar " << gatesA[firstGateDiff].bar;
+                else std::cout << "A none";
+                std::cout << ", ";
+                if (firstGateDiff < gatesB.size()) std::cout << "B sample " << gatesB[firstGateDiff].sample << " step " << gatesB[firstGateDiff].step << " bar " << gatesB[firstGateDiff].bar;
+                else std::cout << "B none";
+                std::cout << "\n";
+            }
+        }
+
+        if (differing == 0)
+            std::cout << "Renders are identical." << std::endl;
+        return differing == 0 ? 0 : 1;
+    }
+}
+
+int main (int argc, char** argv)
+{
+    std::string goldenPath = METROG_GOLDEN_FILE;
+    std::string mode = "check", dirA, dirB;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--golden" && i + 1 < argc)
+            goldenPath = argv[++i];
+        else if (arg == "--update")
+            mode = "update";
+        else if (arg == "--dump" && i + 1 < argc)
+        {
+            mode = "dump";
+            dirA = argv[++i];
+        }
+        else if (arg == "--diff" && i + 2 < argc)
+        {
+            mode = "diff";
+            dirA = argv[++i];
+            dirB = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--golden <file>] [--update | --dump <dir> | --diff <dirA> <dirB>]\n";
+            return 2;
+        }
+    }
+
+    if (mode == "update") return runUpdate(goldenPath);
+    if (mode == "dump")   return runDump(dirA);
+    if (mode == "diff")   return runDiff(dirA, dirB);
+    return runCheck(goldenPath);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include "Timing.h"
+
+namespace metrog
+{
+    // Timing offsets per subdivision of the bar, in subdivisions (0.1 = a tenth of a subdivision late,
+    // negative = early), repeating every `length` subdivisions
+    struct GrooveTemplate
+    {
+        static constexpr int kMaxLength = 8;
+
+        const char* name = "Straight";
+        int length = 0; // 0 = no offsets
+        std::array<float, kMaxLength> offsets{};
+
+        float offsetAt (int subdivisionIndex) const noexcept
+        {
+            return length > 0 && subdivisionIndex >= 0 ? offsets[(size_t)(subdivisionIndex % length)] : 0.0f;
+        }
+
+        bool hasEarlyOffsets() const noexcept
+        {
+            for (int i = 0; i < length; ++i)
+                if (offsets[(size_t)i] < 0.0f)
+                    return true;
+            return false;
+        }
+    };
+
+    // Built-in templates; index 0 is straight time
+    inline const std::array<GrooveTemplate, 5>& grooveTemplates() noexcept
+    {
+        static const std::array<GrooveTemplate, 5> templates { {
+            { "Straight", 0, {} },
+            { "Laid back", 4, { 0.0f, 0.04f, 0.02f, 0.06f } },
+            { "Push", 4, { 0.0f, -0.04f, -0.02f, -0.06f } },
+            { "Shuffle", 2, { 0.0f, 0.16f } },
+            { "Drunk", 8, { 0.0f, 0.07f, -0.03f, 0.05f, 0.02f, -0.05f, 0.08f, 0.0f } },
+        } };
+        return templates;
+    }
+
+    // Swing as the fraction of a subdivision that every second subdivision of the bar is delayed by, from the
+    // usual percentage (50% = straight, 66% = triplet feel, 75% = dotted)
+    inline float swingFromPercent (float percent) noexcept
+    {
+        const float s = (percent - 50.0f) / 50.0f;
+        return s < 0.0f ? 0.0f : (s > 0.5f ? 0.5f : s);
+    }
+
+    // Total offset of a click on the given subdivision of the bar, in subdivisions
+    inline double grooveOffset (int subdivisionIndex, float swing, const GrooveTemplate* groove) noexcept
+    {
+        double offset = (subdivisionIndex & 1) != 0 ? (double)swing : 0.0;
+        if (groove != nullptr)
+            offset += (double)groove->offsetAt(subdivisionIndex);
+        return offset;
+    }
+
+    // The transport as it will be lookaheadSamples from now, assuming it keeps playing at its tempo; a
+    // stopped transport is returned unchanged
+    inline HostTransportInfo lookaheadPosition (const HostTransportInfo& host, int lookaheadSamples, double sampleRate) noexcept
+    {
+        HostTransportInfo ahead = host;
+        if (host.isPlaying && lookaheadSamples > 0 && sampleRate > 0.0)
+            ahead.ppqPosition += (double)lookaheadSamples * host.tempoBPM / 60.0 / sampleRate;
+        return ahead;
+    }
+}
@@ -0,0 +1,309 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include "Sequencer.h"
+
+namespace metrog
+{
+    // One polymetric lane: its own bar division, step cycle, mask and click pitch
+    struct LaneParams
+    {
+        static constexpr int kMaxSubdivisions = 64;
+
+        StepMask stepMask = StepMask::allEnabled();
+        int subdivisionsPerBar = 3;     // clicks per bar (3 against the main lane's 4, ...)
+        int stepCount = 3;              // 1..StepMask::kMaxSteps
+        float clickHz = 2000.0f;
+    };
+
+    // Lanes played alongside the main sequencer (which is lane 0)
+    struct LaneConfig
+    {
+        static constexpr int kMaxLanes = 16; // including the main sequencer
+        static constexpr int kMaxExtraLanes = kMaxLanes - 1;
+
+        int numLanes = 0; // extra lanes in use, 0..kMaxExtraLanes
+        std::array<LaneParams, kMaxExtraLanes> lanes{};
+    };
+
+    // A click due in the current block: a lane's, or one of the main sequencer's
+    struct LaneEvent
+    {
+        static constexpr int16_t kMainLane = -1;
+
+        int sample = 0;     // in the block as seen lookaheadSamples ahead
+        int delay = 0;      // samples from there until the click sounds
+        int32_t bar = 0;
+        int16_t lane = 0;   // index into LaneConfig::lanes, or kMainLane
+        int16_t step = 0;
+    };
+
+    // Extra host-locked click lanes. Each block, the boundaries of every lane are found in one pass over
+    // struct-of-arrays lane state (a few multiply/floor operations per lane, no per-sample work) and
+    // merged with the main sequencer's clicks into one event list sorted by sample; render() then mixes
+    // the voices span by span between events, touching only voices that are sounding. Boundary positions
+    // come from the transport alone: lane l's boundary g lies g * barLength / subdivisions[l] quarters
+    // after the start of bar 0 in the host's meter (found from its last bar line), so every lane stays
+    // aligned to the bar lines through loops, relocations, meter changes and count-ins before bar 0
+    // (negative g). Audio thread only; no allocation.
+    class LaneSequencer
+    {
+    public:
+        // Sized for the densest lane (kMaxSubdivisions to a 4/4 bar) at 240 BPM in 8192-sample blocks at
+        // 48 kHz: a boundary every 750 samples. Past that a lane clamps: boundaries beyond its share of a
+        // block are skipped and counted (getDroppedEvents()), never pushed late into the next block.
+        static constexpr int kMaxEventsPerLane = 16;
+        static constexpr int kMaxEvents = LaneConfig::kMaxExtraLanes * kMaxEventsPerLane + SequencerBlock::kMaxClicks;
+        static_assert(kMaxEventsPerLane >= 8192 / (4 * 60 * 48000 / 240 / LaneParams::kMaxSubdivisions) + 2,
+                      "a lane's events must fit the worst case above (plus the boundary a sample before the block)");
+
+        LaneSequencer() noexcept
+        {
+            clickHz.fill((double)LaneParams{}.clickHz);
+            subdivisions.fill(1);
+            stepCounts.fill(1);
+            lastBoundary.fill(kNoBoundary);
+        }
+
+        void prepare (double newSampleRate) noexcept
+        {
+            sampleRate = newSampleRate;
+            for (int l = 0; l < LaneConfig::kMaxExtraLanes; ++l)
+                voices[(size_t)l].prepare(sampleRate, clickHz[(size_t)l]);
+            numEvents = 0;
+            numLaneEvents = 0;
+            lastBoundary.fill(kNoBoundary);
+            lastPpqEnd = kNoPpq;
+            lastLookaheadSamples = 0;
+            pending.clear();
+            sampleClock = 0;
+        }
+
+        // A new sample rate without the reset prepare() does: lane positions, waiting clicks (rescheduled
+        // for the same time) and ringing clicks carry on, as for Sequencer::reconfigure
+        void reconfigure (double newSampleRate) noexcept
+        {
+            const double ratio = newSampleRate / sampleRate;
+            sampleRate = newSampleRate;
+            if (ratio == 1.0)
+                return;
+            for (int l = 0; l < LaneConfig::kMaxExtraLanes; ++l)
+                voices[(size_t)l].setSampleRate(sampleRate, clickHz[(size_t)l]);
+            pending.rescale(sampleClock, ratio);
+            lastLookaheadSamples = (int)std::lround(lastLookaheadSamples * ratio);
+        }
+
+        // Installs a new lane setup; lanes whose pitch is unchanged keep ringing
+        void setConfig (const LaneConfig& config) noexcept
+        {
+            cachedBeatsPerBar = 0.0; // boundary spacing depends on the subdivisions
+            numLanes = config.numLanes < 0 ? 0 : (config.numLanes > LaneConfig::kMaxExtraLanes ? LaneConfig::kMaxExtraLanes : config.numLanes);
+            for (int l = 0; l < LaneConfig::kMaxExtraLanes; ++l)
+            {
+                const auto& lane = config.lanes[(size_t)l];
+                const auto i = (size_t)l;
+                subdivisions[i] = std::clamp(lane.subdivisionsPerBar, 1, LaneParams::kMaxSubdivisions);
+                stepCounts[i] = lane.stepCount > 0 ? lane.stepCount : 1;
+                masks[i] = lane.stepMask;
+                if (clickHz[i] != (double)lane.clickHz)
+                {
+                    clickHz[i] = (double)lane.clickHz;
+                    voices[i].prepare(sampleRate, clickHz[i]);
+                }
+            }
+        }
+
+        int getNumLanes() const noexcept { return numLanes; }
+
+        // Collects this block's clicks: the main sequencer's (already advanced over the block; it renders
+        // them itself) and the lanes'. The lanes follow the main lane's start rule: a block in which the
+        // main sequencer suppressed its boundaries (play started exactly on a bar line) emits nothing.
+        // Like the main sequencer, boundaries are looked for lookaheadSamples ahead of the block, and the
+        // clicks sound that much plus offsetSamples later (no earlier than now).
+        void advance (const HostTransportInfo& transport, const SequencerBlock& main, int numSamples,
+                      int lookaheadSamples = 0, int offsetSamples = 0) noexcept
+        {
+            numEvents = 0;
+            numLaneEvents = 0;
+            for (int c = 0; c < main.numClicks; ++c)
+            {
+                const auto& click = main.clicks[(size_t)c];
+                insertEvent({ click.sample, click.delay, click.bar, LaneEvent::kMainLane, (int16_t)click.step });
+            }
+
+            const int eventDelay = std::max(0, lookaheadSamples + offsetSamples);
+            if (lookaheadSamples != lastLookaheadSamples || ! transport.isPlaying)
+                pending.clear(); // as for the main sequencer: scheduled from another position, or stopped
+            lastLookaheadSamples = lookaheadSamples;
+
+            const HostTransportInfo host = lookaheadPosition(transport, lookaheadSamples, sampleRate);
+            if (numLanes == 0 || ! host.isPlaying || main.suppressedBoundary || numSamples <= 0
+                || host.tempoBPM <= 0.0 || sampleRate <= 0.0)
+            {
+                lastPpqEnd = kNoPpq;
+                return;
+            }
+
+            const double beatsPerBar = TimingEngine::quartersPerBar(host);
+            const double ppqOrigin = host.barStartPpq - host.barStartIndex * beatsPerBar; // bar 0 in this meter
+            if (beatsPerBar != cachedBeatsPerBar || std::abs(ppqOrigin - cachedOrigin) > 1e-9)
+                updateBoundarySpacing(beatsPerBar, ppqOrigin);
+            const double beatsPerSample = host.tempoBPM / 60.0 / sampleRate;
+            const double samplesPerBeat = 1.0 / beatsPerSample;
+            const double ppqStart = host.ppqPosition; // may be negative during a count-in or pre-roll
+
+            // Unless this block continues the last one (within half a sample), playback restarted or jumped:
+            // forget the boundaries already taken and search from the block's position
+            if (main.playStateChanged || std::abs(ppqStart - lastPpqEnd) > 0.5 * beatsPerSample)
+                lastBoundary.fill(kNoBoundary);
+            lastPpqEnd = ppqStart + (double)numSamples * beatsPerSample;
+
+            // A boundary belongs to the block whose samples contain its first sample at or after it, i.e.
+            // it lies after ppqStart - 1 sample. While playback is continuous each lane simply resumes
+            // after the last boundary it took.
+            const double windowStart = ppqStart - beatsPerSample;
+            for (int l = 0; l < numLanes; ++l)
+            {
+                const auto i = (size_t)l;
+                int64_t g = lastBoundary[i] != kNoBoundary ? lastBoundary[i] + 1
+                                                           : (int64_t)std::floor((windowStart - ppqOrigin) * boundariesPerBeat[i] + 1e-9) + 1;
+
+                for (int n = 0;; ++n, ++g)
+                {
+                    const double offset = (ppqOrigin + (double)g * beatsPerBoundary[i] - ppqStart) * samplesPerBeat;
+                    const int sample = std::max(0, (int)std::ceil(offset - 1e-9));
+                    if (sample >= numSamples)
+                        break;
+
+                    lastBoundary[i] = g;
+                    if (n >= kMaxEventsPerLane)
+                    {
+                        dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                        continue;
+                    }
+                    const int step = (int)(((g % stepCounts[i]) + stepCounts[i]) % stepCounts[i]);
+                    const int bar = (int)std::floor((double)g / (double)subdivisions[i]);
+                    if (masks[i].test(step))
+                    {
+                        insertEvent({ sample, eventDelay, bar, (int16_t)l, (int16_t)step });
+                        ++numLaneEvents;
+                    }
+                }
+            }
+        }
+
+        const LaneEvent* getEvents() const noexcept { return events.data(); }
+        int getNumEvents() const noexcept { return numEvents; }
+
+        // Lane boundaries skipped because a block held more than kMaxEventsPerLane of them (any thread)
+        size_t getDroppedEvents() const noexcept { return dropped.load(std::memory_order_relaxed); }
+
+        // Adds the lane clicks into the channels, triggering each voice at its click's sample (the event's
+        // sample plus the delay). Call once after every advance(): it also moves the scheduling clock.
+        void render (float* const* channels, int numChannels, int numSamples, float volume) noexcept
+        {
+            for (int e = 0; e < numEvents; ++e)
+            {
+                const auto& ev = events[(size_t)e];
+                if (ev.lane != LaneEvent::kMainLane)
+                    pending.push({ sampleClock + ev.sample + ev.delay, 1.0f, ev.lane, false });
+            }
+
+            for (int start = 0; start < numSamples;)
+            {
+                for (; ! pending.empty() && pending.front().due <= sampleClock + start; pending.pop())
+                    voices[(size_t)pending.front().voice].trigger();
+
+                // All voices, so a lane removed mid-click still finishes its tail
+                const int end = pending.empty() ? numSamples : (int)std::min<int64_t>(numSamples, pending.front().due - sampleClock);
+                for (int l = 0; l < LaneConfig::kMaxExtraLanes; ++l)
+                {
+                    auto& voice = voices[(size_t)l];
+                    const float gain = volume * voice.getLevel();
+                    for (int s = start; s < end && voice.isActive(); ++s)
+                    {
+                        const float value = voice.next(gain);
+                        for (int ch = 0; ch < numChannels; ++ch)
+                            channels[ch][s] += value;
+                    }
+                }
+                start = end;
+            }
+            sampleClock += numSamples;
+        }
+
+        // Whether the next render() adds anything (after advance())
+        bool willRender() const noexcept { return numLaneEvents > 0 || ! pending.empty() || isAnyVoiceActive(); }
+
+        bool isAnyVoiceActive() const noexcept
+        {
+            for (const auto& voice : voices)
+                if (voice.isActive())
+                    return true;
+            return false;
+        }
+
+    private:
+        static constexpr int64_t kNoBoundary = INT64_MIN / 2;
+        // lastPpqEnd after a stop: never within half a sample of a block start, however negative the ppq
+        static constexpr double kNoPpq = -std::numeric_limits<double>::infinity();
+
+        // Boundary numbers only mean something for one spacing and origin, so the taken ones are
+        // forgotten; the next block searches from its own position (a boundary never lands in two blocks'
+        // windows). Within one meter the origin stays put as the host's bar line moves on.
+        void updateBoundarySpacing (double beatsPerBar, double ppqOrigin) noexcept
+        {
+            cachedBeatsPerBar = beatsPerBar;
+            cachedOrigin = ppqOrigin;
+            lastBoundary.fill(kNoBoundary);
+            for (size_t i = 0; i < subdivisions.size(); ++i)
+            {
+                boundariesPerBeat[i] = (double)subdivisions[i] / beatsPerBar;
+                beatsPerBoundary[i] = beatsPerBar / (double)subdivisions[i];
+            }
+        }
+
+        // Insertion into the sample-sorted list; lanes arrive in order, so ties keep lane order
+        void insertEvent (const LaneEvent& e) noexcept
+        {
+            if (numEvents >= kMaxEvents)
+                return;
+            int pos = numEvents++;
+            for (; pos > 0 && events[(size_t)pos - 1].sample > e.sample; --pos)
+                events[(size_t)pos] = events[(size_t)pos - 1];
+            events[(size_t)pos] = e;
+        }
+
+        double sampleRate = 48000.0;
+        int numLanes = 0;
+
+        // Lane state, struct-of-arrays
+        std::array<int, LaneConfig::kMaxExtraLanes> subdivisions{};
+        std::array<int, LaneConfig::kMaxExtraLanes> stepCounts{};
+        std::array<StepMask, LaneConfig::kMaxExtraLanes> masks{};
+        std::array<double, LaneConfig::kMaxExtraLanes> clickHz{};
+        std::array<int64_t, LaneConfig::kMaxExtraLanes> lastBoundary{};
+        std::array<double, LaneConfig::kMaxExtraLanes> boundariesPerBeat{}, beatsPerBoundary{}; // for cachedBeatsPerBar
+        double cachedBeatsPerBar = 0.0;
+        double cachedOrigin = 0.0;
+        std::array<ClickVoice, LaneConfig::kMaxExtraLanes> voices{};
+        double lastPpqEnd = kNoPpq;
+
+        // This block's events, sorted by sample
+        std::array<LaneEvent, kMaxEvents> events{};
+        int numEvents = 0;
+        int numLaneEvents = 0; // of them, the lanes' (the rest are the main sequencer's)
+        std::atomic<size_t> dropped { 0 };
+
+        // Clicks waiting for their sample when delayed past the block; full lanes at the densest settings
+        // and the longest delays stay under the capacity
+        ClickQueue<512> pending;
+        int64_t sampleClock = 0;
+        int lastLookaheadSamples = 0;
+    };
+}
@@ -0,0 +1,237 @@
+#include <iostream>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "SpscRing.h"
+#include "DspLoad.h"
+#include "TraceLog.h"
+#include "SeqLock.h"
+#include "UiSnapshot.h"
+#include "StepMask.h"
+#include "TripleBuffer.h"
+
+using namespace metrog;
+
+static int runTests()
+{
+    int failures = 0;
+
+    // SpscRing: capacity, ordering and drop accounting on a single thread
+    {
+        SpscRing<int, 8> ring;
+        for (int i = 0; i < 8; ++i)
+            if (! ring.push(i)) { std::cerr << "SpscRing push " << i << " unexpectedly failed\n"; ++failures; }
+        if (ring.push(99)) { std::cerr << "SpscRing accepted push beyond capacity\n"; ++failures; }
+        if (ring.getDroppedCount() != 1) { std::cerr << "SpscRing drop count " << ring.getDroppedCount() << " expected 1\n"; ++failures; }
+
+        int buf[16] = {};
+        const size_t n = ring.popInto(buf, 16);
+        if (n != 8) { std::cerr << "SpscRing popInto returned " << n << " expected 8\n"; ++failures; }
+        for (int i = 0; i < (int) n; ++i)
+            if (buf[i] != i) { std::cerr << "SpscRing order mismatch at " << i << "\n"; ++failures; }
+
+        int v = -1;
+        if (ring.pop(v)) { std::cerr << "SpscRing pop on empty ring succeeded\n"; ++failures; }
+    }
+
+    // SpscRing: concurrent producer/consumer sees every value exactly once, in order
+    {
+        static SpscRing<uint64_t, 64> ring;
+        constexpr uint64_t count = 200000;
+        std::thread producer([] { for (uint64_t i = 0; i < count; ) if (ring.push(i)) ++i; });
+
+        uint64_t received = 0, mismatches = 0;
+        while (received < count)
+        {
+            uint64_t v;
+            if (ring.pop(v))
+            {
+                if (v != received) ++mismatches;
+                ++received;
+            }
+        }
+        producer.join();
+        if (mismatches != 0) { std::cerr << "SpscRing concurrent order: " << mismatches << " out-of-order values\n"; ++failures; }
+    }
+
+    // SeqLock: a reader racing a writer only ever sees whole values
+    {
+        struct Payload { uint64_t a, b, c; uint32_t d; };
+        static SeqLock<Payload> lock;
+        static std::atomic<bool> done { false };
+        constexpr uint64_t count = 200000;
+        std::thread writer([] { for (uint64_t i = 1; i <= count; ++i) lock.store({ i, i * 3, ~i, (uint32_t) i }); done.store(true); });
+
+        uint64_t reads = 0, torn = 0, last = 0, backwards = 0;
+        while (! done.load())
+        {
+            const Payload p = lock.load();
+            if (p.a != 0 && (p.b != p.a * 3 || p.c != ~p.a || p.d != (uint32_t) p.a)) ++torn;
+            if (p.a < last) ++backwards;
+            last = p.a;
+            ++reads;
+        }
+        writer.join();
+        if (torn != 0) { std::cerr << "SeqLock: " << torn << " torn reads out of " << reads << "\n"; ++failures; }
+        if (backwards != 0) { std::cerr << "SeqLock: values went backwards " << backwards << " times\n"; ++failures; }
+        if (lock.load().a != count) { std::cerr << "SeqLock: final value not visible\n"; ++failures; }
+
+        SeqLock<UiSnapshot> ui;
+        UiSnapshot snap;
+        snap.currentStep = 5; snap.stepMask = StepMask::fromBits(0xa5u); snap.stepMask.set(127, true); snap.tempoBPM = 133.0;
+        ui.store(snap);
+        const UiSnapshot back = ui.load();
+        if (back.currentStep != 5 || back.stepMask != snap.stepMask || back.tempoBPM != 133.0) { std::cerr << "SeqLock: UiSnapshot round trip failed\n"; ++failures; }
+    }
+
+    // UiSnapshot: playhead extrapolation and per-step progress (4/4, 8 subdivisions = half a beat each)
+    {
+        UiSnapshot snap;
+        snap.playing = 1; snap.tempoBPM = 120.0; snap.ppqPosition = 4.25; snap.timeNs = 1000000000ull;
+        const uint64_t ms = 1000000ull;
+
+        if (std::abs(extrapolatePpq(snap, snap.timeNs + 100 * ms) - 4.45) > 1e-9) { std::cerr << "extrapolatePpq forward wrong\n"; ++failures; }
+        if (std::abs(extrapolatePpq(snap, snap.timeNs - 100 * ms) - 4.05) > 1e-9) { std::cerr << "extrapolatePpq backward wrong\n"; ++failures; }
+        if (std::abs(subdivisionProgress(snap, 4.25) - 0.5) > 1e-9) { std::cerr << "subdivisionProgress mid-step wrong\n"; ++failures; }
+        if (subdivisionProgress(snap, 3.9) != 0.0) { std::cerr << "subdivisionProgress not clamped at 0\n"; ++failures; }
+        if (subdivisionProgress(snap, 4.7) != 1.0) { std::cerr << "subdivisionProgress ran into the next step\n"; ++failures; }
+
+        // 6/8 (three quarters a bar, four subdivisions of 0.75) with the host's bar line at 3.5: the step
+        // started on 4.25, not on the 3.75 counting bars from ppq 0 would give
+        snap.beatsPerBar = 3.0f; snap.subdivisionsPerBar = 4; snap.barPpq = 0.75f;
+        if (std::abs(subdivisionProgress(snap, 4.625) - 0.5) > 1e-6) { std::cerr << "subdivisionProgress ignored the bar line\n"; ++failures; }
+        snap.beatsPerBar = 4.0f; snap.subdivisionsPerBar = 8; snap.barPpq = -1.0f;
+
+        snap.playing = 0;
+        if (extrapolatePpq(snap, snap.timeNs + 500 * ms) != 4.25) { std::cerr << "extrapolatePpq moved while stopped\n"; ++failures; }
+    }
+
+    // AtomicStepMask: bits set concurrently from two threads are never lost, across both words
+    {
+        AtomicStepMask mask;
+        std::thread evens([&] { for (int i = 0; i < StepMask::kMaxSteps; i += 2) mask.set(i, true); });
+        std::thread odds([&] { for (int i = 1; i < StepMask::kMaxSteps; i += 2) mask.set(i, true); });
+        evens.join();
+        odds.join();
+        if (mask.load() != StepMask::allEnabled()) { std::cerr << "AtomicStepMask lost a concurrent set\n"; ++failures; }
+
+        mask.set(64, false);
+        const StepMask m = mask.load();
+        if (m.test(64) || ! m.test(63) || ! m.test(127) || m.test(128) || m.test(-1)) { std::cerr << "AtomicStepMask clear/test wrong\n"; ++failures; }
+        if (! (m ^ StepMask::allEnabled()).test(64)) { std::cerr << "StepMask xor wrong\n"; ++failures; }
+    }
+
+    // TripleBuffer: the reader only ever sees whole values, never goes backwards, and ends on the last one
+    {
+        struct Pair { uint64_t a = 0, b = 0; };
+        static TripleBuffer<Pair> buffer;
+        constexpr uint64_t kValues = 200000;
+        std::atomic<bool> done { false };
+        std::thread writer([&] {
+            for (uint64_t i = 1; i <= kValues; ++i)
+                buffer.publish({ i, ~i });
+            done.store(true, std::memory_order_release);
+        });
+
+        Pair p;
+        uint64_t last = 0;
+        bool torn = false, backwards = false;
+        auto check = [&] { torn |= (p.b != ~p.a); backwards |= (p.a < last); last = p.a; };
+        while (! done.load(std::memory_order_acquire))
+            if (buffer.take(p))
+                check();
+        writer.join();
+        if (buffer.take(p))
+            check();
+
+        if (torn) { std::cerr << "TripleBuffer: torn value\n"; ++failures; }
+        if (backwards) { std::cerr << "TripleBuffer: value went backwards\n"; ++failures; }
+        if (last != kValues) { std::cerr << "TripleBuffer: last value " << last << " not seen\n"; ++failures; }
+        if (buffer.take(p)) { std::cerr << "TripleBuffer: value taken twice\n"; ++failures; }
+    }
+
+    // DspLoadStats: load math, peak hold and risk accounting
+    {
+        DspLoadStats stats;
+        const uint64_t ms = 1000000ull;
+        auto sample = [] (uint64_t t, uint32_t elapsed, uint32_t budget) { DspLoadSample s; s.startNs = t; s.elapsedNs = elapsed; s.budgetNs = budget; return s; };
+
+        stats.add(sample(0, 100, 1000));
+        if (std::abs(stats.getCurrentLoad() - 0.1f) > 1e-6f) { std::cerr << "DspLoadStats current load wrong\n"; ++failures; }
+
+        stats.add(sample(10 * ms, 900, 1000));   // spike: risk, held as peak
+        stats.add(sample(20 * ms, 200, 1000));
+        if (std::abs(stats.getPeakHoldLoad() - 0.9f) > 1e-6f) { std::cerr << "DspLoadStats peak not held\n"; ++failures; }
+        if (stats.getRiskBlockCount() != 1 || ! stats.hasRecentXrunRisk()) { std::cerr << "DspLoadStats risk not recorded\n"; ++failures; }
+
+        stats.add(sample(2000 * ms, 150, 1000)); // after hold window: peak released, risk stale
+        if (std::abs(stats.getPeakHoldLoad() - 0.15f) > 1e-6f) { std::cerr << "DspLoadStats peak not released\n"; ++failures; }
+        if (stats.hasRecentXrunRisk()) { std::cerr << "DspLoadStats risk did not expire\n"; ++failures; }
+
+        stats.add(sample(2010 * ms, 1500, 1000));
+        if (stats.getOverBudgetCount() != 1 || std::abs(stats.getMaxLoad() - 1.5f) > 1e-6f) { std::cerr << "DspLoadStats over-budget not recorded\n"; ++failures; }
+        if (stats.getBlockCount() != 5) { std::cerr << "DspLoadStats block count wrong\n"; ++failures; }
+    }
+
+    // TraceWriter: records drained to well-formed Chrome trace JSON, locale-independent numbers
+    {
+        static TraceRing ring;
+        TraceWriter writer;
+        const std::string path = "metrog_trace_test.json";
+        if (! writer.start(ring, path, 48000.0)) { std::cerr << "TraceWriter failed to open " << path << "\n"; ++failures; }
+
+        for (int i = 0; i < 100; ++i)
+        {
+            TraceRecord r;
+            r.blockStartNs = 1000000ull * static_cast<uint64_t>(i);
+            r.ppq = 0.25 * i;
+            r.tempoBPM = 120.0;
+            r.numSamples = 512;
+            r.midiNs = 100; r.transportNs = 200; r.crossingNs = 300; r.renderNs = 4000;
+            r.flags = TraceRecord::kPlaying;
+            if (i % 10 == 0)
+            {
+                r.flags |= TraceRecord::kCrossing | TraceRecord::kGate;
+                r.crossingSample = 17;
+                r.stepIndex = i / 10;
+            }
+            ring.push(r);
+        }
+        writer.stop();
+
+        std::ifstream in(path);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        const std::string json = ss.str();
+        auto count = [&json] (const std::string& needle)
+        {
+            size_t n = 0;
+            for (size_t pos = json.find(needle); pos != std::string::npos; pos = json.find(needle, pos + 1)) ++n;
+            return n;
+        };
+        if (writer.getRecordsWritten() != 100) { std::cerr << "TraceWriter wrote " << writer.getRecordsWritten() << " records, expected 100\n"; ++failures; }
+        if (json.empty() || json.front() != '[' || json.find("\n]") == std::string::npos) { std::cerr << "TraceWriter output is not a closed JSON array\n"; ++failures; }
+        if (count("\"name\":\"processBlock\"") != 100) { std::cerr << "TraceWriter processBlock event count wrong\n"; ++failures; }
+        if (count("\"name\":\"gate\"") != 10) { std::cerr << "TraceWriter gate event count wrong\n"; ++failures; }
+        if (json.find("\"ppq\":2.500000") == std::string::npos) { std::cerr << "TraceWriter ppq formatting wrong\n"; ++failures; }
+        if (json.find("\"ts\":1000.000,\"dur\":4.600") == std::string::npos) { std::cerr << "TraceWriter block timing wrong\n"; ++failures; }
+        std::remove(path.c_str());
+    }
+
+    if (failures == 0)
+        std::cout << "All LockFree tests passed." << std::endl;
+    else
+        std::cout << failures << " LockFree test(s) failed." << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
+
+int main()
+{
+    return runTests();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <cstdint>
+#include "TempoMap.h"
+
+namespace metrog
+{
+    // Scripted host playhead for driving the processor without a DAW (test harnesses, offline renders).
+    // Not thread-safe: configure and advance it from the thread that calls processBlock.
+    class OfflineTransport : public juce::AudioPlayHead
+    {
+    public:
+        void setTempo (double bpm) noexcept { tempoBPM = bpm; }
+        void setTimeSigNumerator (int numerator) noexcept { timeSigNumerator = numerator; }
+        void setTimeSigDenominator (int denominator) noexcept { timeSigDenominator = denominator; }
+        void setPlaying (bool shouldPlay) noexcept { playing = shouldPlay; }
+        void setPpqPosition (double ppq) noexcept { ppqPosition = ppq; followTempoMap(); }
+        void setSampleRate (double rate) noexcept { sampleRate = rate; }
+
+        // Takes tempo and time signature from a map as the position moves, instead of the fixed values
+        // (null = fixed again), and reports the map's bar lines: the last bar start and the bars before
+        // it, so a meter change moves the later ones. The map must outlive its use here.
+        void setTempoMap (const TempoMap* map) noexcept { tempoMap = map; followTempoMap(); }
+
+        // Samples in the next block, at most maxSamples: with a map, blocks split around tempo changes
+        // (TempoMap::blockSamplesAt) so each change lands on its sample
+        int nextBlockSamples (int maxSamples) const noexcept
+        {
+            if (tempoMap == nullptr || ! playing || sampleRate <= 0.0)
+                return maxSamples;
+            return tempoMap->blockSamplesAt(tempoMap->secondsAtPpq(ppqPosition), sampleRate, maxSamples);
+        }
+
+        double getTempo() const noexcept { return tempoBPM; }
+        double getPpqPosition() const noexcept { return ppqPosition; }
+        bool isPlaying() const noexcept { return playing; }
+
+        // Advance the transport past a rendered block (position only moves while playing)
+        void advance (int numSamples) noexcept
+        {
+            if (playing && sampleRate > 0.0)
+            {
+                if (tempoMap != nullptr)
+                    ppqPosition = tempoMap->ppqAtSeconds(tempoMap->secondsAtPpq(ppqPosition) + static_cast<double>(numSamples) / sampleRate);
+                else
+                    ppqPosition += (tempoBPM / 60.0) * (static_cast<double>(numSamples) / sampleRate);
+                timeInSamples += numSamples;
+                followTempoMap();
+            }
+        }
+
+        juce::Optional<PositionInfo> getPosition() const override
+        {
+            PositionInfo info;
+            info.setBpm(tempoBPM);
+            info.setTimeSignature(TimeSignature { timeSigNumerator, timeSigDenominator });
+            info.setIsPlaying(playing);
+            info.setPpqPosition(ppqPosition);
+            if (tempoMap != nullptr)
+            {
+                info.setPpqPositionOfLastBarStart(lastBarStartPpq);
+                info.setBarCount(barCount);
+            }
+            info.setTimeInSamples(timeInSamples);
+            if (sampleRate > 0.0)
+                info.setTimeInSeconds(static_cast<double>(timeInSamples) / sampleRate);
+            return info;
+        }
+
+    private:
+        void followTempoMap() noexcept
+        {
+            if (tempoMap == nullptr)
+                return;
+            tempoBPM = tempoMap->bpmAtPpq(ppqPosition);
+            const auto& meter = tempoMap->meterAtPpq(ppqPosition);
+            timeSigNumerator = meter.numerator;
+            timeSigDenominator = meter.denominator;
+            lastBarStartPpq = tempoMap->lastBarStartAtPpq(ppqPosition, barCount);
+        }
+
+        const TempoMap* tempoMap = nullptr;
+        double tempoBPM = 120.0;
+        int timeSigNumerator = 4;
+        int timeSigDenominator = 4;
+        double lastBarStartPpq = 0.0;
+        int64_t barCount = 0;
+        bool playing = false;
+        double ppqPosition = 0.0;
+        double sampleRate = 48000.0;
+        int64_t timeInSamples = 0;
+    };
+}
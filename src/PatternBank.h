@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include "Sequencer.h"
+#include "TripleBuffer.h"
+
+namespace metrog
+{
+    // A pattern switch as handed to the audio thread
+    struct PatternChange
+    {
+        Pattern pattern;
+        int index = -1;             // bank slot the pattern came from
+        bool quantizeToBar = true;  // wait for the next bar line while playing
+    };
+
+    // In-memory bank of patterns, edited on the message thread. Selecting a slot copies its pattern into a
+    // preallocated handoff that the audio thread takes at the start of a block, so a switch costs one
+    // copy and no parameter changes (and no automation events). Several selections between two blocks
+    // coalesce into the last one.
+    class PatternBank
+    {
+    public:
+        static constexpr int kNumPatterns = 16;
+
+        // Message thread
+        const Pattern& getPattern (int index) const noexcept { return patterns[(size_t)clampIndex(index)]; }
+        void setPattern (int index, const Pattern& pattern) noexcept { patterns[(size_t)clampIndex(index)] = pattern; }
+
+        // Slot most recently selected (-1 = none since load)
+        int getSelectedIndex() const noexcept { return selectedIndex; }
+
+        // Publishes the slot's current contents; later edits to the slot need another select()
+        void select (int index, bool quantizeToBar) noexcept
+        {
+            PatternChange change;
+            change.index = clampIndex(index);
+            change.pattern = patterns[(size_t)change.index];
+            change.quantizeToBar = quantizeToBar;
+            selectedIndex = change.index;
+            handoff.publish(change);
+        }
+
+        // Audio thread: the latest selection not yet taken, if any
+        bool takeChange (PatternChange& out) noexcept { return handoff.take(out); }
+        bool hasChange() const noexcept { return handoff.hasNew(); }
+
+    private:
+        static int clampIndex (int index) noexcept { return index < 0 ? 0 : (index >= kNumPatterns ? kNumPatterns - 1 : index); }
+
+        std::array<Pattern, kNumPatterns> patterns{};
+        int selectedIndex = -1;
+        TripleBuffer<PatternChange> handoff;
+    };
+}
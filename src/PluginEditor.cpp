@@ -1,20 +1,6 @@
 #include "PluginEditor.h"
 #include "PluginProcessor.h"
 
-#if __has_include("BinaryData.h")
- #include "BinaryData.h"
- #define METROG_HAVE_BINDATA 1
-#else
- #define METROG_HAVE_BINDATA 0
-#endif
-
-#if __has_include("MetroAssets.h")
- #include "MetroAssets.h"
- #define METROG_HAVE_METROASSETS 1
-#else
- #define METROG_HAVE_METROASSETS 0
-#endif
-
 using APVTS = juce::AudioProcessorValueTreeState;
 
 class MetroGnomeLookAndFeel : public juce::LookAndFeel_V4
@@ -147,15 +133,37 @@ static constexpr const char* kParamDisableAll = "disableAll";
 static constexpr const char* kParamVolume = "volume";
 static constexpr const char* kParamDanceMode = "danceMode";
 static constexpr const char* kParamTimeSigNum = "timeSigNum";
+static constexpr const char* kParamAccentDownbeat = "accentDownbeat";
+static constexpr const char* kParamSwing = "swing";
+static constexpr const char* kParamGroove = "groove";
+static constexpr const char* kParamClickOffset = "clickOffsetMs";
 static juce::String stepEnabledId (int idx) { return juce::String("stepEnabled_") + juce::String(idx + 1); }
 
-// UI layout constants per MetroGnome-UI-Layout-Update
+// Sets a parameter from a menu choice, in its own units, as one host-notified change
+static void setParameterValue (MetroGnomeAudioProcessor& proc, const char* paramID, float value)
+{
+    if (auto* p = proc.getAPVTS().getParameter(paramID))
+        p->setValueNotifyingHost(p->convertTo0to1(value));
+}
+
+// UI layout constants per MetroGnome-UI-Layout-Update, at the design size (everything scales with the editor)
+static constexpr int kDesignW = 500;
+static constexpr int kDesignH = 585;
 static constexpr int kSidebarW = 100;
 static constexpr int kGutter = 16;
-static constexpr int kContentW = 368;
-static constexpr int kContentH = 553;
 static constexpr int kPad = 16; // top/bottom and right padding
 static constexpr int kSmallBtn = 22;
+static constexpr int kStepRowH = 65;
+static constexpr int kStepColumns = 16; // longer patterns wrap onto more rows
+
+static int scaledPx (int designPx, float scale) { return juce::roundToInt((float)designPx * scale); }
+
+// Beat flash: fades out over kFlashDurationNs in kFlashLevels steps (one cell repaint per step)
+static constexpr uint64_t kFlashDurationNs = 120000000ull;
+static constexpr int kFlashLevels = 12;
+
+// While the transport is stopped the editor refreshes at 20 Hz instead of every vblank
+static constexpr uint64_t kIdleRefreshIntervalNs = 50000000ull;
 
 //==============================================================================
 MetroGnomeAudioProcessorEditor::MetroGnomeAudioProcessorEditor (MetroGnomeAudioProcessor& p)
@@ -164,12 +172,17 @@ MetroGnomeAudioProcessorEditor::MetroGnomeAudioProcessorEditor (MetroGnomeAudioP
     setLookAndFeel (&laf);
     setWantsKeyboardFocus (false);
 
-    // Fixed size per UI layout update
-    setResizable (false, false);
-    setSize (500, 585);
+    // Resizable at the design aspect ratio; resized() rescales the layout
+    setResizable (true, true);
+    setResizeLimits (kDesignW * 3 / 4, kDesignH * 3 / 4, kDesignW * 2, kDesignH * 2);
+    if (auto* constrainer = getConstrainer())
+        constrainer->setFixedAspectRatio ((double)kDesignW / (double)kDesignH);
+    setSize (kDesignW, kDesignH);
     setOpaque (true); // we'll always paint background
 
-    loadBackgroundImages();
+    // Background images decode on a background thread; until then the content area shows a plain placeholder
+    backgroundImages->addChangeListener(this);
+    takeBackgroundImages();
 
     enableAllBtn.setButtonText("Enable All");
     disableAllBtn.setButtonText("Disable All");
@@ -179,7 +192,7 @@ MetroGnomeAudioProcessorEditor::MetroGnomeAudioProcessorEditor (MetroGnomeAudioP
     // Sliders
     stepsSlider.setSliderStyle(juce::Slider::RotaryHorizontalVerticalDrag);
     stepsSlider.setTextBoxStyle(juce::Slider::TextBoxBelow, false, 60, 20);
-    stepsSlider.setRange(1.0, 16.0, 1.0);
+    stepsSlider.setRange(1.0, (double)metrog::StepMask::kMaxSteps, 1.0);
     stepsSlider.setDoubleClickReturnValue(true, 8.0);
     stepsSlider.setTitle("Steps");
     stepsSlider.setTooltip("Number of sequencer steps (independent from timing)");
@@ -289,15 +302,15 @@ MetroGnomeAudioProcessorEditor::MetroGnomeAudioProcessorEditor (MetroGnomeAudioP
     addAndMakeVisible(danceToggle);
     danceAttachment = std::make_unique<APVTS::ButtonAttachment>(apvts, kParamDanceMode, danceToggle);
 
-    // Step toggles 16
-    for (int i = 0; i < 16; ++i)
+    // Step toggles, one per possible step (only the first stepCount are shown)
+    for (int i = 0; i < metrog::StepMask::kMaxSteps; ++i)
     {
         auto* tb = new juce::ToggleButton("");
         tb->setClickingTogglesState(true);
         tb->setTriggeredOnMouseDown(true);
         tb->setInterceptsMouseClicks(true, false);
         tb->setColour(juce::ToggleButton::textColourId, juce::Colours::transparentWhite);
-        tb->setTooltip("Enable step " + juce::String(i + 1));
+        tb->setTooltip("Enable step " + juce::String(i + 1) + " (wheel: velocity, shift+wheel: accent, alt+wheel: ratchets)");
         tb->setWantsKeyboardFocus(false);
         tb->setAlpha(0.0f); // invisible overlay
         stepToggles.add(tb);
@@ -307,8 +320,18 @@ MetroGnomeAudioProcessorEditor::MetroGnomeAudioProcessorEditor (MetroGnomeAudioP
         stepAttachments.add(att);
     }
 
-    // 60 FPS timer for smooth UI
-    startTimerHz(60);
+    // Cache raw values read every frame
+    stepCountValue = apvts.getRawParameterValue(kParamStepCount);
+    danceModeValue = apvts.getRawParameterValue(kParamDanceMode);
+
+    // Initial display state; the first paint draws everything
+    const auto ui = processor.getUiSnapshot();
+    displayedUiGeneration = ui.generation;
+    displayedStep = ui.currentStep;
+    displayedParity = ui.danceParity;
+    displayedDance = danceModeValue != nullptr && danceModeValue->load() >= 0.5f;
+    takeStepValues();
+    lastLayoutStepCount = stepCountValue != nullptr ? juce::jlimit(1, metrog::StepMask::kMaxSteps, (int)stepCountValue->load()) : 8;
 
     // Ensure overlay step toggles are positioned on first open
     resized();
@@ -316,249 +339,344 @@ MetroGnomeAudioProcessorEditor::MetroGnomeAudioProcessorEditor (MetroGnomeAudioP
 
 MetroGnomeAudioProcessorEditor::~MetroGnomeAudioProcessorEditor()
 {
+    backgroundImages->removeChangeListener(this);
     setLookAndFeel (nullptr);
-    stopTimer();
 }
 
-void MetroGnomeAudioProcessorEditor::loadBackgroundImages()
+void MetroGnomeAudioProcessorEditor::takeBackgroundImages()
+{
+    if (! backgroundImages->isLoaded())
+        return;
+
+    bgA = backgroundImages->getImageA();
+    bgB = backgroundImages->getImageB();
+    invalidateBackgroundLayers();
+    repaint(getContentBounds());
+}
+
+void MetroGnomeAudioProcessorEditor::changeListenerCallback (juce::ChangeBroadcaster*)
+{
+    takeBackgroundImages();
+}
+
+void MetroGnomeAudioProcessorEditor::updateLayout()
+{
+    const float scale = (float)getWidth() / (float)kDesignW;
+    layout.scale = scale;
+
+    // Sidebar on the left, content rect to the right of it
+    layout.sidebar = getLocalBounds().withWidth(scaledPx(kSidebarW, scale));
+    layout.content = getLocalBounds().withTrimmedLeft(layout.sidebar.getWidth() + scaledPx(kGutter, scale))
+                                     .withTrimmedRight(scaledPx(kPad, scale))
+                                     .reduced(0, scaledPx(kPad, scale));
+
+    // Step lights (and their click targets) - rows of up to kStepColumns at the bottom of the content rect,
+    // shrinking in height once the grid would cover more than half of it
+    const int steps = juce::jmax(1, lastLayoutStepCount);
+    const int rows = (steps + kStepColumns - 1) / kStepColumns;
+    layout.columns = juce::jmin(steps, kStepColumns);
+    layout.cellWidth = layout.content.getWidth() / layout.columns;
+    layout.cellHeight = juce::jmin(scaledPx(kStepRowH, scale), layout.content.getHeight() / 2 / rows);
+    layout.stepGrid = layout.content.withTrimmedTop(layout.content.getHeight() - rows * layout.cellHeight);
+
+    // DSP load meter pinned to the bottom of the sidebar
+    auto sb = layout.sidebar.reduced(scaledPx(8, scale), scaledPx(12, scale));
+    layout.meter = sb.removeFromBottom(scaledPx(30, scale));
+}
+
+juce::Rectangle<int> MetroGnomeAudioProcessorEditor::getStepCellBounds (int index) const
+{
+    const auto& grid = layout.stepGrid;
+    return { grid.getX() + (index % layout.columns) * layout.cellWidth,
+             grid.getY() + (index / layout.columns) * layout.cellHeight,
+             layout.cellWidth, layout.cellHeight };
+}
+
+juce::Rectangle<int> MetroGnomeAudioProcessorEditor::getProgressBarBounds (juce::Rectangle<int> cell) const
+{
+    // Thin bar along the bottom of the current cell, inside its rounded corners
+    const int inset = scaledPx(12, layout.scale);
+    return cell.reduced(inset, 0).withY(cell.getBottom() - inset).withHeight(juce::jmax(1, scaledPx(4, layout.scale)));
+}
+
+int MetroGnomeAudioProcessorEditor::getStepAt (juce::Point<int> position) const
 {
-    // Try embedded BinaryData first for reliable asset access inside DAWs
-#if METROG_HAVE_BINDATA
-    // Try direct symbol names generated by juce_add_binary_data
-    if (! bgA.isValid())
-    {
-        #if defined(BinaryData_metrognome_a_png)
-        if (BinaryData::metrognome_a_pngSize > 0)
-            bgA = juce::ImageFileFormat::loadFrom(BinaryData::metrognome_a_png, BinaryData::metrognome_a_pngSize);
-        #else
-        // Also try via getNamedResource in case symbol names differ
-        int sz = 0;
-        if (auto* d = BinaryData::getNamedResource("metrognome-a_png", sz))
-            bgA = juce::ImageFileFormat::loadFrom(d, (size_t)sz);
-        if (! bgA.isValid())
-            if (auto* d2 = BinaryData::getNamedResource("metrognome_a_png", sz))
-                bgA = juce::ImageFileFormat::loadFrom(d2, (size_t)sz);
-        #endif
+    const int n = juce::jmax(1, lastLayoutStepCount);
+    for (int idx = 0; idx < n; ++idx)
+        if (getStepCellBounds(idx).contains(position))
+            return idx;
+    return -1;
+}
+
+void MetroGnomeAudioProcessorEditor::drawStepCell (juce::Graphics& g, int index, bool isCurrent) const
+{
+    const auto cell = getStepCellBounds(index).toFloat();
+    auto color = displayedStepMask.test(index) ? juce::Colours::limegreen : juce::Colours::darkred.darker(0.6f);
+    if (isCurrent)
+        color = color.brighter(0.8f);
+
+    // Quieter steps are more transparent; accented steps get a light outline
+    const float velocity = (float)displayedVelocities[(size_t)index] / 127.0f;
+    const float corner = 10.0f * layout.scale;
+    g.setColour (color.withAlpha(0.35f + 0.5f * velocity));
+    g.fillRoundedRectangle(cell, corner);
+
+    const bool accent = displayedAccents.test(index);
+    g.setColour(accent ? juce::Colours::white.withAlpha(0.85f) : juce::Colours::black.withAlpha(0.6f));
+    g.drawRoundedRectangle(cell, corner, (accent ? 3.0f : 2.0f) * layout.scale);
+
+    // Ratchets: one tick per click along the top of the cell
+    const int ratchets = displayedRatchets[(size_t)index];
+    if (ratchets > 1)
+    {
+        const auto ticks = cell.reduced(corner, 0.0f).withTrimmedTop(4.0f * layout.scale).withHeight(5.0f * layout.scale);
+        const float spacing = ticks.getWidth() / (float)ratchets;
+        g.setColour(juce::Colours::white.withAlpha(0.8f));
+        for (int i = 0; i < ratchets; ++i)
+            g.fillRect(juce::Rectangle<float>(ticks.getX() + spacing * ((float)i + 0.5f) - layout.scale, ticks.getY(), 2.0f * layout.scale, ticks.getHeight()));
     }
-    if (! bgB.isValid())
-    {
-        #if defined(BinaryData_metrognome_b_png)
-        if (BinaryData::metrognome_b_pngSize > 0)
-            bgB = juce::ImageFileFormat::loadFrom(BinaryData::metrognome_b_png, BinaryData::metrognome_b_pngSize);
-        #else
-        int sz = 0;
-        if (auto* d = BinaryData::getNamedResource("metrognome-b_png", sz))
-            bgB = juce::ImageFileFormat::loadFrom(d, (size_t)sz);
-        if (! bgB.isValid())
-            if (auto* d2 = BinaryData::getNamedResource("metrognome_b_png", sz))
-                bgB = juce::ImageFileFormat::loadFrom(d2, (size_t)sz);
-        #endif
+}
+
+void MetroGnomeAudioProcessorEditor::takeStepValues()
+{
+    displayedStepMask = processor.getStepMask();
+    displayedAccents = processor.getAccentSteps();
+    for (int i = 0; i < metrog::StepMask::kMaxSteps; ++i)
+    {
+        displayedVelocities[(size_t)i] = (uint8_t)processor.getStepVelocity(i);
+        displayedRatchets[(size_t)i] = (uint8_t)processor.getStepRatchet(i);
     }
-#endif
+}
+
+void MetroGnomeAudioProcessorEditor::invalidateBackgroundLayers()
+{
+    for (auto& set : layerSets)
+        set = {};
+}
 
-#if METROG_HAVE_METROASSETS
-    // Our in-repo fallback embedded resources (namespace MetroAssets)
-    if (! bgA.isValid())
+void MetroGnomeAudioProcessorEditor::invalidateStepCellLayers()
+{
+    for (auto& set : layerSets)
+        for (auto& layer : set.layers)
+            layer.composite = {};
+}
+
+const MetroGnomeAudioProcessorEditor::BackgroundLayer& MetroGnomeAudioProcessorEditor::getBackgroundLayer (int parityIndex, float displayScale)
+{
+    // Find this display scale's set, or recycle the least recently used one
+    auto* set = &layerSets[0];
+    for (auto& candidate : layerSets)
     {
-        if (MetroAssets::metrognomea_pngSize > 0)
-            bgA = juce::ImageFileFormat::loadFrom(MetroAssets::metrognomea_png, MetroAssets::metrognomea_pngSize);
-        if (! bgA.isValid())
+        if (candidate.displayScale == displayScale)
         {
-            int sz = 0;
-            if (auto* d = MetroAssets::getNamedResource("metrognome-a_png", sz))
-                bgA = juce::ImageFileFormat::loadFrom(d, (size_t)sz);
-            if (! bgA.isValid())
-                if (auto* d2 = MetroAssets::getNamedResource("metrognome_a_png", sz))
-                    bgA = juce::ImageFileFormat::loadFrom(d2, (size_t)sz);
-            if (! bgA.isValid())
-                if (auto* d3 = MetroAssets::getNamedResource("metrognomea_png", sz))
-                    bgA = juce::ImageFileFormat::loadFrom(d3, (size_t)sz);
+            set = &candidate;
+            break;
         }
+        if (candidate.lastUsed < set->lastUsed)
+            set = &candidate;
     }
-    if (! bgB.isValid())
+    if (set->displayScale != displayScale)
     {
-        if (MetroAssets::metrognomeb_pngSize > 0)
-            bgB = juce::ImageFileFormat::loadFrom(MetroAssets::metrognomeb_png, MetroAssets::metrognomeb_pngSize);
-        if (! bgB.isValid())
-        {
-            int sz = 0;
-            if (auto* d = MetroAssets::getNamedResource("metrognome-b_png", sz))
-                bgB = juce::ImageFileFormat::loadFrom(d, (size_t)sz);
-            if (! bgB.isValid())
-                if (auto* d2 = MetroAssets::getNamedResource("metrognome_b_png", sz))
-                    bgB = juce::ImageFileFormat::loadFrom(d2, (size_t)sz);
-            if (! bgB.isValid())
-                if (auto* d3 = MetroAssets::getNamedResource("metrognomeb_png", sz))
-                    bgB = juce::ImageFileFormat::loadFrom(d3, (size_t)sz);
-        }
+        *set = {};
+        set->displayScale = displayScale;
     }
-#endif
+    set->lastUsed = ++layerUseCounter;
 
-    // Fallback to disk paths (useful during development and standalone helper)
-    auto assetsDir = juce::File::getSpecialLocation(juce::File::currentApplicationFile).getSiblingFile("assets").getChildFile("images");
-    juce::File projDir = juce::File::getCurrentWorkingDirectory();
-    juce::File altDir = projDir.getChildFile("assets").getChildFile("images");
+    const float scale = displayScale;
+    auto& layer = set->layers[(size_t)parityIndex];
+    const auto contentRect = getContentBounds();
+    const int w = juce::jmax(1, juce::roundToInt((float)contentRect.getWidth() * scale));
+    const int h = juce::jmax(1, juce::roundToInt((float)contentRect.getHeight() * scale));
 
-    auto loadIfExists = [] (const juce::File& f) -> juce::Image
+    if (! layer.scaled.isValid())
     {
-        if (f.existsAsFile())
-            return juce::ImageFileFormat::loadFrom(f);
-        return {};
-    };
-
-    if (! bgA.isValid())
-    {
-        bgA = loadIfExists(assetsDir.getChildFile("metrognome-a.png"));
-        if (! bgA.isValid()) bgA = loadIfExists(altDir.getChildFile("metrognome-a.png"));
+        const auto& source = (parityIndex == 0) ? bgA : bgB;
+        if (source.isValid())
+            layer.scaled = source.rescaled(w, h, juce::Graphics::highResamplingQuality);
+        else
+            layer.scaled = juce::Image(juce::Image::RGB, w, h, true); // cleared to black (placeholder while decoding)
     }
-    if (! bgB.isValid())
+
+    if (! layer.composite.isValid())
     {
-        bgB = loadIfExists(assetsDir.getChildFile("metrognome-b.png"));
-        if (! bgB.isValid()) bgB = loadIfExists(altDir.getChildFile("metrognome-b.png"));
+        layer.composite = layer.scaled.createCopy();
+        juce::Graphics lg (layer.composite);
+        lg.addTransform(juce::AffineTransform::translation((float)-contentRect.getX(), (float)-contentRect.getY()).scaled(scale));
+
+        const int n = juce::jmax(1, lastLayoutStepCount);
+        for (int idx = 0; idx < n; ++idx)
+            drawStepCell(lg, idx, false);
     }
+
+    return layer;
 }
 
 void MetroGnomeAudioProcessorEditor::paint (juce::Graphics& g)
 {
     // Choose background based on dance toggle and current step parity
-    const auto* dancePtr = processor.getAPVTS().getRawParameterValue(kParamDanceMode);
-    const bool dance = (dancePtr != nullptr) ? (dancePtr->load() >= 0.5f) : false;
-    const int parity = processor.getDanceParity();
-    const int stepIdx = processor.getCurrentStepIndex();
-
-    juce::Image bg;
-    if (dance)
-        bg = (parity % 2 == 0) ? bgA : bgB;
+    int parityIndex = 0;
+    if (displayedDance)
+        parityIndex = (displayedParity % 2 == 0) ? 0 : 1;
     else
-        bg = bgA.isValid() ? bgA : bgB;
+        parityIndex = bgA.isValid() ? 0 : 1;
 
     // Sidebar background (solid) first
-    auto sidebarColour = findColour(juce::Slider::rotarySliderFillColourId).darker(0.35f);
-    g.setColour(sidebarColour);
-    g.fillRect(juce::Rectangle<int>(0, 0, kSidebarW, getHeight()));
-
-    // Content rect to the right of the sidebar
-    juce::Rectangle<int> contentRect(kSidebarW + kGutter, kPad, kContentW, kContentH);
-
-    // Draw background only within content rect
-    if (bg.isValid())
-        g.drawImageWithin(bg, contentRect.getX(), contentRect.getY(), contentRect.getWidth(), contentRect.getHeight(), juce::RectanglePlacement::stretchToFit);
-    else
+    if (g.clipRegionIntersects(layout.sidebar))
     {
-        g.setColour(juce::Colours::black);
-        g.fillRect(contentRect);
-       #if JUCE_DEBUG
-        juce::String msg = "Background image not found. Tried BinaryData, MetroAssets, and disk paths.";
-        g.setColour(juce::Colours::white.withAlpha(0.8f));
-        g.drawFittedText(msg, contentRect.reduced(20), juce::Justification::centred, 3);
-       #endif
+        auto sidebarColour = findColour(juce::Slider::rotarySliderFillColourId).darker(0.35f);
+        g.setColour(sidebarColour);
+        g.fillRect(layout.sidebar);
     }
 
-    // Step lights overlay - single row at bottom of content rect
-    constexpr int rowHeight = 65;
-    auto rowArea = contentRect.removeFromBottom(rowHeight);
+    // Content: one blit of the cached background + idle cells, drawn at physical pixel size
+    const auto contentRect = getContentBounds();
+    if (g.clipRegionIntersects(contentRect))
+    {
+        const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+        const auto& layer = getBackgroundLayer(parityIndex, scale);
 
-    const int pad = 0;
+        g.setImageResamplingQuality(juce::Graphics::lowResamplingQuality);
+        g.drawImage(layer.composite, contentRect.toFloat());
 
-    // Safe default for step count if APVTS not yet initialised
-    int safeStepCount = 8;
-    if (const auto* sc = processor.getAPVTS().getRawParameterValue(kParamStepCount))
-        safeStepCount = juce::jlimit(1, 16, (int)sc->load());
+       #if JUCE_DEBUG
+        if (backgroundImages->isLoaded() && ! bgA.isValid() && ! bgB.isValid())
+        {
+            juce::String msg = "Background image not found. Tried BinaryData, MetroAssets, and disk paths.";
+            g.setColour(juce::Colours::white.withAlpha(0.8f));
+            g.drawFittedText(msg, contentRect.reduced(20), juce::Justification::centred, 3);
+        }
+       #endif
 
-    const int n = safeStepCount;
-    const int cellW = (rowArea.getWidth() - pad * (n - 1)) / juce::jmax(1, n);
-    const int cellH = rowArea.getHeight();
+        // Highlighted cell: restore the plain background under it, then draw it lit
+        const int n = juce::jmax(1, lastLayoutStepCount);
+        if (displayedStep >= 0)
+        {
+            const int idx = displayedStep % n;
+            const auto cell = getStepCellBounds(idx);
+            if (g.clipRegionIntersects(cell))
+            {
+                juce::Graphics::ScopedSaveState saved (g);
+                g.reduceClipRegion(cell);
+                g.drawImage(layer.scaled, contentRect.toFloat());
+                drawStepCell(g, idx, true);
+
+                if (displayedProgressPx > 0)
+                {
+                    g.setColour(juce::Colours::white.withAlpha(0.85f));
+                    g.fillRect(getProgressBarBounds(cell).withWidth(displayedProgressPx));
+                }
+            }
+        }
 
-    for (int idx = 0; idx < n; ++idx)
-    {
-        auto x = rowArea.getX() + idx * (cellW + pad);
-        auto y = rowArea.getY();
-        juce::Rectangle<int> cell (x, y, cellW, cellH);
+        // Beat flash over the clicked cell, fading out from its audible time
+        if (displayedFlashLevel > 0 && displayedFlashStep >= 0)
+        {
+            const auto cell = getStepCellBounds(displayedFlashStep % n);
+            if (g.clipRegionIntersects(cell))
+            {
+                g.setColour(juce::Colours::white.withAlpha(0.6f * (float)displayedFlashLevel / (float)kFlashLevels));
+                g.fillRoundedRectangle(cell.toFloat(), 10.0f * layout.scale);
+            }
+        }
+    }
 
-        bool enabled = false;
-        if (auto* p = processor.getAPVTS().getRawParameterValue(stepEnabledId(idx)))
-            enabled = p->load() >= 0.5f;
+    if (g.clipRegionIntersects(layout.meter))
+        paintDspLoadMeter(g);
+}
 
-        const bool isCurrent = (idx == (stepIdx % juce::jmax(1, n)));
+void MetroGnomeAudioProcessorEditor::paintDspLoadMeter (juce::Graphics& g)
+{
+    if (layout.meter.isEmpty())
+        return;
+
+    const float s = layout.scale;
+    auto area = layout.meter.toFloat();
+    auto labelArea = area.removeFromTop(14.0f * s);
+    auto barArea = area.reduced(0.0f, 2.0f * s);
+
+    const float average = juce::jlimit(0.0f, 1.0f, dspLoadStats.getAverageLoad());
+    const float peak = juce::jlimit(0.0f, 1.0f, dspLoadStats.getPeakHoldLoad());
+    const bool risk = dspLoadStats.hasRecentXrunRisk();
+
+    g.setFont(11.0f * s);
+    g.setColour(juce::Colours::white.withAlpha(0.8f));
+    g.drawText("DSP " + juce::String(juce::roundToInt(average * 100.0f)) + "%", labelArea, juce::Justification::centredLeft, false);
+    if (risk)
+    {
+        g.setColour(juce::Colours::red);
+        g.drawText("XRUN", labelArea, juce::Justification::centredRight, false);
+    }
 
-        auto color = enabled ? juce::Colours::limegreen : juce::Colours::darkred.darker(0.6f);
-        if (isCurrent)
-            color = color.brighter(0.8f);
+    g.setColour(juce::Colours::black.withAlpha(0.6f));
+    g.fillRoundedRectangle(barArea, 3.0f * s);
 
-        g.setColour (color.withAlpha(0.85f));
-        g.fillRoundedRectangle(cell.toFloat(), 10.0f);
+    const auto fillColour = average < 0.5f ? juce::Colours::limegreen
+                          : average < metrog::DspLoadStats::kRiskThreshold ? juce::Colours::orange
+                          : juce::Colours::red;
+    g.setColour(fillColour);
+    g.fillRoundedRectangle(barArea.withWidth(barArea.getWidth() * average), 3.0f * s);
 
-        g.setColour(juce::Colours::black.withAlpha(0.6f));
-        g.drawRoundedRectangle(cell.toFloat(), 10.0f, 2.0f);
-    }
+    // Peak-hold tick
+    const float peakX = barArea.getX() + barArea.getWidth() * peak;
+    g.setColour(risk ? juce::Colours::red : juce::Colours::white);
+    g.drawLine(peakX, barArea.getY(), peakX, barArea.getBottom(), 2.0f * s);
 }
 
 void MetroGnomeAudioProcessorEditor::resized()
 {
+    updateLayout();
+    const float s = layout.scale;
+
     // Sidebar layout
-    juce::Rectangle<int> sidebar(0, 0, kSidebarW, getHeight());
-    auto sb = sidebar.reduced(8, 12);
+    auto sb = layout.sidebar.reduced(scaledPx(8, s), scaledPx(12, s));
 
-    const int labelH = 18;
-    const int knobH = 84;
-    const int vgap = 12;
+    const int labelH = scaledPx(18, s);
+    const int knobH = scaledPx(84, s);
+    const int vgap = scaledPx(12, s);
+    for (auto* lbl : { &stepsLabel, &beatsPerBarLabel, &volumeLabel })
+        lbl->setFont(lbl->getFont().withHeight(15.0f * s));
 
     // Steps
     stepsLabel.setBounds(sb.removeFromTop(labelH));
-    stepsLabel.setJustificationType(juce::Justification::centred);
     stepsSlider.setBounds(sb.removeFromTop(knobH));
     sb.removeFromTop(vgap);
 
     // Time Sig
     beatsPerBarLabel.setBounds(sb.removeFromTop(labelH));
-    beatsPerBarLabel.setJustificationType(juce::Justification::centred);
     timeSigSlider.setBounds(sb.removeFromTop(knobH));
     sb.removeFromTop(vgap);
 
     // Volume
     volumeLabel.setBounds(sb.removeFromTop(labelH));
-    volumeLabel.setJustificationType(juce::Justification::centred);
     volumeSlider.setBounds(sb.removeFromTop(knobH));
     sb.removeFromTop(vgap);
 
     // Dance toggle below rotaries
-    const int danceH = 24;
-    danceToggle.setBounds(sb.removeFromTop(danceH));
+    danceToggle.setBounds(sb.removeFromTop(scaledPx(24, s)));
 
     // Content layout
-    juce::Rectangle<int> contentRect(kSidebarW + kGutter, kPad, kContentW, kContentH);
-
-    // Step row
-    constexpr int rowHeight = 57;
-    auto rowArea = contentRect.removeFromBottom(rowHeight);
-
-    // Small buttons above step row, right-aligned inside content
-    const int spacing = 8;
-    int btnY = rowArea.getY() - kSmallBtn - 6;
-    int rightX = kSidebarW + kGutter + kContentW; // content right edge
-    disableAllBtn.setBounds(rightX - kSmallBtn, btnY, kSmallBtn, kSmallBtn);
-    enableAllBtn.setBounds(disableAllBtn.getX() - spacing - kSmallBtn, btnY, kSmallBtn, kSmallBtn);
-
-    // Overlay step toggles aligned to cells
-    const int pad = 0;
-    int safeStepCount = 8;
-    if (const auto* sc = processor.getAPVTS().getRawParameterValue(kParamStepCount))
-        safeStepCount = juce::jlimit(1, 16, (int)sc->load());
+    if (layout.content != layerContentBounds)
+    {
+        layerContentBounds = layout.content;
+        invalidateBackgroundLayers();
+    }
+    invalidateStepCellLayers(); // cell geometry depends on the step count
 
-    const int n = safeStepCount;
-    const int cellW = (rowArea.getWidth() - pad * (n - 1)) / juce::jmax(1, n);
-    const int cellH = rowArea.getHeight();
+    // Small buttons above the step grid, right-aligned inside content
+    const int small = scaledPx(kSmallBtn, s);
+    const int btnY = layout.stepGrid.getY() - small - scaledPx(6, s);
+    disableAllBtn.setBounds(layout.content.getRight() - small, btnY, small, small);
+    enableAllBtn.setBounds(disableAllBtn.getX() - scaledPx(8, s) - small, btnY, small, small);
 
+    // Overlay step toggles aligned to the painted cells
+    const int n = juce::jmax(1, lastLayoutStepCount);
     for (int idx = 0; idx < stepToggles.size(); ++idx)
     {
         if (auto* tb = stepToggles[idx])
         {
             if (idx < n)
             {
-                auto x = rowArea.getX() + idx * (cellW + pad);
-                auto y = rowArea.getY();
-                juce::Rectangle<int> cell (x, y, cellW, cellH);
-                tb->setBounds(cell);
+                tb->setBounds(getStepCellBounds(idx));
                 tb->toFront(false);
                 tb->setAlpha(0.001f); // visually hidden but clickable
                 tb->setColour(juce::ToggleButton::textColourId, juce::Colours::transparentBlack);
@@ -571,17 +689,367 @@ void MetroGnomeAudioProcessorEditor::resized()
     }
 }
 
-void MetroGnomeAudioProcessorEditor::timerCallback()
+void MetroGnomeAudioProcessorEditor::refreshFrame()
+{
+    // One consistent copy of the audio thread's playhead state per frame
+    const auto ui = processor.getUiSnapshot();
+
+    // Stopped with no flash pending or fading: refresh at a low rate only (parameter edits, meter).
+    // The snapshot read above is the only per-vblank cost, and it sees play start on the next frame.
+    const uint64_t nowNs = metrog::monotonicNanos();
+    const bool idle = ui.playing == 0 && numPendingGates == 0 && displayedFlashLevel == 0;
+    if (idle && nowNs - lastRefreshNs < kIdleRefreshIntervalNs)
+        return;
+    lastRefreshNs = nowNs;
+
+    updateDspLoadMeter();
+    updateSequencerDisplay(ui);
+    updatePlayheadProgress(ui);
+    updateBeatFlash(nowNs);
+    checkClickExport();
+}
+
+void MetroGnomeAudioProcessorEditor::mouseDown (const juce::MouseEvent& e)
+{
+    if (e.mods.isPopupMenu())
+        showOptionsMenu();
+}
+
+void MetroGnomeAudioProcessorEditor::mouseWheelMove (const juce::MouseEvent& e, const juce::MouseWheelDetails& wheel)
+{
+    // Over a step cell (the toggles pass wheel events up): velocity in steps of 8; with shift, the accent
+    // on (up) or off (down); with alt, the ratchet count
+    const int step = getStepAt(e.getEventRelativeTo(this).getPosition());
+    if (step < 0 || wheel.deltaY == 0.0f)
+        return;
+
+    const bool up = (wheel.deltaY > 0.0f) != wheel.isReversed;
+    if (e.mods.isShiftDown())
+        processor.setStepAccent(step, up);
+    else if (e.mods.isAltDown())
+        processor.setStepRatchet(step, processor.getStepRatchet(step) + (up ? 1 : -1));
+    else
+        processor.setStepVelocity(step, processor.getStepVelocity(step) + (up ? 8 : -8));
+}
+
+void MetroGnomeAudioProcessorEditor::showOptionsMenu()
+{
+    // Visual latency: delays the beat flash to match output latency the host doesn't report
+    static constexpr int kLatencyChoicesMs[] = { 0, 5, 10, 15, 20, 30, 40, 60, 80, 100, 150, 200 };
+    const int current = juce::roundToInt(processor.getVisualLatencyMs());
+
+    // Pattern bank: switch at the next bar line or immediately, or store the current steps into a slot
+    static constexpr int kSwitchAtBarId = 100, kSwitchNowId = 200, kStoreId = 300, kPolyrhythmId = 400, kAccentDownbeatId = 99;
+    static constexpr int kSwingId = 500, kGrooveId = 600, kClickOffsetId = 700, kExportId = 800;
+    const int active = processor.getActivePatternIndex();
+    juce::PopupMenu switchAtBar, switchNow, store;
+    for (int i = 0; i < metrog::PatternBank::kNumPatterns; ++i)
+    {
+        const auto name = "Pattern " + juce::String(i + 1);
+        switchAtBar.addItem(kSwitchAtBarId + i, name, true, i == active);
+        switchNow.addItem(kSwitchNowId + i, name, true, i == active);
+        store.addItem(kStoreId + i, name);
+    }
+
+    juce::PopupMenu menu;
+    menu.addSectionHeader("Visual latency");
+    for (size_t i = 0; i < std::size(kLatencyChoicesMs); ++i)
+        menu.addItem((int)i + 1, juce::String(kLatencyChoicesMs[i]) + " ms", true, kLatencyChoicesMs[i] == current);
+    menu.addSectionHeader("Patterns");
+    menu.addSubMenu("Switch at next bar", switchAtBar);
+    menu.addSubMenu("Switch now", switchNow);
+    menu.addSubMenu("Store current steps as", store);
+
+    // Polyrhythm: one extra lane clicking N times per bar against the main steps (0 = off)
+    static constexpr int kPolyrhythmChoices[] = { 0, 2, 3, 5, 6, 7 };
+    const auto& laneConfig = processor.getLaneConfig();
+    const int currentPoly = laneConfig.numLanes > 0 ? laneConfig.lanes[0].subdivisionsPerBar : 0;
+    juce::PopupMenu polyrhythm;
+    for (size_t i = 0; i < std::size(kPolyrhythmChoices); ++i)
+        polyrhythm.addItem(kPolyrhythmId + kPolyrhythmChoices[i],
+                           kPolyrhythmChoices[i] == 0 ? juce::String("Off") : juce::String(kPolyrhythmChoices[i]) + " per bar",
+                           true, kPolyrhythmChoices[i] == currentPoly);
+    menu.addSubMenu("Polyrhythm lane", polyrhythm);
+
+    auto* accentDownbeat = processor.getAPVTS().getParameter(kParamAccentDownbeat);
+    menu.addSeparator();
+    menu.addItem(kAccentDownbeatId, "Accent downbeats", accentDownbeat != nullptr, accentDownbeat != nullptr && accentDownbeat->getValue() >= 0.5f);
+
+    // Timing feel: swing, groove template and click offset (negative = early, e.g. for monitoring latency)
+    static constexpr int kSwingChoices[] = { 50, 54, 58, 62, 66, 70, 75 };
+    static constexpr int kClickOffsetChoicesMs[] = { -40, -30, -20, -10, -5, 0, 5, 10, 20 };
+    auto& apvts = processor.getAPVTS();
+    const auto* swingValue = apvts.getRawParameterValue(kParamSwing);
+    const auto* grooveValue = apvts.getRawParameterValue(kParamGroove);
+    const auto* offsetValue = apvts.getRawParameterValue(kParamClickOffset);
+    juce::PopupMenu swing, groove, clickOffset;
+    for (int percent : kSwingChoices)
+        swing.addItem(kSwingId + percent, juce::String(percent) + "%", true, swingValue != nullptr && juce::roundToInt(swingValue->load()) == percent);
+    const auto& grooves = metrog::grooveTemplates();
+    for (size_t i = 0; i < grooves.size(); ++i)
+        groove.addItem(kGrooveId + (int)i, grooves[i].name, true, grooveValue != nullptr && juce::roundToInt(grooveValue->load()) == (int)i);
+    for (size_t i = 0; i < std::size(kClickOffsetChoicesMs); ++i)
+        clickOffset.addItem(kClickOffsetId + (int)i, juce::String(kClickOffsetChoicesMs[i]) + " ms", true,
+                            offsetValue != nullptr && juce::roundToInt(offsetValue->load()) == kClickOffsetChoicesMs[i]);
+    menu.addSubMenu("Swing", swing);
+    menu.addSubMenu("Groove", groove);
+    menu.addSubMenu("Click offset", clickOffset);
+
+    // Click track export: the current pattern at the host's last tempo, rendered in the background
+    static constexpr int kExportBarChoices[] = { 8, 16, 32, 64, 128, 256, 512 };
+    menu.addSeparator();
+    if (clickExport != nullptr)
+        menu.addItem(kExportId, "Exporting click track... " + juce::String(juce::roundToInt(clickExport->getProgress() * 100.0f)) + "%", false);
+    else
+    {
+        juce::PopupMenu exportBars;
+        for (size_t i = 0; i < std::size(kExportBarChoices); ++i)
+            exportBars.addItem(kExportId + (int)i, juce::String(kExportBarChoices[i]) + " bars");
+        menu.addSubMenu("Export click track", exportBars);
+    }
+
+    juce::Component::SafePointer<MetroGnomeAudioProcessorEditor> safeThis (this);
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(this).withMousePosition(),
+                       [safeThis] (int result)
+                       {
+                           if (safeThis == nullptr || result <= 0)
+                               return;
+                           auto& proc = safeThis->processor;
+                           if (result <= (int)std::size(kLatencyChoicesMs))
+                               proc.setVisualLatencyMs((float)kLatencyChoicesMs[result - 1]);
+                           else if (result == kAccentDownbeatId)
+                           {
+                               if (auto* p = proc.getAPVTS().getParameter(kParamAccentDownbeat))
+                                   p->setValueNotifyingHost(p->getValue() >= 0.5f ? 0.0f : 1.0f);
+                           }
+                           else if (result >= kExportId)
+                               safeThis->chooseExportFile(kExportBarChoices[result - kExportId]);
+                           else if (result >= kClickOffsetId)
+                               setParameterValue(proc, kParamClickOffset, (float)kClickOffsetChoicesMs[result - kClickOffsetId]);
+                           else if (result >= kGrooveId)
+                               setParameterValue(proc, kParamGroove, (float)(result - kGrooveId));
+                           else if (result >= kSwingId)
+                               setParameterValue(proc, kParamSwing, (float)(result - kSwingId));
+                           else if (result >= kPolyrhythmId)
+                           {
+                               metrog::LaneConfig config;
+                               config.numLanes = result > kPolyrhythmId ? 1 : 0;
+                               config.lanes[0].subdivisionsPerBar = result - kPolyrhythmId;
+                               config.lanes[0].stepCount = result - kPolyrhythmId;
+                               proc.setLaneConfig(config);
+                           }
+                           else if (result >= kStoreId)
+                               proc.storePattern(result - kStoreId);
+                           else if (result >= kSwitchNowId)
+                               proc.selectPattern(result - kSwitchNowId, false);
+                           else if (result >= kSwitchAtBarId)
+                               proc.selectPattern(result - kSwitchAtBarId, true);
+                       });
+}
+
+void MetroGnomeAudioProcessorEditor::chooseExportFile (int bars)
+{
+    exportChooser = std::make_unique<juce::FileChooser>("Export click track",
+        juce::File::getSpecialLocation(juce::File::userMusicDirectory).getChildFile("Click track.wav"), "*.wav;*.flac");
+    const auto flags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+                     | juce::FileBrowserComponent::warnAboutOverwriting;
+
+    juce::Component::SafePointer<MetroGnomeAudioProcessorEditor> safeThis (this);
+    exportChooser->launchAsync(flags, [safeThis, bars] (const juce::FileChooser& chooser)
+    {
+        if (safeThis == nullptr || chooser.getResult() == juce::File() || safeThis->clickExport != nullptr)
+            return;
+        auto& proc = safeThis->processor;
+
+        metrog::ClickExportSettings settings;
+        settings.file = chooser.getResult();
+        if (! settings.file.hasFileExtension("wav;flac"))
+            settings.file = settings.file.withFileExtension("wav");
+        settings.bars = bars;
+        if (const double tempo = proc.getUiSnapshot().tempoBPM; tempo > 0.0)
+            settings.tempoBPM = tempo;
+        if (proc.getSampleRate() > 0.0)
+            settings.sampleRate = proc.getSampleRate();
+
+        juce::MemoryBlock state;
+        proc.getStateInformation(state);
+        safeThis->clickExport = std::make_unique<metrog::ClickExportJob>(state, settings);
+    });
+}
+
+void MetroGnomeAudioProcessorEditor::checkClickExport()
+{
+    if (clickExport == nullptr || ! clickExport->isFinished())
+        return;
+
+    const auto& result = clickExport->getResult();
+    const auto message = result.wasOk() ? "Saved " + clickExport->getSettings().file.getFullPathName() : result.getErrorMessage();
+    juce::AlertWindow::showMessageBoxAsync(result.wasOk() ? juce::MessageBoxIconType::InfoIcon : juce::MessageBoxIconType::WarningIcon,
+                                           "Export click track", message);
+    clickExport.reset();
+}
+
+void MetroGnomeAudioProcessorEditor::updateDspLoadMeter()
+{
+    // Drain DSP load telemetry published by the audio thread
+    std::array<metrog::DspLoadSample, 256> loadSamples;
+    size_t n = 0;
+    while ((n = processor.popDspLoadSamples(loadSamples.data(), loadSamples.size())) > 0)
+        for (size_t i = 0; i < n; ++i)
+            dspLoadStats.add(loadSamples[i]);
+
+    // Repaint the meter only when what it shows has changed (percent label, peak tick pixel, XRUN flag)
+    const int percent = juce::roundToInt(juce::jlimit(0.0f, 1.0f, dspLoadStats.getAverageLoad()) * 100.0f);
+    const int peakPx = juce::roundToInt(juce::jlimit(0.0f, 1.0f, dspLoadStats.getPeakHoldLoad()) * (float)layout.meter.getWidth());
+    const bool risk = dspLoadStats.hasRecentXrunRisk();
+    if (percent != displayedLoadPercent || peakPx != displayedPeakPx || risk != displayedXrunRisk)
+    {
+        displayedLoadPercent = percent;
+        displayedPeakPx = peakPx;
+        displayedXrunRisk = risk;
+        repaint(layout.meter.expanded(1));
+    }
+}
+
+void MetroGnomeAudioProcessorEditor::updateSequencerDisplay (const metrog::UiSnapshot& ui)
 {
-    int currentSteps = lastLayoutStepCount;
-    if (const auto* sc = processor.getAPVTS().getRawParameterValue(kParamStepCount))
-        currentSteps = juce::jlimit(1, 16, (int)sc->load());
+    // Step count, enables and dance mode come from the parameters (and the processor's step mask) rather
+    // than the snapshot, so edits show even while no blocks run
+    const int currentSteps = stepCountValue != nullptr ? juce::jlimit(1, metrog::StepMask::kMaxSteps, (int)stepCountValue->load()) : lastLayoutStepCount;
+    const bool dance = danceModeValue != nullptr && danceModeValue->load() >= 0.5f;
 
-    if (currentSteps != lastLayoutStepCount)
+    // Layout or background mode changed: the whole content area is stale
+    if (currentSteps != lastLayoutStepCount || dance != displayedDance)
     {
         lastLayoutStepCount = currentSteps;
+        displayedDance = dance;
+        displayedUiGeneration = ui.generation;
+        displayedStep = ui.currentStep;
+        displayedParity = ui.danceParity;
+        takeStepValues();
         resized(); // update overlay bounds when step count changes
+        repaint(getContentBounds());
+        return;
+    }
+
+    // Step enables, accents, velocities or ratchets changed (UI, host automation, enable/disable-all or a
+    // pattern switch): redraw those cells
+    const auto mask = processor.getStepMask();
+    const auto accents = processor.getAccentSteps();
+    const auto maskChanged = mask ^ displayedStepMask;
+    const auto accentsChanged = accents ^ displayedAccents;
+    bool anyChanged = maskChanged.any() || accentsChanged.any();
+    displayedStepMask = mask;
+    displayedAccents = accents;
+    for (int i = 0; i < metrog::StepMask::kMaxSteps; ++i)
+    {
+        const auto v = (uint8_t)processor.getStepVelocity(i);
+        const auto r = (uint8_t)processor.getStepRatchet(i);
+        const bool valuesChanged = v != displayedVelocities[(size_t)i] || r != displayedRatchets[(size_t)i];
+        displayedVelocities[(size_t)i] = v;
+        displayedRatchets[(size_t)i] = r;
+        anyChanged = anyChanged || valuesChanged;
+        if (i < currentSteps && (valuesChanged || maskChanged.test(i) || accentsChanged.test(i)))
+            repaint(getStepCellBounds(i));
+    }
+    if (anyChanged)
+        invalidateStepCellLayers();
+
+    // Playhead moved: redraw the old and new current cells, or everything when the dance background flips
+    if (ui.generation == displayedUiGeneration)
+        return;
+
+    displayedUiGeneration = ui.generation;
+    const int step = ui.currentStep;
+    const int parity = ui.danceParity;
+
+    if (displayedDance && parity != displayedParity)
+    {
+        displayedStep = step;
+        displayedParity = parity;
+        repaint(getContentBounds());
+        return;
+    }
+
+    displayedParity = parity;
+    if (step != displayedStep)
+    {
+        const int n = juce::jmax(1, currentSteps);
+        if (displayedStep >= 0)
+            repaint(getStepCellBounds(displayedStep % n).expanded(1));
+        if (step >= 0)
+            repaint(getStepCellBounds(step % n).expanded(1));
+        displayedStep = step;
+    }
+}
+
+void MetroGnomeAudioProcessorEditor::updatePlayheadProgress (const metrog::UiSnapshot& ui)
+{
+    // Extrapolate the playhead to this frame, so the bar moves smoothly at any refresh rate while the
+    // audio thread still publishes once per block
+    int px = -1;
+    if (ui.playing != 0 && displayedStep >= 0)
+    {
+        const auto bar = getProgressBarBounds(getStepCellBounds(displayedStep % juce::jmax(1, lastLayoutStepCount)));
+        const double progress = metrog::subdivisionProgress(ui, metrog::extrapolatePpq(ui, metrog::monotonicNanos()));
+        px = juce::roundToInt(progress * (double)bar.getWidth());
     }
 
-    repaint();
+    if (px != displayedProgressPx)
+    {
+        // A step change already repainted the cells; this covers the bar moving within one cell
+        displayedProgressPx = px;
+        if (displayedStep >= 0)
+            repaint(getProgressBarBounds(getStepCellBounds(displayedStep % juce::jmax(1, lastLayoutStepCount))));
+    }
+}
+
+void MetroGnomeAudioProcessorEditor::updateBeatFlash (uint64_t nowNs)
+{
+    // Queue new clicks; if the editor falls this far behind, the stalest pending ones are dropped
+    std::array<metrog::GateEvent, 32> incoming;
+    size_t n = 0;
+    while ((n = processor.popGateEvents(incoming.data(), incoming.size())) > 0)
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (numPendingGates == pendingGates.size())
+            {
+                std::move(pendingGates.begin() + 1, pendingGates.end(), pendingGates.begin());
+                --numPendingGates;
+            }
+            pendingGates[numPendingGates++] = incoming[i];
+        }
+
+    // Flash the latest click that is audible by now, and forget the ones it supersedes. A ratchet repeat
+    // flashes its step again; a lane click flashes the cell that is playing (the editor draws no lanes).
+    int step = displayedFlashStep;
+    size_t due = 0;
+    while (due < numPendingGates && pendingGates[due].audibleNs <= nowNs)
+    {
+        step = pendingGates[due].lane == metrog::GateEvent::kMainLane ? pendingGates[due].stepIndex : displayedStep;
+        flashStartNs = pendingGates[due].audibleNs;
+        ++due;
+    }
+    if (due > 0)
+    {
+        std::move(pendingGates.begin() + (std::ptrdiff_t)due, pendingGates.begin() + (std::ptrdiff_t)numPendingGates, pendingGates.begin());
+        numPendingGates -= due;
+    }
+
+    const uint64_t age = nowNs - flashStartNs;
+    const int level = (step >= 0 && age < kFlashDurationNs)
+                        ? 1 + (int)((kFlashDurationNs - age) * (uint64_t)(kFlashLevels - 1) / kFlashDurationNs)
+                        : 0;
+
+    // Repaint only when the flash moves to another cell or steps down a fade level
+    if (step != displayedFlashStep || level != displayedFlashLevel || due > 0)
+    {
+        const int cells = juce::jmax(1, lastLayoutStepCount);
+        if (displayedFlashStep >= 0 && displayedFlashLevel > 0)
+            repaint(getStepCellBounds(displayedFlashStep % cells));
+        if (step >= 0 && level > 0)
+            repaint(getStepCellBounds(step % cells));
+        displayedFlashStep = step;
+        displayedFlashLevel = level;
+    }
 }
@@ -1,10 +1,16 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include <array>
+#include "DspLoad.h"
+#include "UiSnapshot.h"
+#include "StepMask.h"
+#include "BackgroundImages.h"
+#include "ClickExport.h"
 
 class MetroGnomeAudioProcessor;
 
-class MetroGnomeAudioProcessorEditor : public juce::AudioProcessorEditor, private juce::Timer
+class MetroGnomeAudioProcessorEditor : public juce::AudioProcessorEditor, private juce::ChangeListener
 {
 public:
     explicit MetroGnomeAudioProcessorEditor (MetroGnomeAudioProcessor&);
@@ -12,13 +18,45 @@ public:
 
     void paint (juce::Graphics&) override;
     void resized() override;
+    void mouseDown (const juce::MouseEvent&) override;
+    void mouseWheelMove (const juce::MouseEvent&, const juce::MouseWheelDetails&) override;
+
+    // Pulls the processor's latest state and repaints what changed. Runs on every vblank; public so
+    // headless tools (the paint benchmark) can step frames without a display.
+    void refreshFrame();
 
 private:
-    // Timer
-    void timerCallback() override;
+
+    // Shared image cache finished decoding
+    void changeListenerCallback (juce::ChangeBroadcaster*) override;
 
     // Helpers
-    void loadBackgroundImages();
+    void takeBackgroundImages();
+    void paintDspLoadMeter (juce::Graphics&);
+    void updateDspLoadMeter();
+    void updateSequencerDisplay (const metrog::UiSnapshot&);
+    void updatePlayheadProgress (const metrog::UiSnapshot&);
+    void updateBeatFlash (uint64_t nowNs);
+    void showOptionsMenu();
+    void chooseExportFile (int bars);
+    void checkClickExport();
+    void updateLayout();
+    juce::Rectangle<int> getContentBounds() const { return layout.content; }
+    juce::Rectangle<int> getStepCellBounds (int index) const;
+    juce::Rectangle<int> getProgressBarBounds (juce::Rectangle<int> cell) const;
+    int getStepAt (juce::Point<int> position) const;
+    void drawStepCell (juce::Graphics&, int index, bool isCurrent) const;
+    void takeStepValues();
+
+    // Pre-rendered content area for one background image, at physical pixel resolution
+    struct BackgroundLayer
+    {
+        juce::Image scaled;     // background resampled once to content size x display scale
+        juce::Image composite;  // scaled + every step cell drawn in its non-current state
+    };
+    const BackgroundLayer& getBackgroundLayer (int parityIndex, float displayScale);
+    void invalidateBackgroundLayers();
+    void invalidateStepCellLayers();
 
     MetroGnomeAudioProcessor& processor;
 
@@ -29,7 +67,7 @@ private:
     juce::DrawableButton enableAllBtn { "enableAll", juce::DrawableButton::ButtonStyle::ImageFitted };
     juce::DrawableButton disableAllBtn { "disableAll", juce::DrawableButton::ButtonStyle::ImageFitted };
     juce::ToggleButton danceToggle { "Dance" };
-    juce::OwnedArray<juce::ToggleButton> stepToggles; // 16 toggles
+    juce::OwnedArray<juce::ToggleButton> stepToggles; // one per possible step (StepMask::kMaxSteps)
 
     // Labels for rotary controls
     juce::Label stepsLabel;
@@ -46,12 +84,73 @@ private:
     std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> danceAttachment;
     juce::OwnedArray<juce::AudioProcessorValueTreeState::ButtonAttachment> stepAttachments;
 
-    // Images
+    // Images (shared with every other instance; invalid until the cache has decoded them)
+    juce::SharedResourcePointer<BackgroundImageCache> backgroundImages;
     juce::Image bgA;
     juce::Image bgB;
 
-    // Cached layout state
+    // Layer cache, one set per display scale in use (a window moved between a 1x and a 2x monitor keeps
+    // both): layers[0] for bgA, [1] for bgB. Rebuilt when the content size, step count or step enables
+    // change, never per frame.
+    struct LayerSet
+    {
+        float displayScale = 0.0f; // 0 = unused
+        uint32_t lastUsed = 0;
+        std::array<BackgroundLayer, 2> layers;
+    };
+    std::array<LayerSet, 2> layerSets;
+    uint32_t layerUseCounter = 0;
+    juce::Rectangle<int> layerContentBounds;
+
+    // Editor geometry for the current size, computed once per resize (paint and the frame callback only
+    // read it). Everything scales with the editor from the 500x585 design size.
+    struct EditorLayout
+    {
+        float scale = 1.0f;
+        juce::Rectangle<int> sidebar, content, stepGrid, meter;
+        int columns = 1, cellWidth = 0, cellHeight = 0;
+    };
+    EditorLayout layout;
     int lastLayoutStepCount = -1;
 
+    // DSP load telemetry drained from the processor each frame
+    metrog::DspLoadStats dspLoadStats;
+    int displayedLoadPercent = -1, displayedPeakPx = -1;
+    bool displayedXrunRisk = false;
+
+    // Cached raw parameter values (no ID lookups per frame)
+    std::atomic<float>* stepCountValue = nullptr;
+    std::atomic<float>* danceModeValue = nullptr;
+
+    // What the step row and background currently show; paint() draws these, refreshFrame() diffs
+    // them against the processor and invalidates only the regions that changed
+    uint32_t displayedUiGeneration = 0;
+    int displayedStep = -1;
+    int displayedParity = 0;
+    bool displayedDance = false;
+    metrog::StepMask displayedStepMask;
+    metrog::StepMask displayedAccents;
+    metrog::StepVelocityArray displayedVelocities = metrog::fullVelocities();
+    metrog::StepRatchetArray displayedRatchets = metrog::singleRatchets();
+    int displayedProgressPx = -1;  // width of the current cell's progress bar; -1 = hidden (stopped)
+
+    // Beat flash: gate events waiting for their audible time (in time order), and the flash on screen
+    std::array<metrog::GateEvent, 32> pendingGates{};
+    size_t numPendingGates = 0;
+    uint64_t flashStartNs = 0;
+    int displayedFlashStep = -1;
+    int displayedFlashLevel = 0;   // 0 = no flash, up to kFlashLevels right at the click
+
+    // Click track export in progress (at most one), and its file chooser while open
+    std::unique_ptr<metrog::ClickExportJob> clickExport;
+    std::unique_ptr<juce::FileChooser> exportChooser;
+
+    // monotonicNanos() of the last full refresh (throttled while the transport is stopped)
+    uint64_t lastRefreshNs = 0;
+
+    // Declared last: frame callbacks start once everything above is constructed. Nothing is done
+    // while the editor isn't showing (hidden or minimised window).
+    juce::VBlankAttachment vBlankAttachment { this, [this] { if (isShowing()) refreshFrame(); } };
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MetroGnomeAudioProcessorEditor)
 };
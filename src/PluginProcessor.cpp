@@ -1,8 +1,7 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
-
-#ifndef METROG_DEBUG_TIMING
-#define METROG_DEBUG_TIMING 0
+#if JucePlugin_Build_Standalone
+ #include <juce_audio_plugin_client/Standalone/juce_StandaloneFilterWindow.h>
 #endif
 
 // Param IDs
@@ -12,10 +11,66 @@ static constexpr const char* kParamDisableAll = "disableAll";
 static constexpr const char* kParamVolume = "volume";
 static constexpr const char* kParamDanceMode = "danceMode";
 static constexpr const char* kParamTimeSigNum = "timeSigNum";
+static constexpr const char* kParamAccentDownbeat = "accentDownbeat";
+static constexpr const char* kParamSwing = "swing";
+static constexpr const char* kParamGroove = "groove";
+static constexpr const char* kParamClickOffset = "clickOffsetMs";
+static constexpr float kMaxClickOffsetMs = 50.0f; // also how far ahead the sequencer looks when clicks can be early
+static constexpr const char* kParamBusLevels[] = { "accentsOutputLevel", "normalOutputLevel", "lanesOutputLevel" }; // output buses 1..3
+static constexpr const char* kPropStepVelocities = "stepVelocities"; // state properties, not host parameters
+static constexpr const char* kPropAccentSteps = "accentSteps";
+static constexpr const char* kPropStepRatchets = "stepRatchets";
+static constexpr const char* kPropVisualLatencyMs = "visualLatencyMs"; // state property, not a host parameter
+static constexpr const char* kTreePatternBank = "PatternBank";
+static constexpr const char* kTreeLanes = "Lanes";
 static juce::String stepEnabledId (int idx) { return juce::String("stepEnabled_") + juce::String(idx + 1); }
 
+static juce::String stepMaskToString (const metrog::StepMask& mask)
+{
+    // Hex words, most significant first
+    juce::String text;
+    for (size_t i = mask.words.size(); i-- > 0;)
+        text << juce::String::toHexString((juce::int64)mask.words[i]).paddedLeft('0', 16);
+    return text;
+}
+
+static metrog::StepMask stepMaskFromString (const juce::String& text, metrog::StepMask fallback = metrog::StepMask::allEnabled())
+{
+    metrog::StepMask mask;
+    const int words = (int)mask.words.size();
+    if (text.length() != words * 16)
+        return fallback;
+    for (int i = 0; i < words; ++i)
+        mask.words[(size_t)(words - 1 - i)] = (uint64_t)text.substring(i * 16, (i + 1) * 16).getHexValue64();
+    return mask;
+}
+
+// Per-step byte arrays (velocities, ratchet counts): two hex digits per step
+static juce::String stepBytesToString (const std::array<uint8_t, metrog::StepMask::kMaxSteps>& values)
+{
+    juce::String text;
+    for (auto v : values)
+        text << juce::String::toHexString((int)v).paddedLeft('0', 2);
+    return text;
+}
+
+static std::array<uint8_t, metrog::StepMask::kMaxSteps> stepBytesFromString (const juce::String& text, uint8_t defaultValue,
+                                                                               int minValue, int maxValue)
+{
+    std::array<uint8_t, metrog::StepMask::kMaxSteps> values;
+    values.fill(defaultValue);
+    if (text.length() != (int)values.size() * 2)
+        return values;
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i] = (uint8_t)juce::jlimit(minValue, maxValue, text.substring((int)i * 2, (int)i * 2 + 2).getHexValue32());
+    return values;
+}
+
+static metrog::StepVelocityArray velocitiesFromString (const juce::String& text) { return stepBytesFromString(text, 127, 0, 127); }
+static metrog::StepRatchetArray ratchetsFromString (const juce::String& text) { return stepBytesFromString(text, 1, 1, metrog::kMaxRatchets); }
+
 //==============================================================================
-MetroGnomeAudioProcessor::MetroGnomeAudioProcessor()
+MetroGnomeAudioProcessor::MetroGnomeAudioProcessor (Mode processingMode)
     : juce::AudioProcessor (BusesProperties()
 #if ! JucePlugin_IsMidiEffect
 #if JucePlugin_IsSynth
@@ -24,58 +79,108 @@ MetroGnomeAudioProcessor::MetroGnomeAudioProcessor()
         .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
         .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
 #endif
+        // Separate outputs, off until the host enables them; the main output keeps the full mix
+        .withOutput ("Accents", juce::AudioChannelSet::stereo(), false)
+        .withOutput ("Normal", juce::AudioChannelSet::stereo(), false)
+        .withOutput ("Lanes", juce::AudioChannelSet::stereo(), false)
 #endif
     )
+    , mode (processingMode)
     , apvts (*this, nullptr, "PARAMS", createParameterLayout())
 {
     // Cache raw parameter pointers for RT-safe access in audio thread
     stepCountParam = apvts.getRawParameterValue(kParamStepCount);
     enableAllParam = apvts.getRawParameterValue(kParamEnableAll);
     disableAllParam = apvts.getRawParameterValue(kParamDisableAll);
-    for (int i = 0; i < 16; ++i)
-        stepEnabledParams[i] = apvts.getRawParameterValue(stepEnabledId(i).toRawUTF8());
+    for (int i = 0; i < metrog::StepMask::kMaxSteps; ++i)
+    {
+        stepEnabledParams[(size_t)i] = apvts.getRawParameterValue(stepEnabledId(i).toRawUTF8());
+        apvts.addParameterListener(stepEnabledId(i), this);
+    }
+    syncStepMaskFromParameters();
     volumeParam = apvts.getRawParameterValue(kParamVolume);
     danceModeParam = apvts.getRawParameterValue(kParamDanceMode);
     timeSigNumParam = apvts.getRawParameterValue(kParamTimeSigNum);
+    accentDownbeatParam = apvts.getRawParameterValue(kParamAccentDownbeat);
+    swingParam = apvts.getRawParameterValue(kParamSwing);
+    grooveParam = apvts.getRawParameterValue(kParamGroove);
+    clickOffsetParam = apvts.getRawParameterValue(kParamClickOffset);
+    for (size_t i = 0; i < busLevelParams.size(); ++i)
+        busLevelParams[i] = apvts.getRawParameterValue(kParamBusLevels[i]);
+
+    // Bind every ranged parameter to its raw value once, for RT-safe MIDI CC control
+    for (auto* base : getParameters())
+        if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(base))
+        {
+            const auto id = ranged->getParameterID();
+            const int stepIndex = id.startsWith("stepEnabled_") ? id.getTrailingIntValue() - 1 : -1;
+            ccBindings.push_back({ ranged, apvts.getRawParameterValue(id), stepIndex });
+        }
 
     // init CC map to nulls
     for (auto& p : ccToParam) p.store(nullptr, std::memory_order_relaxed);
+    for (auto& v : pendingCCValues) v.store(-1, std::memory_order_relaxed);
+
+    // An offline render has no host to notify and no session to trace
+    if (mode == Mode::offline)
+        return;
+
+    // Host notifications for MIDI-controlled parameters are sent from the message thread
+    startTimerHz(30);
+
+    // Optional timing trace for diagnosing glitches on user machines: METROG_TRACE_FILE=/path/trace.json
+    const auto tracePath = juce::SystemStats::getEnvironmentVariable("METROG_TRACE_FILE", {});
+    if (tracePath.isNotEmpty())
+        startTimingTrace(juce::File(tracePath));
+}
+
+MetroGnomeAudioProcessor::~MetroGnomeAudioProcessor()
+{
+    stopTimer();
+    stopTimingTrace();
+    for (int i = 0; i < metrog::StepMask::kMaxSteps; ++i)
+        apvts.removeParameterListener(stepEnabledId(i), this);
+}
+
+void MetroGnomeAudioProcessor::parameterChanged (const juce::String& parameterID, float newValue)
+{
+    stepMask.set(parameterID.getTrailingIntValue() - 1, newValue >= 0.5f);
 }
 
-MetroGnomeAudioProcessor::~MetroGnomeAudioProcessor() = default;
+void MetroGnomeAudioProcessor::syncStepMaskFromParameters()
+{
+    metrog::StepMask mask;
+    for (int i = 0; i < metrog::StepMask::kMaxSteps; ++i)
+        mask.set(i, stepEnabledParams[(size_t)i] != nullptr && stepEnabledParams[(size_t)i]->load() >= 0.5f);
+    stepMask.store(mask);
+}
 
 //==============================================================================
 void MetroGnomeAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    // No dynamic allocations; ensure deterministic state.
-    timing.prepare(sampleRate, samplesPerBlock);
+    // No dynamic allocations; ensure deterministic state. Hosts prepare again when the buffer size or
+    // rate changes mid-session: the sequencers then keep their musical state, so the beat carries on.
+    if (prepared)
+    {
+        sequencer.reconfigure(sampleRate, samplesPerBlock);
+        lanes.reconfigure(sampleRate);
+    }
+    else
+    {
+        sequencer.prepare(sampleRate, samplesPerBlock);
+        lanes.prepare(sampleRate);
+        prepared = true;
+    }
+    // Only ever grows (keeping its memory when a host prepares again with smaller blocks), so it holds the
+    // largest block any prepare announced
+    sourceBuffer.setSize(kNumSources, juce::jmax(1, samplesPerBlock, sourceBuffer.getNumSamples()), false, false, true);
     hostInfo.sampleRate = sampleRate;
+    nanosPerSample = 1.0e9 / std::max(1.0, sampleRate);
+    traceWriter.setSampleRate(sampleRate);
 
     // Initialize timing subdivisions from time signature numerator (independent from step count)
     const int timeSigNum = static_cast<int>(timeSigNumParam ? timeSigNumParam->load() : 4.0f);
-    timing.setSubdivisionsPerBar(juce::jlimit(1, 16, timeSigNum));
-
-    // Reset UI indices/parity
-    currentStepIndex.store(-1);
-    danceParity.store(0);
-    globalSubdivisionCounter.store(0);
-
-    // Initialize click synth parameters (short sine burst with exponential decay)
-    const double clickMs = 10.0; // 10 ms max length
-    clickMaxSamples = static_cast<int>(std::round((clickMs * 0.001) * sampleRate));
-    if (clickMaxSamples < 1) clickMaxSamples = 1;
-    const double decayMs = 4.0; // ~4 ms decay constant
-    const double tauSamples = (decayMs * 0.001) * sampleRate;
-    if (tauSamples > 0.0)
-        clickDecay = std::exp(-1.0 / tauSamples);
-    else
-        clickDecay = 0.0;
-    const double freq = 3000.0; // 3 kHz click tone
-    sinePhase = 0.0;
-    sinePhaseInc = juce::MathConstants<double>::twoPi * freq / std::max(1.0, sampleRate);
-    clickActive = false;
-    clickEnv = 0.0;
-    clickSampleIndex = 0;
+    sequencer.setSubdivisionsPerBar(juce::jlimit(1, 16, timeSigNum));
 }
 
 void MetroGnomeAudioProcessor::releaseResources()
@@ -89,29 +194,53 @@ bool MetroGnomeAudioProcessor::isBusesLayoutSupported (const BusesLayout& layout
     if (layouts.getMainInputChannelSet() != juce::AudioChannelSet::disabled())
         return false;
     auto out = layouts.getMainOutputChannelSet();
-    return out == juce::AudioChannelSet::mono() || out == juce::AudioChannelSet::stereo();
+    if (out != juce::AudioChannelSet::mono() && out != juce::AudioChannelSet::stereo())
+        return false;
 #else
     // For non-synth, require symmetric layout.
-    return layouts.getMainOutputChannelSet() == layouts.getMainInputChannelSet()
-        && (layouts.getMainOutputChannelSet() == juce::AudioChannelSet::mono()
-            || layouts.getMainOutputChannelSet() == juce::AudioChannelSet::stereo());
+    if (! (layouts.getMainOutputChannelSet() == layouts.getMainInputChannelSet()
+           && (layouts.getMainOutputChannelSet() == juce::AudioChannelSet::mono()
+               || layouts.getMainOutputChannelSet() == juce::AudioChannelSet::stereo())))
+        return false;
 #endif
+    // Separate outputs: each off, mono or stereo
+    for (int bus = 1; bus < layouts.outputBuses.size(); ++bus)
+    {
+        const auto set = layouts.getChannelSet(false, bus);
+        if (! set.isDisabled() && set != juce::AudioChannelSet::mono() && set != juce::AudioChannelSet::stereo())
+            return false;
+    }
+    return true;
 }
 
 void MetroGnomeAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    const uint64_t callbackStartNs = metrog::monotonicNanos();
     juce::ScopedNoDenormals noDenormals;
 
+    // Phase timestamps are only taken while a timing trace is being recorded
+    const bool tracing = traceActive.load(std::memory_order_relaxed);
+    uint64_t phaseStartNs = callbackStartNs;
+    auto phaseElapsed = [&phaseStartNs, tracing]() noexcept -> uint32_t
+    {
+        if (! tracing)
+            return 0;
+        const uint64_t now = metrog::monotonicNanos();
+        const auto elapsed = static_cast<uint32_t>(std::min<uint64_t>(now - phaseStartNs, UINT32_MAX));
+        phaseStartNs = now;
+        return elapsed;
+    };
+    metrog::TraceRecord traceRecord;
+
     // Clear buffer at block start; we fully synthesize output
     buffer.clear();
 
     // Keep timing engine subdivisions synced with time signature numerator (independent from step count)
     const int timeSigNum = juce::jlimit(1, 16, static_cast<int>(timeSigNumParam ? timeSigNumParam->load() : 4.0f));
-    if (timing.getSubdivisionsPerBar() != timeSigNum)
-        timing.setSubdivisionsPerBar(timeSigNum);
+    sequencer.setSubdivisionsPerBar(timeSigNum);
 
     // Fetch current step count for UI/sequence length
-    const int stepCount = juce::jlimit(1, 16, static_cast<int>(stepCountParam ? stepCountParam->load() : 8.0f));
+    int stepCount = juce::jlimit(1, metrog::StepMask::kMaxSteps, static_cast<int>(stepCountParam ? stepCountParam->load() : 8.0f));
 
     // Process incoming MIDI CC messages: handle learn and mapped control
     if (! midiMessages.isEmpty())
@@ -124,192 +253,345 @@ void MetroGnomeAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, j
                 const int cc = m.getControllerNumber();
                 const int val = m.getControllerValue();
 
-                // learn capture (do not allocate)
-                if (midiLearnArmed.load(std::memory_order_relaxed) && pendingLearnCC.load(std::memory_order_relaxed) < 0)
-                    pendingLearnCC.store(cc, std::memory_order_relaxed);
+                // learn capture (do not allocate); first CC wins, even if the message thread re-arms concurrently
+                if (midiLearnArmed.load(std::memory_order_acquire))
+                {
+                    int expected = -1;
+                    pendingLearnCC.compare_exchange_strong(expected, cc, std::memory_order_acq_rel);
+                }
 
-                // mapped control
+                // mapped control: takes effect this block through the raw value; setValueNotifyingHost
+                // takes listener locks, so the host is notified later from the message thread
                 if (cc >= 0 && cc < (int)ccToParam.size())
                 {
-                    auto* p = ccToParam[(size_t)cc].load(std::memory_order_relaxed);
-                    if (p != nullptr)
+                    const auto* binding = ccToParam[(size_t)cc].load(std::memory_order_acquire);
+                    if (binding != nullptr && binding->rawValue != nullptr)
                     {
                         const float norm = juce::jlimit(0.0f, 1.0f, (float)val / 127.0f);
-                        p->setValueNotifyingHost (norm);
+                        const float value = binding->param->convertFrom0to1(norm);
+                        binding->rawValue->store(value, std::memory_order_relaxed);
+                        if (binding->stepIndex >= 0)
+                            stepMask.set(binding->stepIndex, value >= 0.5f);
+                        pendingCCValues[(size_t)cc].store(val, std::memory_order_release);
                     }
                 }
             }
         }
     }
 
+    traceRecord.midiNs = phaseElapsed();
+
     // Read host transport info deterministically without allocations
     if (auto* playHead = getPlayHead())
     {
-        juce::AudioPlayHead::CurrentPositionInfo info;
-        if (playHead->getCurrentPosition (info))
+        if (const auto info = playHead->getPosition())
         {
-            // Always update play/stop state
-            hostInfo.isPlaying = info.isPlaying;
-
-            // Update known-good fields only; keep cached values if host omits (returns 0/<=0)
-            if (info.bpm > 0.0)
-                hostInfo.tempoBPM = info.bpm;
-
-            if (info.timeSigNumerator > 0)
-                hostInfo.timeSigNumerator = info.timeSigNumerator;
-
-            // PPQ: allow 0.0 at the exact start when playing; otherwise, if host provides non-zero, accept it.
-            if (info.isPlaying || info.ppqPosition != 0.0)
-                hostInfo.ppqPosition = info.ppqPosition;
+            metrog::HostPosition pos;
+            pos.isPlaying = info->getIsPlaying();
+            pos.bpm = info->getBpm().orFallback(0.0);
+            if (const auto timeSig = info->getTimeSignature())
+            {
+                pos.timeSigNumerator = timeSig->numerator;
+                pos.timeSigDenominator = timeSig->denominator;
+            }
+            pos.ppqPosition = info->getPpqPosition().orFallback(0.0);
+            if (const auto barStart = info->getPpqPositionOfLastBarStart())
+            {
+                pos.hasLastBarStart = true;
+                pos.lastBarStartPpq = *barStart;
+                pos.barCount = info->getBarCount().orFallback(-1);
+            }
+            metrog::applyHostPosition(hostInfo, pos);
         }
     }
 
-    // Compute host-aligned indices and debounce start-of-transport glitches
-    const int subdivisionsPerBar = timing.getSubdivisionsPerBar();
-    const double ppqNow = hostInfo.ppqPosition;
-    const bool isPlayingNow = hostInfo.isPlaying;
-    const bool playStateChanged = (isPlayingNow != lastHostIsPlaying);
-    const bool ppqAdvanced = (ppqNow > lastHostPPQ + 1e-9) || playStateChanged;
-
-    auto computeGlobalFromHost = [&]() -> int
+    // Idle: stopped, nothing ringing or waiting, the playhead where it was and no step action or pattern
+    // change to apply. The buffer is already clear, so none of the pattern, lane, parameter or UI work
+    // below would change anything. A lane setup change waits for the next block that plays.
+    const bool stepActionPending = (enableAllParam != nullptr && enableAllParam->load() >= 0.5f)
+                                || (disableAllParam != nullptr && disableAllParam->load() >= 0.5f);
+    if (! hostInfo.isPlaying && ! stepActionPending && ! hasPendingPattern && ! patternBank.hasChange()
+        && ! lanes.willRender() && sequencer.isIdle(hostInfo, stepCount))
     {
-        int barIdx = 0, beatInBar = 0;
-        metrog::TimingEngine::computeBarBeat(ppqNow, hostInfo.timeSigNumerator, barIdx, beatInBar);
-        const int subIdx = metrog::TimingEngine::computeSubdivisionIndex(ppqNow, hostInfo.timeSigNumerator, subdivisionsPerBar);
-        const int global = barIdx * subdivisionsPerBar + subIdx;
-        return global >= 0 ? global : 0;
-    };
-
-    // stepCount already computed above
-
-    if (!isPlayingNow)
-    {
-        // When stopped, reflect host playhead position in UI without emitting gates
-        const int globalHost = computeGlobalFromHost();
-        const int stepIdx = (stepCount > 0) ? (globalHost % stepCount) : 0;
-        currentStepIndex.store(stepIdx);
-    }
-    else if (playStateChanged)
-    {
-        // Align our global counter with host position on play start or play/stop toggle
-        const int globalHost = computeGlobalFromHost();
-        globalSubdivisionCounter.store(globalHost);
-        const int stepIdx = (stepCount > 0) ? (globalHost % stepCount) : 0;
-        currentStepIndex.store(stepIdx);
-        danceParity.store(globalHost & 1);
+        if (mode == Mode::host)
+            publishDspLoad(callbackStartNs, buffer.getNumSamples());
+        return;
     }
 
     // Handle enable/disable-all actions atomically (momentary behavior)
     if (enableAllParam && enableAllParam->load() >= 0.5f)
     {
-        for (int i = 0; i < 16; ++i)
-            if (stepEnabledParams[i]) stepEnabledParams[i]->store(1.0f);
+        for (auto* p : stepEnabledParams)
+            if (p) p->store(1.0f);
+        stepMask.store(metrog::StepMask::allEnabled());
         enableAllParam->store(0.0f);
     }
     if (disableAllParam && disableAllParam->load() >= 0.5f)
     {
-        for (int i = 0; i < 16; ++i)
-            if (stepEnabledParams[i]) stepEnabledParams[i]->store(0.0f);
+        for (auto* p : stepEnabledParams)
+            if (p) p->store(0.0f);
+        stepMask.store(metrog::StepMask{});
         disableAllParam->store(0.0f);
     }
 
-    // Reset last gate at start of block
-    lastGateSample = -1;
-    lastGateStepIndex = -1;
-    lastGateBarIndex = -1;
-
-    // Compute subdivision crossing for this block only if host position advanced
-    metrog::SubdivisionCrossing crossing{};
-    bool suppressFirstBlockBoundary = false;
-    if (isPlayingNow)
+    // Pattern bank: take the latest selection, then switch now, or hand it to the sequencer for the next
+    // bar line while playing
+    metrog::PatternChange change;
+    if (patternBank.takeChange(change))
     {
-        const double beatsPerBarD = static_cast<double>(hostInfo.timeSigNumerator > 0 ? hostInfo.timeSigNumerator : 4);
-        double barPosBeats = std::fmod(std::max(ppqNow, 0.0), beatsPerBarD);
-        if (barPosBeats < 0.0) barPosBeats = 0.0;
-        const double eps = 1e-9 * beatsPerBarD;
-        const bool atBoundary = (barPosBeats <= eps) || (beatsPerBarD - barPosBeats <= eps);
-        suppressFirstBlockBoundary = playStateChanged && atBoundary;
+        pendingPattern = change;
+        hasPendingPattern = true;
     }
-    if (isPlayingNow && ppqAdvanced && !suppressFirstBlockBoundary)
-        crossing = timing.findFirstSubdivisionCrossing(hostInfo, buffer.getNumSamples());
-
-    if (crossing.crosses)
+    if (hasPendingPattern && ! (pendingPattern.quantizeToBar && hostInfo.isPlaying))
     {
-        // Use a global counter to avoid resetting on each bar; guarantees full sequence progression
-        const int globalIdx = globalSubdivisionCounter.fetch_add(1) + 1; // post-increment returns previous
-        const int stepIdx = (stepCount > 0) ? (globalIdx % stepCount) : 0;
-        // Update UI-visible current step index regardless of enabled state
-        currentStepIndex.store(stepIdx);
-        // Flip dance parity on every subdivision crossing for smooth alternation
-        danceParity.fetch_xor(1);
+        applyPattern(pendingPattern);
+        hasPendingPattern = false;
+        stepCount = pendingPattern.pattern.stepCount;
+        sequencer.setSubdivisionsPerBar(pendingPattern.pattern.subdivisionsPerBar);
+    }
 
-        const bool stepEnabled = (stepEnabledParams[stepIdx] != nullptr) && (stepEnabledParams[stepIdx]->load() >= 0.5f);
-        if (stepEnabled)
-        {
-            lastGateSample = crossing.firstCrossingSample;
-            lastGateStepIndex = stepIdx;
-            lastGateBarIndex = crossing.barIndex;
-#if METROG_DEBUG_TIMING
-            DBG ("[Gate] bar=" << lastGateBarIndex
-                 << " step=" << lastGateStepIndex
-                 << " sample@=" << lastGateSample
-                 << " stepCount=" << stepCount
-                 << " globalIdx=" << globalIdx);
-#endif
-        }
+    // Lane setup changes take effect from this block
+    metrog::LaneConfig laneChange;
+    if (laneConfigHandoff.take(laneChange))
+        lanes.setConfig(laneChange);
+
+    // Snapshot step enables for this block
+    metrog::SequencerParams seqParams;
+    seqParams.stepCount = stepCount;
+    seqParams.stepMask = stepMask.load();
+    seqParams.atNextBar = hasPendingPattern ? &pendingPattern.pattern : nullptr;
+    seqParams.velocities = &stepVelocities;
+    seqParams.ratchets = &stepRatchets;
+    seqParams.accentMask = accentSteps.load();
+    seqParams.accentDownbeats = accentDownbeatParam != nullptr && accentDownbeatParam->load() >= 0.5f;
+
+    // Timing feel. The sequencer only looks ahead while a click can be early (a negative offset or an
+    // early-leaning groove), so straight time keeps clicks exactly on the grid with no scheduling delay.
+    const auto& grooves = metrog::grooveTemplates();
+    const auto& groove = grooves[(size_t)juce::jlimit(0, (int)grooves.size() - 1, grooveParam ? (int)grooveParam->load() : 0)];
+    const float offsetMs = juce::jlimit(-kMaxClickOffsetMs, kMaxClickOffsetMs, clickOffsetParam ? clickOffsetParam->load() : 0.0f);
+    seqParams.lookaheadSamples = getLookaheadSamples(hostInfo.sampleRate);
+    seqParams.offsetSamples = juce::roundToInt(offsetMs * 0.001 * hostInfo.sampleRate);
+    seqParams.swing = metrog::swingFromPercent(swingParam ? swingParam->load() : 50.0f);
+    seqParams.groove = groove.length > 0 ? &groove : nullptr;
+
+    traceRecord.transportNs = phaseElapsed();
+
+    // Host alignment, subdivision crossing and gate decision
+    const int numSamples = buffer.getNumSamples();
+    const auto& block = sequencer.advance(hostInfo, seqParams, numSamples);
+
+    traceRecord.crossingNs = phaseElapsed();
+
+    if (block.barSwitch)
+    {
+        applyPattern(pendingPattern);
+        hasPendingPattern = false;
+        stepCount = pendingPattern.pattern.stepCount;
     }
 
     // Render click if active and/or retrigger at gate sample within this block (zero-latency)
-    const int numSamples = buffer.getNumSamples();
-    const int numChans = buffer.getNumChannels();
     const float vol = juce::jlimit(0.0f, 1.0f, volumeParam ? volumeParam->load() : 0.8f);
 
-    // Hoist channel write pointers out of the per-sample loop for performance
-    std::array<float*, 64> writePtrs{}; // support up to 64 channels
-    const int chanLimit = juce::jmin(numChans, (int)writePtrs.size());
-    for (int ch = 0; ch < chanLimit; ++ch)
-        writePtrs[(size_t)ch] = buffer.getWritePointer(ch);
+    // Polymetric lanes: all their boundaries in one pass, mixed between the merged events
+    lanes.advance(hostInfo, block, numSamples, seqParams.lookaheadSamples, seqParams.offsetSamples);
 
-    for (int s = 0; s < numSamples; ++s)
+    if (hasSeparateOutputs() && numSamples <= sourceBuffer.getNumSamples())
+        renderToBuses(buffer, numSamples, vol);
+    else
     {
-        if (lastGateSample == s)
+        // Main output only (or a block longer than prepared for): straight into its channels. The mix
+        // goes to the main bus alone; separate outputs stay silent for such a block rather than each
+        // getting the whole mix.
+        auto mainBus = getBusBuffer(buffer, false, 0);
+        sequencer.render(mainBus.getArrayOfWritePointers(), mainBus.getNumChannels(), numSamples, vol);
+        lanes.render(mainBus.getArrayOfWritePointers(), mainBus.getNumChannels(), numSamples, vol);
+    }
+
+    // Nobody watches an offline render: no beat flash, UI state or load telemetry
+    if (mode == Mode::offline)
+        return;
+
+    // Queue every click of the block (the merged list: gates, ratchet repeats and lane clicks) for the
+    // editor's flash at its expected audible time: the device's output latency after the callback began
+    // (one buffer when it isn't known), plus the click's place in the block and its delay, plus the user's
+    // offset for what the device doesn't report
+    if (lanes.getNumEvents() > 0)
+    {
+        const int reportedLatency = outputLatencySamples.load(std::memory_order_relaxed);
+        const int outputLatency = reportedLatency >= 0 ? reportedLatency : numSamples;
+        const double offsetNs = (double)visualLatencyMs.load(std::memory_order_relaxed) * 1.0e6;
+        const auto* events = lanes.getEvents();
+        for (int e = 0; e < lanes.getNumEvents(); ++e)
         {
-            // Retrigger click envelope exactly at gate sample within this block
-            clickActive = true;
-            clickEnv = 1.0;
-            clickSampleIndex = 0;
-            sinePhase = 0.0; // reset for sharp transient
+            const auto& ev = events[(size_t)e];
+            metrog::GateEvent gate;
+            gate.audibleNs = callbackStartNs + static_cast<uint64_t>((double)(outputLatency + ev.sample + ev.delay) * nanosPerSample + offsetNs);
+            gate.barIndex = ev.bar;
+            gate.stepIndex = ev.step;
+            gate.lane = ev.lane;
+            gateEventRing.push(gate);
         }
+    }
 
-        float sampleValue = 0.0f;
-        if (clickActive)
+    // Publish this block's UI state in one consistent copy (an idle block changed nothing the editor shows)
+    if (! block.idle)
+    {
+        metrog::UiSnapshot ui;
+        ui.generation = sequencer.getUiGeneration();
+        ui.stepMask = seqParams.stepMask;
+        ui.tempoBPM = hostInfo.tempoBPM;
         {
-            const float tone = static_cast<float>(std::sin(sinePhase));
-            sinePhase += sinePhaseInc;
-            if (sinePhase >= juce::MathConstants<double>::twoPi)
-                sinePhase -= juce::MathConstants<double>::twoPi;
-
-            const float env = static_cast<float>(clickEnv);
-            sampleValue = env * tone * vol;
-
-            // advance envelope
-            clickEnv *= clickDecay;
-            ++clickSampleIndex;
-            if (clickSampleIndex >= clickMaxSamples || clickEnv < 1.0e-4)
-                clickActive = false;
+            // Timestamp the playhead at the block's end (callback entry + block duration) so the editor can
+            // extrapolate it per frame; stopped transports are published as-is
+            const double blockSeconds = hostInfo.sampleRate > 0.0 ? (double)numSamples / hostInfo.sampleRate : 0.0;
+            ui.ppqPosition = hostInfo.ppqPosition + (hostInfo.isPlaying ? blockSeconds * hostInfo.tempoBPM / 60.0 : 0.0);
+            ui.timeNs = callbackStartNs + static_cast<uint64_t>(blockSeconds * 1.0e9);
         }
+        ui.stepCount = static_cast<int16_t>(stepCount);
+        ui.currentStep = static_cast<int16_t>(sequencer.getCurrentStepIndex());
+        {
+            // Where the published position is in the host's bar, for the editor's step progress
+            const double beatsPerBar = metrog::TimingEngine::quartersPerBar(hostInfo);
+            const double fromBarLine = ui.ppqPosition - hostInfo.barStartPpq;
+            ui.beatsPerBar = static_cast<float>(beatsPerBar);
+            ui.barPpq = fromBarLine >= 0.0 ? static_cast<float>(std::fmod(fromBarLine, beatsPerBar)) : -1.0f;
+        }
+        ui.subdivisionsPerBar = static_cast<int16_t>(sequencer.getSubdivisionsPerBar());
+        ui.danceParity = static_cast<uint8_t>(sequencer.getDanceParity());
+        ui.playing = hostInfo.isPlaying ? 1 : 0;
+        uiSnapshot.store(ui);
+    }
 
-        if (sampleValue != 0.0f)
+    if (tracing)
+    {
+        traceRecord.renderNs = phaseElapsed();
+        traceRecord.blockStartNs = callbackStartNs;
+        traceRecord.ppq = hostInfo.ppqPosition;
+        traceRecord.tempoBPM = hostInfo.tempoBPM;
+        traceRecord.numSamples = numSamples;
+        traceRecord.crossingSample = block.crossing.crosses ? block.crossing.firstCrossingSample : -1;
+        traceRecord.stepIndex = sequencer.getCurrentStepIndex();
+        traceRecord.globalIndex = block.globalIndex;
+        traceRecord.barIndex = block.crossing.barIndex;
+        traceRecord.flags = static_cast<uint8_t>((block.playing ? metrog::TraceRecord::kPlaying : 0)
+                                               | (block.playStateChanged ? metrog::TraceRecord::kPlayStateChanged : 0)
+                                               | (block.crossing.crosses ? metrog::TraceRecord::kCrossing : 0)
+                                               | (block.gateSample >= 0 ? metrog::TraceRecord::kGate : 0)
+                                               | (block.suppressedBoundary ? metrog::TraceRecord::kSuppressedBoundary : 0));
+        traceRing.push(traceRecord);
+    }
+
+    publishDspLoad(callbackStartNs, numSamples);
+}
+
+// Device output latency for the beat flash: only the standalone app owns a device to ask. Plugin formats
+// have no way to learn it from the host, so gate events fall back to one buffer there.
+void MetroGnomeAudioProcessor::updateOutputLatency()
+{
+   #if JucePlugin_Build_Standalone
+    if (wrapperType == wrapperType_Standalone)
+        if (auto* holder = juce::StandalonePluginHolder::getInstance())
+            if (auto* device = holder->deviceManager.getCurrentAudioDevice())
+                setOutputLatencySamples(device->getOutputLatencyInSamples());
+   #endif
+}
+
+// Publishes a callback's duration against its real-time budget (two clock reads + one ring write)
+void MetroGnomeAudioProcessor::publishDspLoad (uint64_t callbackStartNs, int numSamples) noexcept
+{
+    metrog::DspLoadSample load;
+    load.startNs = callbackStartNs;
+    load.elapsedNs = static_cast<uint32_t>(std::min<uint64_t>(metrog::monotonicNanos() - callbackStartNs, UINT32_MAX));
+    load.budgetNs = static_cast<uint32_t>(std::min(numSamples * nanosPerSample, static_cast<double>(UINT32_MAX)));
+    dspLoadRing.push(load);
+}
+
+int MetroGnomeAudioProcessor::getLookaheadSamples (double sampleRate) const noexcept
+{
+    const auto& grooves = metrog::grooveTemplates();
+    const auto& groove = grooves[(size_t)juce::jlimit(0, (int)grooves.size() - 1, grooveParam ? (int)grooveParam->load() : 0)];
+    const bool clicksCanBeEarly = (clickOffsetParam != nullptr && clickOffsetParam->load() < 0.0f) || groove.hasEarlyOffsets();
+    return clicksCanBeEarly ? juce::roundToInt(kMaxClickOffsetMs * 0.001 * sampleRate) : 0;
+}
+
+//==============================================================================
+bool MetroGnomeAudioProcessor::hasSeparateOutputs() const noexcept
+{
+    for (int bus = 1; bus < getBusCount(false); ++bus)
+        if (const auto* b = getBus(false, bus); b != nullptr && b->isEnabled())
+            return true;
+    return false;
+}
+
+void MetroGnomeAudioProcessor::renderToBuses (juce::AudioBuffer<float>& buffer, int numSamples, float vol) noexcept
+{
+    // Each source renders once, in mono, into its own preallocated channel; the buses are then filled with
+    // vector copies: the main output gets the sum, each enabled separate output its source times its level.
+    // Sources with nothing to add this block are skipped (the buffer arrives cleared).
+    const bool sequencerSounds = sequencer.willRender();
+    const bool lanesSound = lanes.willRender();
+    if (! sequencerSounds && ! lanesSound)
+        return;
+
+    float* normal = sourceBuffer.getWritePointer(kSourceNormal);
+    float* accents = sourceBuffer.getWritePointer(kSourceAccents);
+    float* laneClicks = sourceBuffer.getWritePointer(kSourceLanes);
+    if (sequencerSounds)
+    {
+        juce::FloatVectorOperations::clear(normal, numSamples);
+        juce::FloatVectorOperations::clear(accents, numSamples);
+        sequencer.render(&normal, 1, &accents, 1, numSamples, vol);
+    }
+    if (lanesSound)
+    {
+        juce::FloatVectorOperations::clear(laneClicks, numSamples);
+        lanes.render(&laneClicks, 1, numSamples, vol);
+    }
+
+    auto mainBus = getBusBuffer(buffer, false, 0);
+    for (int ch = 0; ch < mainBus.getNumChannels(); ++ch)
+    {
+        float* out = mainBus.getWritePointer(ch);
+        if (sequencerSounds)
         {
-            for (int ch = 0; ch < numChans; ++ch)
-            {
-                buffer.getWritePointer(ch)[s] += sampleValue;
-            }
+            juce::FloatVectorOperations::add(out, normal, numSamples);
+            juce::FloatVectorOperations::add(out, accents, numSamples);
         }
+        if (lanesSound)
+            juce::FloatVectorOperations::add(out, laneClicks, numSamples);
     }
-    // Update last-known host state
-    lastHostPPQ = ppqNow;
-    lastHostIsPlaying = isPlayingNow;
+
+    // Output buses 1..3 in order: Accents, Normal, Lanes
+    static constexpr int kBusSources[] = { kSourceAccents, kSourceNormal, kSourceLanes };
+    const int numBuses = juce::jmin(getBusCount(false), 1 + (int)std::size(kBusSources));
+    for (int bus = 1; bus < numBuses; ++bus)
+    {
+        const int source = kBusSources[bus - 1];
+        if (! (source == kSourceLanes ? lanesSound : sequencerSounds))
+            continue;
+        const auto* levelParam = busLevelParams[(size_t)(bus - 1)];
+        const float level = levelParam != nullptr ? levelParam->load() : 1.0f;
+        auto busBuffer = getBusBuffer(buffer, false, bus);
+        for (int ch = 0; ch < busBuffer.getNumChannels(); ++ch)
+            juce::FloatVectorOperations::copyWithMultiply(busBuffer.getWritePointer(ch), sourceBuffer.getReadPointer(source), level, numSamples);
+    }
+}
+
+bool MetroGnomeAudioProcessor::startTimingTrace (const juce::File& file)
+{
+    stopTimingTrace();
+    if (! traceWriter.start(traceRing, file.getFullPathName().toStdString(), hostInfo.sampleRate))
+        return false;
+    traceActive.store(true, std::memory_order_release);
+    return true;
+}
+
+void MetroGnomeAudioProcessor::stopTimingTrace()
+{
+    // Stop the producer first so the writer's final drain sees every record
+    traceActive.store(false, std::memory_order_release);
+    traceWriter.stop();
 }
 
 //==============================================================================
@@ -337,6 +619,14 @@ void MetroGnomeAudioProcessor::setStateInformation (const void* data, int sizeIn
     {
         apvts.replaceState(vt);
         rebuildMidiMapFromState();
+        rebuildPatternBankFromState();
+        rebuildLaneConfigFromState();
+        stepVelocities.store(velocitiesFromString(apvts.state.getProperty(kPropStepVelocities, {}).toString()));
+        stepRatchets.store(ratchetsFromString(apvts.state.getProperty(kPropStepRatchets, {}).toString()));
+        accentSteps.store(stepMaskFromString(apvts.state.getProperty(kPropAccentSteps, {}).toString(), {}));
+        syncStepMaskFromParameters();
+        visualLatencyMs.store(juce::jlimit(0.0f, kMaxVisualLatencyMs, (float)apvts.state.getProperty(kPropVisualLatencyMs, 0.0f)),
+                              std::memory_order_relaxed);
     }
 }
 
@@ -346,7 +636,7 @@ juce::AudioProcessorValueTreeState::ParameterLayout MetroGnomeAudioProcessor::cr
     std::vector<std::unique_ptr<juce::RangedAudioParameter>> params;
 
     // Independent controls: step count (number of sequencer steps) and time signature numerator (timing)
-    params.push_back(std::make_unique<juce::AudioParameterInt>(kParamStepCount, "Steps", 1, 16, 8));
+    params.push_back(std::make_unique<juce::AudioParameterInt>(kParamStepCount, "Steps", 1, metrog::StepMask::kMaxSteps, 8));
     params.push_back(std::make_unique<juce::AudioParameterInt>(kParamTimeSigNum, "Time Sig Numerator", 1, 16, 4));
 
     // Action buttons (momentary)
@@ -360,7 +650,26 @@ juce::AudioProcessorValueTreeState::ParameterLayout MetroGnomeAudioProcessor::cr
     // UI: Dance mode toggle
     params.push_back(std::make_unique<juce::AudioParameterBool>(kParamDanceMode, "Dance Mode", false));
 
-    for (int i = 0; i < 16; ++i)
+    // Accent timbre on the first subdivision of every bar
+    params.push_back(std::make_unique<juce::AudioParameterBool>(kParamAccentDownbeat, "Accent Downbeat", false));
+
+    // Timing feel: swing (50% = straight), groove template, and a fixed click offset (negative = early)
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(kParamSwing, "Swing",
+        juce::NormalisableRange<float>(50.0f, 75.0f, 0.5f, 1.0f), 50.0f));
+    juce::StringArray grooveNames;
+    for (const auto& groove : metrog::grooveTemplates())
+        grooveNames.add(groove.name);
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(kParamGroove, "Groove", grooveNames, 0));
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(kParamClickOffset, "Click Offset (ms)",
+        juce::NormalisableRange<float>(-kMaxClickOffsetMs, kMaxClickOffsetMs, 0.5f, 1.0f), 0.0f));
+
+    // Levels of the separate outputs (Volume applies to them too)
+    static constexpr const char* kBusLevelNames[] = { "Accents Output Level", "Normal Output Level", "Lanes Output Level" };
+    for (size_t i = 0; i < std::size(kParamBusLevels); ++i)
+        params.push_back(std::make_unique<juce::AudioParameterFloat>(kParamBusLevels[i], kBusLevelNames[i],
+            juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f, 1.0f), 1.0f));
+
+    for (int i = 0; i < metrog::StepMask::kMaxSteps; ++i)
     {
         const auto id = stepEnabledId(i);
         const auto name = juce::String("Step ") + juce::String(i + 1) + juce::String(" Enabled");
@@ -376,41 +685,52 @@ juce::AudioProcessorValueTreeState::ParameterLayout MetroGnomeAudioProcessor::cr
 void MetroGnomeAudioProcessor::armMidiLearn (const juce::String& paramID)
 {
     midiLearnTargetId = paramID;
-    pendingLearnCC.store(-1, std::memory_order_relaxed);
-    midiLearnArmed.store(true, std::memory_order_relaxed);
+    pendingLearnCC.store(-1, std::memory_order_release);
+    midiLearnArmed.store(true, std::memory_order_release);
 }
 
 void MetroGnomeAudioProcessor::cancelMidiLearn()
 {
-    midiLearnArmed.store(false, std::memory_order_relaxed);
-    pendingLearnCC.store(-1, std::memory_order_relaxed);
+    midiLearnArmed.store(false, std::memory_order_release);
+    pendingLearnCC.store(-1, std::memory_order_release);
+    midiLearnTargetId.clear();
 }
 
 bool MetroGnomeAudioProcessor::commitPendingMidiLearn()
 {
-    const int cc = pendingLearnCC.load(std::memory_order_relaxed);
-    if (cc < 0 || cc > 127 || midiLearnTargetId.isEmpty())
+    const int cc = pendingLearnCC.load(std::memory_order_acquire);
+    if (! midiLearnArmed.load(std::memory_order_acquire) || cc < 0 || cc > 127 || midiLearnTargetId.isEmpty())
         return false;
 
-    // Update state tree
+    const auto* binding = findCCBinding(midiLearnTargetId);
+    if (binding == nullptr)
+    {
+        cancelMidiLearn();
+        return false;
+    }
+
     auto midiMap = apvts.state.getOrCreateChildWithName("MidiMap", nullptr);
-    midiMap.setProperty(midiLearnTargetId, cc, nullptr);
 
-    // Update fast map (clear any previous occupant for this CC)
-    if (cc >= 0 && cc < (int)ccToParam.size())
+    // One CC per parameter: release the target's previous CC
+    if (midiMap.hasProperty(midiLearnTargetId))
     {
-        // Ensure uniqueness: clear any param previously mapped to this CC
-        for (auto& slot : ccToParam)
-        {
-            if (slot.load(std::memory_order_relaxed) != nullptr)
-            {
-                // can't easily check ID here, so just overwrite target index below
-            }
-        }
-        if (auto* p = apvts.getParameter(midiLearnTargetId))
-            ccToParam[(size_t)cc].store(p, std::memory_order_relaxed);
+        const int oldCC = (int)midiMap.getProperty(midiLearnTargetId);
+        if (oldCC >= 0 && oldCC < (int)ccToParam.size() && oldCC != cc)
+            ccToParam[(size_t)oldCC].store(nullptr, std::memory_order_release);
     }
 
+    // One parameter per CC: drop any other parameter mapped to this CC from the state tree
+    for (int i = midiMap.getNumProperties(); --i >= 0;)
+    {
+        const auto name = midiMap.getPropertyName(i);
+        if (name.toString() != midiLearnTargetId && (int)midiMap.getProperty(name) == cc)
+            midiMap.removeProperty(name, nullptr);
+    }
+
+    // Update state tree, then the fast map (overwrites the previous occupant for this CC)
+    midiMap.setProperty(midiLearnTargetId, cc, nullptr);
+    ccToParam[(size_t)cc].store(binding, std::memory_order_release);
+
     // disarm
     cancelMidiLearn();
     return true;
@@ -426,11 +746,18 @@ void MetroGnomeAudioProcessor::clearMidiMapping (const juce::String& paramID)
             const int cc = (int)midiMap.getProperty(paramID);
             midiMap.removeProperty(paramID, nullptr);
             if (cc >= 0 && cc < (int)ccToParam.size())
-                ccToParam[(size_t)cc].store(nullptr, std::memory_order_relaxed);
+                ccToParam[(size_t)cc].store(nullptr, std::memory_order_release);
         }
     }
 }
 
+void MetroGnomeAudioProcessor::setVisualLatencyMs (float ms)
+{
+    ms = juce::jlimit(0.0f, kMaxVisualLatencyMs, ms);
+    apvts.state.setProperty(kPropVisualLatencyMs, ms, nullptr);
+    visualLatencyMs.store(ms, std::memory_order_relaxed);
+}
+
 int MetroGnomeAudioProcessor::getMappedCC (const juce::String& paramID) const
 {
     if (auto midiMap = apvts.state.getChildWithName("MidiMap"); midiMap.isValid())
@@ -441,22 +768,232 @@ int MetroGnomeAudioProcessor::getMappedCC (const juce::String& paramID) const
     return -1;
 }
 
+juce::String MetroGnomeAudioProcessor::getParameterIDForCC (int cc) const
+{
+    if (cc >= 0 && cc < (int)ccToParam.size())
+        if (const auto* binding = ccToParam[(size_t)cc].load(std::memory_order_acquire))
+            return binding->param->getParameterID();
+    return {};
+}
+
 void MetroGnomeAudioProcessor::rebuildMidiMapFromState()
 {
-    // Clear map
-    for (auto& slot : ccToParam) slot.store(nullptr, std::memory_order_relaxed);
+    // Resolve the whole map first, then publish each slot once, so the audio thread never sees a
+    // transiently cleared mapping for a CC that stays mapped
+    std::array<const CCBinding*, 128> resolved{};
+
+    if (auto midiMap = apvts.state.getChildWithName("MidiMap"); midiMap.isValid())
+    {
+        for (int i = 0; i < midiMap.getNumProperties(); ++i)
+        {
+            const auto name = midiMap.getPropertyName(i);
+            const int cc = (int)midiMap.getProperty(name);
+            if (cc >= 0 && cc < 128)
+                if (const auto* binding = findCCBinding(name.toString()))
+                    resolved[(size_t)cc] = binding;
+        }
+    }
+
+    for (size_t cc = 0; cc < resolved.size(); ++cc)
+        ccToParam[cc].store(resolved[cc], std::memory_order_release);
+}
+
+const MetroGnomeAudioProcessor::CCBinding* MetroGnomeAudioProcessor::findCCBinding (const juce::String& paramID) const
+{
+    for (const auto& b : ccBindings)
+        if (b.param->getParameterID() == paramID)
+            return &b;
+    return nullptr;
+}
+
+//==============================================================================
+// Pattern bank
+void MetroGnomeAudioProcessor::storePattern (int index)
+{
+    index = juce::jlimit(0, metrog::PatternBank::kNumPatterns - 1, index);
+
+    metrog::Pattern pattern;
+    pattern.stepMask = stepMask.load();
+    pattern.accentMask = accentSteps.load();
+    pattern.velocities = stepVelocities.load();
+    pattern.ratchets = stepRatchets.load();
+    pattern.stepCount = juce::jlimit(1, metrog::StepMask::kMaxSteps, (int)(stepCountParam ? stepCountParam->load() : 8.0f));
+    pattern.subdivisionsPerBar = juce::jlimit(1, 16, (int)(timeSigNumParam ? timeSigNumParam->load() : 4.0f));
+    patternBank.setPattern(index, pattern);
+
+    auto bank = apvts.state.getOrCreateChildWithName(kTreePatternBank, nullptr);
+    auto slot = bank.getChildWithProperty("index", index);
+    if (! slot.isValid())
+    {
+        slot = juce::ValueTree("Pattern");
+        slot.setProperty("index", index, nullptr);
+        bank.appendChild(slot, nullptr);
+    }
+    slot.setProperty("steps", stepMaskToString(pattern.stepMask), nullptr);
+    slot.setProperty("accents", stepMaskToString(pattern.accentMask), nullptr);
+    slot.setProperty("velocities", stepBytesToString(pattern.velocities), nullptr);
+    slot.setProperty("ratchets", stepBytesToString(pattern.ratchets), nullptr);
+    slot.setProperty("stepCount", pattern.stepCount, nullptr);
+    slot.setProperty("numerator", pattern.subdivisionsPerBar, nullptr);
+}
 
-    auto midiMap = apvts.state.getChildWithName("MidiMap");
-    if (! midiMap.isValid()) return;
+void MetroGnomeAudioProcessor::selectPattern (int index, bool quantizeToBar)
+{
+    patternBank.select(index, quantizeToBar);
+}
 
-    for (int i = 0; i < midiMap.getNumProperties(); ++i)
+void MetroGnomeAudioProcessor::rebuildPatternBankFromState()
+{
+    // Slots missing from the state get the default pattern. Nothing is selected: the saved parameters
+    // already describe what was playing.
+    for (int i = 0; i < metrog::PatternBank::kNumPatterns; ++i)
+        patternBank.setPattern(i, {});
+
+    const auto bank = apvts.state.getChildWithName(kTreePatternBank);
+    for (int i = 0; i < bank.getNumChildren(); ++i)
     {
-        const auto name = midiMap.getPropertyName(i);
-        const int cc = (int)midiMap.getProperty(name);
-        if (cc >= 0 && cc < 128)
+        const auto slot = bank.getChild(i);
+        const int index = (int)slot.getProperty("index", -1);
+        if (index < 0 || index >= metrog::PatternBank::kNumPatterns)
+            continue;
+
+        metrog::Pattern pattern;
+        pattern.stepMask = stepMaskFromString(slot.getProperty("steps", {}).toString());
+        pattern.accentMask = stepMaskFromString(slot.getProperty("accents", {}).toString(), {});
+        pattern.velocities = velocitiesFromString(slot.getProperty("velocities", {}).toString());
+        pattern.ratchets = ratchetsFromString(slot.getProperty("ratchets", {}).toString());
+        pattern.stepCount = juce::jlimit(1, metrog::StepMask::kMaxSteps, (int)slot.getProperty("stepCount", 8));
+        pattern.subdivisionsPerBar = juce::jlimit(1, 16, (int)slot.getProperty("numerator", 4));
+        patternBank.setPattern(index, pattern);
+    }
+}
+
+void MetroGnomeAudioProcessor::applyPattern (const metrog::PatternChange& change) noexcept
+{
+    // Like enable/disable-all: raw values only, so the switch sends no parameter changes to the host
+    const auto& pattern = change.pattern;
+    if (stepCountParam) stepCountParam->store((float)pattern.stepCount);
+    if (timeSigNumParam) timeSigNumParam->store((float)pattern.subdivisionsPerBar);
+    for (int i = 0; i < metrog::StepMask::kMaxSteps; ++i)
+        if (auto* p = stepEnabledParams[(size_t)i])
+            p->store(pattern.stepMask.test(i) ? 1.0f : 0.0f);
+    stepMask.store(pattern.stepMask);
+    accentSteps.store(pattern.accentMask);
+    stepVelocities.store(pattern.velocities);
+    stepRatchets.store(pattern.ratchets);
+
+    activePatternIndex.store(change.index, std::memory_order_relaxed);
+    patternSwitchCount.store(patternSwitchCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void MetroGnomeAudioProcessor::syncStateAfterPatternSwitch()
+{
+    // The raw values already hold the new pattern, so writing them into the parameter tree changes no
+    // parameter (and notifies no host); it only makes a saved session keep the pattern
+    const uint32_t switches = patternSwitchCount.load(std::memory_order_acquire);
+    if (switches == syncedPatternSwitchCount)
+        return;
+    syncedPatternSwitchCount = switches;
+
+    auto writeValue = [this] (const juce::String& paramID)
+    {
+        if (auto param = apvts.state.getChildWithProperty("id", paramID); param.isValid())
+            if (const auto* raw = apvts.getRawParameterValue(paramID))
+                param.setProperty("value", raw->load(), nullptr);
+    };
+    writeValue(kParamStepCount);
+    writeValue(kParamTimeSigNum);
+    for (int i = 0; i < metrog::StepMask::kMaxSteps; ++i)
+        writeValue(stepEnabledId(i));
+    writeStepValuesToState();
+}
+
+void MetroGnomeAudioProcessor::setStepVelocity (int step, int velocity)
+{
+    stepVelocities.set(step, (uint8_t)juce::jlimit(0, 127, velocity));
+    writeStepValuesToState();
+}
+
+void MetroGnomeAudioProcessor::setStepAccent (int step, bool accented)
+{
+    accentSteps.set(step, accented);
+    writeStepValuesToState();
+}
+
+void MetroGnomeAudioProcessor::setStepRatchet (int step, int count)
+{
+    stepRatchets.set(step, (uint8_t)juce::jlimit(1, metrog::kMaxRatchets, count));
+    writeStepValuesToState();
+}
+
+void MetroGnomeAudioProcessor::writeStepValuesToState()
+{
+    apvts.state.setProperty(kPropStepVelocities, stepBytesToString(stepVelocities.load()), nullptr);
+    apvts.state.setProperty(kPropStepRatchets, stepBytesToString(stepRatchets.load()), nullptr);
+    apvts.state.setProperty(kPropAccentSteps, stepMaskToString(accentSteps.load()), nullptr);
+}
+
+//==============================================================================
+// Polymetric lanes
+void MetroGnomeAudioProcessor::setLaneConfig (const metrog::LaneConfig& config)
+{
+    laneConfig = config;
+    laneConfig.numLanes = juce::jlimit(0, metrog::LaneConfig::kMaxExtraLanes, config.numLanes);
+    for (auto& lane : laneConfig.lanes)
+    {
+        lane.subdivisionsPerBar = juce::jlimit(1, metrog::LaneParams::kMaxSubdivisions, lane.subdivisionsPerBar);
+        lane.stepCount = juce::jlimit(1, metrog::StepMask::kMaxSteps, lane.stepCount);
+        lane.clickHz = juce::jlimit(100.0f, 10000.0f, lane.clickHz);
+    }
+    laneConfigHandoff.publish(laneConfig);
+
+    auto tree = apvts.state.getOrCreateChildWithName(kTreeLanes, nullptr);
+    tree.removeAllChildren(nullptr);
+    tree.setProperty("numLanes", laneConfig.numLanes, nullptr);
+    for (int i = 0; i < laneConfig.numLanes; ++i)
+    {
+        const auto& lane = laneConfig.lanes[(size_t)i];
+        juce::ValueTree child ("Lane");
+        child.setProperty("subdivisions", lane.subdivisionsPerBar, nullptr);
+        child.setProperty("stepCount", lane.stepCount, nullptr);
+        child.setProperty("steps", stepMaskToString(lane.stepMask), nullptr);
+        child.setProperty("clickHz", lane.clickHz, nullptr);
+        tree.appendChild(child, nullptr);
+    }
+}
+
+void MetroGnomeAudioProcessor::rebuildLaneConfigFromState()
+{
+    metrog::LaneConfig config;
+    const auto tree = apvts.state.getChildWithName(kTreeLanes);
+    config.numLanes = juce::jlimit(0, juce::jmin(metrog::LaneConfig::kMaxExtraLanes, tree.getNumChildren()),
+                                   (int)tree.getProperty("numLanes", 0));
+    for (int i = 0; i < config.numLanes; ++i)
+    {
+        const auto child = tree.getChild(i);
+        auto& lane = config.lanes[(size_t)i];
+        lane.subdivisionsPerBar = juce::jlimit(1, metrog::LaneParams::kMaxSubdivisions, (int)child.getProperty("subdivisions", 3));
+        lane.stepCount = juce::jlimit(1, metrog::StepMask::kMaxSteps, (int)child.getProperty("stepCount", 3));
+        lane.stepMask = stepMaskFromString(child.getProperty("steps", {}).toString());
+        lane.clickHz = juce::jlimit(100.0f, 10000.0f, (float)child.getProperty("clickHz", 2000.0f));
+    }
+
+    laneConfig = config;
+    laneConfigHandoff.publish(laneConfig);
+}
+
+void MetroGnomeAudioProcessor::dispatchPendingControllerChanges()
+{
+    for (size_t cc = 0; cc < pendingCCValues.size(); ++cc)
+    {
+        const int val = pendingCCValues[cc].exchange(-1, std::memory_order_acquire);
+        if (val < 0)
+            continue;
+
+        if (const auto* binding = ccToParam[cc].load(std::memory_order_acquire))
         {
-            if (auto* p = apvts.getParameter(name.toString()))
-                ccToParam[(size_t)cc].store(p, std::memory_order_relaxed);
+            const float norm = juce::jlimit(0.0f, 1.0f, (float)val / 127.0f);
+            binding->param->setValueNotifyingHost (norm);
         }
     }
 }
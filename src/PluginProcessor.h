@@ -3,12 +3,30 @@
 #include <JuceHeader.h>
 #include <array>
 #include <atomic>
+#include <vector>
 #include "Timing.h"
+#include "Sequencer.h"
+#include "StepMask.h"
+#include "PatternBank.h"
+#include "LaneSequencer.h"
+#include "Groove.h"
+#include "SeqLock.h"
+#include "UiSnapshot.h"
+#include "BackgroundImages.h"
+#include "DspLoad.h"
+#include "SpscRing.h"
+#include "TraceLog.h"
 
-class MetroGnomeAudioProcessor : public juce::AudioProcessor
+class MetroGnomeAudioProcessor : public juce::AudioProcessor,
+                                 private juce::Timer,
+                                 private juce::AudioProcessorValueTreeState::Listener
 {
 public:
-    MetroGnomeAudioProcessor();
+    // How the instance is used: by a host (the default), or to render offline on a thread of the
+    // caller's (the click export). An offline instance starts no timer and no timing trace, and
+    // publishes nothing for an editor, the DSP load meter or the beat flash.
+    enum class Mode { host, offline };
+    explicit MetroGnomeAudioProcessor (Mode mode = Mode::host);
     ~MetroGnomeAudioProcessor() override;
 
     // AudioProcessor overrides
@@ -39,12 +57,73 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    bool isOffline() const noexcept { return mode == Mode::offline; }
+
     // Parameter access (for future UI)
     juce::AudioProcessorValueTreeState& getAPVTS() noexcept { return apvts; }
 
     // UI helpers
-    int getCurrentStepIndex() const noexcept { return currentStepIndex.load(); }
-    int getDanceParity() const noexcept { return danceParity.load(); }
+    int getCurrentStepIndex() const noexcept { return sequencer.getCurrentStepIndex(); }
+    int getDanceParity() const noexcept { return sequencer.getDanceParity(); }
+    // Changes whenever the step index or dance parity does (editor repaint trigger)
+    uint32_t getUiGeneration() const noexcept { return sequencer.getUiGeneration(); }
+    // Consistent copy of the playhead/pattern state published by the last processed block (any thread)
+    metrog::UiSnapshot getUiSnapshot() const noexcept { return uiSnapshot.load(); }
+    // Enabled steps as the audio thread sees them (kept in sync with the stepEnabled_N parameters; any thread)
+    metrog::StepMask getStepMask() const noexcept { return stepMask.load(); }
+
+    // Per-step click velocity (0..127), accent (accent timbre) and ratchet count (1..metrog::kMaxRatchets
+    // clicks across the step). Set on the message thread and saved with the state; readable from any thread.
+    void setStepVelocity (int step, int velocity);
+    int getStepVelocity (int step) const noexcept { return stepVelocities.get(step); }
+    void setStepRatchet (int step, int count);
+    int getStepRatchet (int step) const noexcept { return stepRatchets.get(step); }
+    void setStepAccent (int step, bool accented);
+    metrog::StepMask getAccentSteps() const noexcept { return accentSteps.load(); }
+
+    // DSP load telemetry: one sample per processBlock. Single consumer — the editor, or a soak test
+    // when no editor is open. Returns the number of samples copied into dest.
+    size_t popDspLoadSamples (metrog::DspLoadSample* dest, size_t maxSamples) noexcept { return dspLoadRing.popInto(dest, maxSamples); }
+    size_t getDspLoadDroppedCount() const noexcept { return dspLoadRing.getDroppedCount(); }
+
+    // Clicks rendered by the audio thread, timestamped with their expected audible time. Single consumer
+    // (the editor); events pushed while no editor is open are dropped once the FIFO is full.
+    size_t popGateEvents (metrog::GateEvent* dest, size_t maxEvents) noexcept { return gateEventRing.popInto(dest, maxEvents); }
+
+    // Output latency of the audio device, in samples from the start of a callback to its first sample at
+    // the outputs, where the wrapper knows it (the standalone app reads it from its device; -1 = unknown).
+    // Without it gate events assume one buffer. Any thread.
+    void setOutputLatencySamples (int samples) noexcept { outputLatencySamples.store(samples, std::memory_order_relaxed); }
+
+    // Extra delay (ms) added to gate event times for output latency the host doesn't report (converters,
+    // driver buffers, Bluetooth). Message thread; saved with the plugin state.
+    void setVisualLatencyMs (float ms);
+    float getVisualLatencyMs() const noexcept { return visualLatencyMs.load(std::memory_order_relaxed); }
+    static constexpr float kMaxVisualLatencyMs = 250.0f;
+
+    // Pattern bank (message thread). storePattern captures the current steps, step count and numerator into
+    // a slot; selectPattern switches to a slot's pattern without touching the host-visible parameters,
+    // at the next bar line while playing if quantizeToBar is set. The bank is saved with the state.
+    void storePattern (int index);
+    void selectPattern (int index, bool quantizeToBar = true);
+    const metrog::PatternBank& getPatternBank() const noexcept { return patternBank; }
+    // Slot whose pattern the audio thread last installed (-1 = none since load)
+    int getActivePatternIndex() const noexcept { return activePatternIndex.load(std::memory_order_relaxed); }
+
+    // Polymetric lanes clicking alongside the main sequencer, each with its own subdivisions, steps and
+    // pitch (message thread; saved with the state)
+    void setLaneConfig (const metrog::LaneConfig& config);
+    const metrog::LaneConfig& getLaneConfig() const noexcept { return laneConfig; }
+
+    // Timing trace (message thread): records one binary TraceRecord per block on the audio thread and
+    // writes them as Chrome trace-event JSON from a background thread. Also started by METROG_TRACE_FILE.
+    bool startTimingTrace (const juce::File& file);
+    void stopTimingTrace();
+    bool isTimingTraceActive() const noexcept { return traceActive.load(); }
+
+    // How far ahead (samples at sampleRate) the sequencer reads the transport with the current timing
+    // feel: 0 in straight time, more while a click can be early. Any thread.
+    int getLookaheadSamples (double sampleRate) const noexcept;
 
     // MIDI learn API (UI thread)
     void armMidiLearn (const juce::String& paramID);
@@ -56,60 +135,134 @@ public:
     void clearMidiMapping (const juce::String& paramID);
     // Query mapped CC for UI (-1 if none)
     int getMappedCC (const juce::String& paramID) const;
+    // Parameter the audio thread currently drives from this CC (empty if none)
+    juce::String getParameterIDForCC (int cc) const;
+    // Forwards CC values applied on the audio thread to the host/UI (message thread; also run by an internal timer)
+    void dispatchPendingControllerChanges();
 
 private:
+    void timerCallback() override
+    {
+        dispatchPendingControllerChanges();
+        syncStateAfterPatternSwitch();
+        updateOutputLatency();
+    }
+    void updateOutputLatency();
+
+    // Step enable parameters -> stepMask (called on whichever thread changed the parameter)
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+    void syncStepMaskFromParameters();
+
     // Parameter layout
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
-    // Timing engine and cached host info (preallocated, no dynamic work in processBlock)
-    metrog::TimingEngine timing;
+    // Members are grouped by which thread writes them. Audio-thread-written and message-thread-written
+    // atomics each start their own cache line (alignas(64)), so neither side's stores invalidate the
+    // line the other side is working in; read-mostly state sits between them.
+
+    const Mode mode;
+
+    // Sequencer/click engine and cached host info (preallocated, no dynamic work in processBlock).
+    // Audio thread only, apart from the sequencer's step/parity atomics, which own their cache line.
+    metrog::Sequencer sequencer;
+    metrog::LaneSequencer lanes;
     metrog::HostTransportInfo hostInfo;
+    bool prepared = false; // prepareToPlay has run: later calls reconfigure instead of resetting
+
+    // Mono render of each click source, sized in prepareToPlay; used while a separate output is enabled
+    enum { kSourceNormal, kSourceAccents, kSourceLanes, kNumSources };
+    juce::AudioBuffer<float> sourceBuffer;
+    bool hasSeparateOutputs() const noexcept;
+    void renderToBuses (juce::AudioBuffer<float>& buffer, int numSamples, float vol) noexcept;
+    void publishDspLoad (uint64_t callbackStartNs, int numSamples) noexcept;
 
     // Parameters
     juce::AudioProcessorValueTreeState apvts;
     std::atomic<float>* stepCountParam = nullptr;
-    std::array<std::atomic<float>*, 16> stepEnabledParams{};
+    std::array<std::atomic<float>*, metrog::StepMask::kMaxSteps> stepEnabledParams{};
     std::atomic<float>* enableAllParam = nullptr;
     std::atomic<float>* disableAllParam = nullptr;
     std::atomic<float>* volumeParam = nullptr; // 0..1 linear volume
     std::atomic<float>* danceModeParam = nullptr; // UI-only toggle
     std::atomic<float>* timeSigNumParam = nullptr; // 1..16 independent timing numerator
+    std::atomic<float>* accentDownbeatParam = nullptr; // accent timbre on every bar's first subdivision
+    std::atomic<float>* swingParam = nullptr;         // 50..75 %
+    std::atomic<float>* grooveParam = nullptr;         // index into metrog::grooveTemplates()
+    std::atomic<float>* clickOffsetParam = nullptr;    // ms, negative = early
+    std::array<std::atomic<float>*, 3> busLevelParams{}; // 0..1 levels of output buses 1..3
+
+    // The step enables packed one bit per step: the audio thread reads two words per block instead of one
+    // parameter per step. Written from parameter listeners, MIDI CC and enable/disable-all.
+    // Per-step velocities, accents and ratchets live alongside, set from the message thread or a pattern switch.
+    alignas(64) metrog::AtomicStepMask stepMask;
+    metrog::AtomicStepMask accentSteps;
+    metrog::AtomicStepVelocities stepVelocities;
+    metrog::AtomicStepRatchets stepRatchets;
 
     // MIDI learn state (real-time safe communication)
-    std::atomic<bool> midiLearnArmed { false };
+    alignas(64) std::atomic<bool> midiLearnArmed { false }; // set on message thread
     juce::String midiLearnTargetId; // set on message thread
-    std::atomic<int> pendingLearnCC { -1 }; // set in audio thread
+    alignas(64) std::atomic<int> pendingLearnCC { -1 }; // set in audio thread
+    std::atomic<int> activePatternIndex { -1 };         // set in audio thread
+    std::atomic<uint32_t> patternSwitchCount { 0 };     // set in audio thread
+
+    // A learnable parameter with its cached raw value, so the audio thread can apply CCs without lookups
+    struct CCBinding
+    {
+        juce::RangedAudioParameter* param = nullptr;
+        std::atomic<float>* rawValue = nullptr;
+        int stepIndex = -1; // step this parameter enables, or -1
+    };
+    std::vector<CCBinding> ccBindings; // built once in the constructor; never resized afterwards
+
+    // Fast CC->parameter map for audio thread (size 128); read-mostly, written only by learn/clear/load
+    alignas(64) std::array<std::atomic<const CCBinding*>, 128> ccToParam{};
+
+    // Last CC value applied per controller on the audio thread, awaiting host notification (-1 = none)
+    alignas(64) std::array<std::atomic<int>, 128> pendingCCValues{};
 
-    // Fast CC->parameter map for audio thread (size 128)
-    std::array<std::atomic<juce::RangedAudioParameter*>, 128> ccToParam{};
+    // Pattern bank (message thread), its handoff to the audio thread, and the switch the audio thread is
+    // holding for the next bar line (audio thread only)
+    metrog::PatternBank patternBank;
+    metrog::PatternChange pendingPattern;
+    bool hasPendingPattern = false;
+    uint32_t syncedPatternSwitchCount = 0; // message thread
+
+    // Lane setup as edited (message thread) and its handoff to the audio thread
+    metrog::LaneConfig laneConfig;
+    metrog::TripleBuffer<metrog::LaneConfig> laneConfigHandoff;
 
     // Helpers (message thread)
     void rebuildMidiMapFromState();
+    void rebuildPatternBankFromState();
+    void rebuildLaneConfigFromState();
+    void syncStateAfterPatternSwitch();
+    void writeStepValuesToState();
+
+    // Installs a pattern as the current one: raw parameter values and step mask (audio thread)
+    void applyPattern (const metrog::PatternChange& change) noexcept;
+    const CCBinding* findCCBinding (const juce::String& paramID) const;
+
+    // Per-callback timing records for the DSP load meter (preallocated; audio thread is the only producer)
+    metrog::SpscRing<metrog::DspLoadSample, 1024> dspLoadRing;
+    double nanosPerSample = 1.0e9 / 48000.0;
+
+    // Gate events for the editor's latency-compensated beat flash (audio thread is the only producer)
+    metrog::SpscRing<metrog::GateEvent, 256> gateEventRing;
+    std::atomic<int> outputLatencySamples { -1 };
+    std::atomic<float> visualLatencyMs { 0.0f };
+
+    // Keeps the shared editor images decoded for as long as any instance exists, so opening an editor
+    // never waits for (or repeats) the PNG decode
+    juce::SharedResourcePointer<BackgroundImageCache> backgroundImages;
+
+    // UI state published once per block (audio thread writes, editor reads)
+    metrog::SeqLock<metrog::UiSnapshot> uiSnapshot;
 
-    // Sequencer last gate (for Phase 4 triggering), -1 means none this block
-    int lastGateSample = -1;
-    int lastGateStepIndex = -1;
-    int lastGateBarIndex = -1;
-
-    // UI timing info for dance mode (updated on every subdivision crossing)
-    std::atomic<int> currentStepIndex { -1 };
-    std::atomic<int> danceParity { 0 }; // flips on every subdivision crossing for smooth dance alternation
-
-    // Global subdivision counter to ensure full sequence progression regardless of time signature
-    std::atomic<int> globalSubdivisionCounter { 0 };
-
-    // Track last-known host state to align stepping and avoid repeated triggers
-    double lastHostPPQ { -1.0 };
-    bool lastHostIsPlaying { false };
-
-    // Simple click synthesizer state (RT-safe, no allocations)
-    bool clickActive = false;
-    int clickSampleIndex = 0;
-    int clickMaxSamples = 0;   // computed from sample rate (e.g., 10 ms)
-    double clickEnv = 0.0;     // exponential decay envelope
-    double clickDecay = 0.999; // per-sample multiplier
-    double sinePhase = 0.0;
-    double sinePhaseInc = 0.0; // 3 kHz default
+    // RT-safe timing trace: fixed-size records in a preallocated ring, drained by traceWriter's thread
+    metrog::TraceRing traceRing;
+    metrog::TraceWriter traceWriter;
+    std::atomic<bool> traceActive { false };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MetroGnomeAudioProcessor)
 };
@@ -0,0 +1,310 @@
+#include "RtInterposer.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+ #include <execinfo.h>
+ #define METROG_RT_HAVE_BACKTRACE 1
+#else
+ #define METROG_RT_HAVE_BACKTRACE 0
+#endif
+
+// On glibc we can interpose the C allocator and pthread mutexes from inside the executable;
+// elsewhere only the C++ allocation operators are replaced.
+#if defined(__GLIBC__)
+ #include <dlfcn.h>
+ #include <pthread.h>
+ #define METROG_RT_INTERPOSE_LIBC 1
+extern "C"
+{
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void* __libc_memalign (size_t, size_t);
+    void  __libc_free (void*);
+}
+#else
+ #define METROG_RT_INTERPOSE_LIBC 0
+#endif
+
+#if defined(_MSC_VER)
+ #include <malloc.h>
+#endif
+
+namespace
+{
+    std::atomic<uint64_t> violationCount { 0 };
+    std::atomic<int> traceLimit { 16 };
+    thread_local uint64_t threadAllocations = 0;
+    thread_local uint64_t threadMutexLocks = 0;
+
+    void reportViolation (const char* what) noexcept
+    {
+        auto& flag = metrog::rt::inAudioCallback();
+        flag = false; // printing the report may allocate; never recurse into ourselves
+
+        const uint64_t n = violationCount.fetch_add(1) + 1;
+        if (n <= static_cast<uint64_t>(traceLimit.load()))
+        {
+            std::fprintf(stderr, "\n[RT violation #%llu] %s called inside the audio callback\n",
+                         static_cast<unsigned long long>(n), what);
+           #if METROG_RT_HAVE_BACKTRACE
+            void* frames[64];
+            const int count = backtrace(frames, 64);
+            backtrace_symbols_fd(frames, count, fileno(stderr));
+           #endif
+            std::fflush(stderr);
+        }
+
+        flag = true;
+    }
+
+    inline void onAllocation (const char* what) noexcept
+    {
+        ++threadAllocations;
+        if (metrog::rt::inAudioCallback())
+            reportViolation(what);
+    }
+
+    inline void onDeallocation (const void* p, const char* what) noexcept
+    {
+        if (p != nullptr && metrog::rt::inAudioCallback())
+            reportViolation(what);
+    }
+
+    // Raw allocation primitives that bypass our own interposed entry points
+    inline void* rawAlloc (std::size_t size) noexcept
+    {
+       #if METROG_RT_INTERPOSE_LIBC
+        return __libc_malloc(size == 0 ? 1 : size);
+       #else
+        return std::malloc(size == 0 ? 1 : size);
+       #endif
+    }
+
+    inline void rawFree (void* p) noexcept
+    {
+       #if METROG_RT_INTERPOSE_LIBC
+        __libc_free(p);
+       #else
+        std::free(p);
+       #endif
+    }
+
+    inline void* rawAlignedAlloc (std::size_t size, std::size_t align) noexcept
+    {
+        if (size == 0) size = 1;
+       #if METROG_RT_INTERPOSE_LIBC
+        return __libc_memalign(align, size);
+       #elif defined(_MSC_VER)
+        return _aligned_malloc(size, align);
+       #else
+        void* p = nullptr;
+        if (align < sizeof(void*)) align = sizeof(void*);
+        return posix_memalign(&p, align, size) == 0 ? p : nullptr;
+       #endif
+    }
+
+    inline void rawAlignedFree (void* p) noexcept
+    {
+       #if defined(_MSC_VER)
+        _aligned_free(p);
+       #else
+        rawFree(p);
+       #endif
+    }
+
+    // Warm up the unwinder so that the first stack trace does not have to load it mid-report
+    struct BacktraceWarmup
+    {
+        BacktraceWarmup()
+        {
+           #if METROG_RT_HAVE_BACKTRACE
+            void* frames[4];
+            (void) backtrace(frames, 4);
+           #endif
+        }
+    } backtraceWarmup;
+}
+
+//==============================================================================
+namespace metrog
+{
+    namespace rt
+    {
+        InterposerStats getInterposerStats() noexcept
+        {
+            InterposerStats s;
+            s.violations = violationCount.load();
+            s.allocations = threadAllocations;
+            s.mutexLocks = threadMutexLocks;
+            return s;
+        }
+
+        void resetInterposerStats() noexcept
+        {
+            violationCount.store(0);
+            threadAllocations = 0;
+            threadMutexLocks = 0;
+        }
+
+        void setTraceLimit (int maxTraces) noexcept { traceLimit.store(maxTraces); }
+
+        bool interposesCRuntime() noexcept { return METROG_RT_INTERPOSE_LIBC != 0; }
+    }
+}
+
+//==============================================================================
+// C allocator and mutex interposition (glibc)
+#if METROG_RT_INTERPOSE_LIBC
+extern "C"
+{
+    void* malloc (size_t size) noexcept
+    {
+        onAllocation("malloc");
+        return __libc_malloc(size);
+    }
+
+    void* calloc (size_t count, size_t size) noexcept
+    {
+        onAllocation("calloc");
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc (void* p, size_t size) noexcept
+    {
+        onAllocation("realloc");
+        return __libc_realloc(p, size);
+    }
+
+    void* memalign (size_t align, size_t size) noexcept
+    {
+        onAllocation("memalign");
+        return __libc_memalign(align, size);
+    }
+
+    void* aligned_alloc (size_t align, size_t size) noexcept
+    {
+        onAllocation("aligned_alloc");
+        return __libc_memalign(align, size);
+    }
+
+    int posix_memalign (void** out, size_t align, size_t size) noexcept
+    {
+        onAllocation("posix_memalign");
+        void* p = __libc_memalign(align, size);
+        if (p == nullptr)
+            return ENOMEM;
+        *out = p;
+        return 0;
+    }
+
+    void free (void* p) noexcept
+    {
+        onDeallocation(p, "free");
+        __libc_free(p);
+    }
+
+    using MutexFn = int (*) (pthread_mutex_t*);
+
+    static MutexFn resolveMutexFn (const char* name) noexcept
+    {
+        return reinterpret_cast<MutexFn>(dlsym(RTLD_NEXT, name));
+    }
+
+    static MutexFn realMutexLock = resolveMutexFn("pthread_mutex_lock");
+    static MutexFn realMutexUnlock = resolveMutexFn("pthread_mutex_unlock");
+
+    int pthread_mutex_lock (pthread_mutex_t* m) noexcept
+    {
+        if (realMutexLock == nullptr)
+            realMutexLock = resolveMutexFn("pthread_mutex_lock");
+        ++threadMutexLocks;
+        if (metrog::rt::inAudioCallback())
+            reportViolation("pthread_mutex_lock");
+        return realMutexLock(m);
+    }
+
+    int pthread_mutex_unlock (pthread_mutex_t* m) noexcept
+    {
+        if (realMutexUnlock == nullptr)
+            realMutexUnlock = resolveMutexFn("pthread_mutex_unlock");
+        return realMutexUnlock(m);
+    }
+}
+#endif
+
+//==============================================================================
+// C++ allocation operators (all platforms)
+void* operator new (std::size_t size)
+{
+    onAllocation("operator new");
+    if (auto* p = rawAlloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size)
+{
+    onAllocation("operator new[]");
+    if (auto* p = rawAlloc(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    onAllocation("operator new");
+    return rawAlloc(size);
+}
+
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept
+{
+    onAllocation("operator new[]");
+    return rawAlloc(size);
+}
+
+void* operator new (std::size_t size, std::align_val_t align)
+{
+    onAllocation("operator new (aligned)");
+    if (auto* p = rawAlignedAlloc(size, static_cast<std::size_t>(align)))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[] (std::size_t size, std::align_val_t align)
+{
+    onAllocation("operator new[] (aligned)");
+    if (auto* p = rawAlignedAlloc(size, static_cast<std::size_t>(align)))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new (std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+    onAllocation("operator new (aligned)");
+    return rawAlignedAlloc(size, static_cast<std::size_t>(align));
+}
+
+void* operator new[] (std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+    onAllocation("operator new[] (aligned)");
+    return rawAlignedAlloc(size, static_cast<std::size_t>(align));
+}
+
+void operator delete (void* p) noexcept                                  { onDeallocation(p, "operator delete");   rawFree(p); }
+void operator delete[] (void* p) noexcept                                { onDeallocation(p, "operator delete[]"); rawFree(p); }
+void operator delete (void* p, std::size_t) noexcept                     { onDeallocation(p, "operator delete");   rawFree(p); }
+void operator delete[] (void* p, std::size_t) noexcept                   { onDeallocation(p, "operator delete[]"); rawFree(p); }
+void operator delete (void* p, const std::nothrow_t&) noexcept           { onDeallocation(p, "operator delete");   rawFree(p); }
+void operator delete[] (void* p, const std::nothrow_t&) noexcept         { onDeallocation(p, "operator delete[]"); rawFree(p); }
+void operator delete (void* p, std::align_val_t) noexcept                { onDeallocation(p, "operator delete");   rawAlignedFree(p); }
+void operator delete[] (void* p, std::align_val_t) noexcept              { onDeallocation(p, "operator delete[]"); rawAlignedFree(p); }
+void operator delete (void* p, std::size_t, std::align_val_t) noexcept   { onDeallocation(p, "operator delete");   rawAlignedFree(p); }
+void operator delete[] (void* p, std::size_t, std::align_val_t) noexcept { onDeallocation(p, "operator delete[]"); rawAlignedFree(p); }
+void operator delete (void* p, std::align_val_t, const std::nothrow_t&) noexcept   { onDeallocation(p, "operator delete");   rawAlignedFree(p); }
+void operator delete[] (void* p, std::align_val_t, const std::nothrow_t&) noexcept { onDeallocation(p, "operator delete[]"); rawAlignedFree(p); }
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+// Allocation/lock detector for test builds.
+// RtInterposer.cpp replaces malloc/free/new/delete (and pthread mutex locking on glibc) with
+// versions that report a violation, with a stack trace, whenever they are called on a thread that
+// is marked as being inside the audio callback. Only test harnesses link it; the plugin never does.
+namespace metrog
+{
+    namespace rt
+    {
+        // Thread-local "in audio callback" marker consulted by the interposer.
+        inline bool& inAudioCallback() noexcept
+        {
+            static thread_local bool flag = false;
+            return flag;
+        }
+
+        // Marks the current thread as the audio thread for the lifetime of the scope.
+        class ScopedAudioCallback
+        {
+        public:
+            ScopedAudioCallback() noexcept : previous(inAudioCallback()) { inAudioCallback() = true; }
+            ~ScopedAudioCallback() { inAudioCallback() = previous; }
+
+            ScopedAudioCallback(const ScopedAudioCallback&) = delete;
+            ScopedAudioCallback& operator=(const ScopedAudioCallback&) = delete;
+
+        private:
+            bool previous;
+        };
+
+        struct InterposerStats
+        {
+            uint64_t violations = 0;      // process-wide count of RT violations
+            uint64_t allocations = 0;     // allocations made by the calling thread
+            uint64_t mutexLocks = 0;      // mutex locks taken by the calling thread
+        };
+
+        // Returns process-wide violations plus the calling thread's allocation/lock counters.
+        InterposerStats getInterposerStats() noexcept;
+        void resetInterposerStats() noexcept;
+
+        // Maximum number of violations that print a stack trace (the rest are only counted).
+        void setTraceLimit(int maxTraces) noexcept;
+
+        // True when malloc/free and mutex interposition are active (glibc); new/delete are always covered.
+        bool interposesCRuntime() noexcept;
+    }
+}
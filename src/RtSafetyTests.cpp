@@ -0,0 +1,292 @@
+// Instrumented RT-safety test: drives MetroGnomeAudioProcessor through a matrix of sample rates,
+// block sizes, tempos and patterns while RtInterposer.cpp watches for heap allocations and mutex
+// locks on the audio thread. Any violation prints a stack trace and fails the test.
+#include <JuceHeader.h>
+#include <iostream>
+#include <vector>
+#include "PluginProcessor.h"
+#include "OfflineTransport.h"
+#include "RtInterposer.h"
+
+static void setParam (MetroGnomeAudioProcessor& proc, const char* id, float value)
+{
+    if (auto* p = proc.getAPVTS().getParameter(id))
+        p->setValueNotifyingHost(p->convertTo0to1(value));
+}
+
+// Render `seconds` of audio, invoking `midiAt` before each block to fill the block's MIDI.
+template <typename MidiFn>
+static void render (MetroGnomeAudioProcessor& proc, metrog::OfflineTransport& transport,
+                    juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi,
+                    double sampleRate, double seconds, MidiFn&& midiAt)
+{
+    const int blockSize = buffer.getNumSamples();
+    const int numBlocks = static_cast<int>(std::ceil(seconds * sampleRate / blockSize));
+    for (int b = 0; b < numBlocks; ++b)
+    {
+        midi.clear();
+        midiAt(b, midi);
+        {
+            const metrog::rt::ScopedAudioCallback audioThread;
+            proc.processBlock(buffer, midi);
+        }
+        transport.advance(blockSize);
+    }
+}
+
+// Separate outputs enabled and blocks four times longer than prepared for (hosts may exceed the size they
+// announced): the mix goes to the main output only, every separate output stays silent, and the fallback
+// is as RT-safe as the normal path. Blocks of the prepared size do reach the separate outputs.
+static int checkOversizedBlocks()
+{
+    constexpr double sr = 48000.0;
+    constexpr int preparedSize = 256;
+    MetroGnomeAudioProcessor proc;
+    metrog::OfflineTransport transport;
+    transport.setSampleRate(sr);
+    transport.setPlaying(true);
+    proc.enableAllBuses();
+    proc.setPlayHead(&transport);
+    proc.setRateAndBufferSizeDetails(sr, preparedSize);
+    proc.prepareToPlay(sr, preparedSize);
+
+    auto peaks = [&proc, &transport] (int blockSize, float& mainPeak, float& busPeak)
+    {
+        juce::AudioBuffer<float> buffer (proc.getTotalNumOutputChannels(), blockSize);
+        juce::MidiBuffer midi;
+        mainPeak = busPeak = 0.0f;
+        for (int b = 0; b < (int)(2.0 * sr) / blockSize; ++b)
+        {
+            {
+                const metrog::rt::ScopedAudioCallback audioThread;
+                proc.processBlock(buffer, midi);
+            }
+            transport.advance(blockSize);
+            for (int bus = 0; bus < proc.getBusCount(false); ++bus)
+            {
+                const auto busBuffer = proc.getBusBuffer(buffer, false, bus);
+                const float peak = busBuffer.getNumChannels() > 0 ? busBuffer.getMagnitude(0, 0, blockSize) : 0.0f;
+                (bus == 0 ? mainPeak : busPeak) = juce::jmax(bus == 0 ? mainPeak : busPeak, peak);
+            }
+        }
+    };
+
+    int failures = 0;
+    float mainPeak = 0.0f, busPeak = 0.0f;
+    peaks(preparedSize, mainPeak, busPeak);
+    if (mainPeak <= 0.0f || busPeak <= 0.0f) { std::cerr << "separate outputs: prepared-size blocks did not reach every output\n"; ++failures; }
+    peaks(preparedSize * 4, mainPeak, busPeak);
+    if (mainPeak <= 0.0f) { std::cerr << "separate outputs: oversized blocks left the main output silent\n"; ++failures; }
+    if (busPeak != 0.0f) { std::cerr << "separate outputs: oversized blocks copied the mix into the separate outputs\n"; ++failures; }
+    proc.releaseResources();
+    proc.setPlayHead(nullptr);
+    return failures;
+}
+
+// Beat flash events: one per click of the block (gates, ratchet repeats, lane clicks), each stamped at the
+// device's output latency when the wrapper reports one and one buffer after the callback when not
+static int checkGateEvents()
+{
+    constexpr double sr = 48000.0;
+    constexpr int blockSize = 4096;
+    MetroGnomeAudioProcessor proc;
+    metrog::OfflineTransport transport;
+    transport.setSampleRate(sr);
+    proc.setPlayHead(&transport);
+    proc.setRateAndBufferSizeDetails(sr, blockSize);
+    proc.prepareToPlay(sr, blockSize);
+    setParam(proc, "timeSigNum", 4.0f);
+    setParam(proc, "stepCount", 4.0f);
+    proc.setStepRatchet(1, 3);
+    metrog::LaneConfig lanes;
+    lanes.numLanes = 1;
+    lanes.lanes[0].subdivisionsPerBar = 3;
+    lanes.lanes[0].stepCount = 3;
+    proc.setLaneConfig(lanes);
+
+    juce::AudioBuffer<float> buffer (proc.getTotalNumOutputChannels(), blockSize);
+    juce::MidiBuffer midi;
+    metrog::GateEvent gates[64];
+    int failures = 0;
+
+    // One block from ppq 0.9: the step-1 gate lands 2400 samples in (0.1 quarter at 120 BPM)
+    auto gateDelayNs = [&] (int outputLatency) -> int64_t
+    {
+        while (proc.popGateEvents(gates, 64) > 0) {}
+        proc.setOutputLatencySamples(outputLatency);
+        transport.setPlaying(false);
+        transport.setPpqPosition(0.9);
+        proc.processBlock(buffer, midi);
+        transport.setPlaying(true);
+        const uint64_t before = metrog::monotonicNanos();
+        proc.processBlock(buffer, midi);
+        const uint64_t after = metrog::monotonicNanos();
+        const size_t n = proc.popGateEvents(gates, 64);
+        if (n == 0 || gates[0].stepIndex != 1 || gates[0].lane != metrog::GateEvent::kMainLane)
+            return -1;
+        const int64_t expected = (int64_t)((outputLatency >= 0 ? outputLatency : blockSize) + 2400) * 1000000000LL / (int64_t)sr;
+        const int64_t measured = (int64_t)(gates[0].audibleNs - before);
+        return measured + 1000 >= expected && measured <= expected + (int64_t)(after - before) + 1000 ? 0 : measured - expected;
+    };
+    if (const auto error = gateDelayNs(-1); error != 0) { std::cerr << "gate events: unknown output latency not taken as one buffer (off by " << error << " ns)\n"; ++failures; }
+    if (const auto error = gateDelayNs(1000); error != 0) { std::cerr << "gate events: reported output latency ignored (off by " << error << " ns)\n"; ++failures; }
+
+    // A bar from ppq 0: gates on steps 1-3 (play starts on the bar line, which is skipped), step 1's two
+    // repeats, and the lane's clicks at 4/3 and 8/3
+    while (proc.popGateEvents(gates, 64) > 0) {}
+    transport.setPlaying(false);
+    transport.setPpqPosition(0.0);
+    proc.processBlock(buffer, midi);
+    transport.setPlaying(true);
+    int mainClicks = 0, laneClicks = 0;
+    uint64_t last = 0;
+    for (int b = 0; b < (int)(2.0 * sr) / blockSize; ++b)
+    {
+        proc.processBlock(buffer, midi);
+        transport.advance(blockSize);
+        for (size_t i = 0, n = proc.popGateEvents(gates, 64); i < n; ++i)
+        {
+            (gates[i].lane == metrog::GateEvent::kMainLane ? mainClicks : laneClicks)++;
+            if (gates[i].audibleNs < last) { std::cerr << "gate events: out of time order\n"; ++failures; }
+            last = gates[i].audibleNs;
+        }
+    }
+    if (mainClicks != 5 || laneClicks != 2) { std::cerr << "gate events: " << mainClicks << " main and " << laneClicks << " lane events in a bar, expected 5 and 2\n"; ++failures; }
+    proc.releaseResources();
+    proc.setPlayHead(nullptr);
+    return failures;
+}
+
+static int runTests()
+{
+    const juce::ScopedJuceInitialiser_GUI juceInit;
+    metrog::rt::resetInterposerStats();
+
+    const std::vector<double> sampleRates = { 44100.0, 48000.0, 96000.0 };
+    const std::vector<int> blockSizes = { 1, 32, 64, 256, 1024 };
+    const std::vector<double> tempos = { 60.0, 120.0, 240.0 };
+    const std::vector<int> numerators = { 3, 4, 7 };
+    const std::vector<int> stepCounts = { 1, 5, 16, 128 };
+
+    int cases = 0;
+    for (double sr : sampleRates)
+    for (int bs : blockSizes)
+    {
+        // One processor per device configuration, as a host would do
+        MetroGnomeAudioProcessor proc;
+        metrog::OfflineTransport transport;
+        transport.setSampleRate(sr);
+        proc.setPlayHead(&transport);
+        proc.setRateAndBufferSizeDetails(sr, bs);
+        proc.prepareToPlay(sr, bs);
+
+        juce::AudioBuffer<float> buffer(2, bs);
+        juce::MidiBuffer midi;
+        midi.ensureSize(256);
+
+        // MIDI-learn CC 7 onto volume: capture happens on the audio thread, commit on the message thread
+        proc.armMidiLearn("volume");
+        render(proc, transport, buffer, midi, sr, 0.01, [] (int b, juce::MidiBuffer& m)
+        {
+            if (b == 0) m.addEvent(juce::MidiMessage::controllerEvent(1, 7, 100), 0);
+        });
+        proc.commitPendingMidiLearn();
+
+        // Every polymetric lane in use, 2..16 clicks per bar
+        metrog::LaneConfig laneConfig;
+        laneConfig.numLanes = metrog::LaneConfig::kMaxExtraLanes;
+        for (int l = 0; l < laneConfig.numLanes; ++l)
+        {
+            laneConfig.lanes[(size_t)l].subdivisionsPerBar = l + 2;
+            laneConfig.lanes[(size_t)l].stepCount = l + 2;
+        }
+        proc.setLaneConfig(laneConfig);
+
+        for (double bpm : tempos)
+        for (int numer : numerators)
+        for (int steps : stepCounts)
+        {
+            ++cases;
+            transport.setTempo(bpm);
+            transport.setTimeSigNumerator(numer);
+            setParam(proc, "timeSigNum", static_cast<float>(numer));
+            setParam(proc, "stepCount", static_cast<float>(steps));
+            setParam(proc, "danceMode", (cases & 1) ? 1.0f : 0.0f);
+            setParam(proc, "stepEnabled_2", 0.0f);
+
+            // Stopped: playhead follows host position without gates
+            transport.setPlaying(false);
+            transport.setPpqPosition(1.5);
+            render(proc, transport, buffer, midi, sr, 0.05, [] (int, juce::MidiBuffer&) {});
+
+            // Play from a bar line with mapped CC traffic
+            transport.setPpqPosition(0.0);
+            transport.setPlaying(true);
+            render(proc, transport, buffer, midi, sr, 0.75, [] (int b, juce::MidiBuffer& m)
+            {
+                if (b % 7 == 0)
+                    m.addEvent(juce::MidiMessage::controllerEvent(1, 7, (b * 13) % 128), 0);
+                if (b % 11 == 0)
+                    m.addEvent(juce::MidiMessage::controllerEvent(1, 20, 64), 0); // unmapped
+            });
+            proc.dispatchPendingControllerChanges();
+
+            // Enable/disable-all momentary actions handled inside the callback
+            setParam(proc, "disableAll", 1.0f);
+            render(proc, transport, buffer, midi, sr, 0.1, [] (int, juce::MidiBuffer&) {});
+            setParam(proc, "enableAll", 1.0f);
+            render(proc, transport, buffer, midi, sr, 0.1, [] (int, juce::MidiBuffer&) {});
+
+            // Quiet, accented and ratcheted steps, and accented downbeats
+            proc.setStepVelocity(1, 40);
+            proc.setStepAccent(2, true);
+            proc.setStepRatchet(0, 8);
+            proc.setStepRatchet(3, 5);
+            setParam(proc, "accentDownbeat", 1.0f);
+            render(proc, transport, buffer, midi, sr, 0.1, [] (int, juce::MidiBuffer&) {});
+
+            // Swing, a groove that leans early and a negative offset: the sequencer looks ahead and the
+            // queued clicks cross block edges
+            setParam(proc, "swing", 66.0f);
+            setParam(proc, "groove", 4.0f);
+            setParam(proc, "clickOffsetMs", -20.0f);
+            render(proc, transport, buffer, midi, sr, 0.3, [] (int, juce::MidiBuffer&) {});
+            setParam(proc, "clickOffsetMs", 0.0f);
+            setParam(proc, "groove", 0.0f);
+            render(proc, transport, buffer, midi, sr, 0.1, [] (int, juce::MidiBuffer&) {});
+
+            // Pattern bank switches: one waiting for the bar line just ahead, one immediate
+            proc.storePattern(1);
+            proc.selectPattern(1, true);
+            transport.setPpqPosition((double)numer - 0.05);
+            render(proc, transport, buffer, midi, sr, 0.1, [] (int, juce::MidiBuffer&) {});
+            proc.selectPattern(0, false);
+            render(proc, transport, buffer, midi, sr, 0.05, [] (int, juce::MidiBuffer&) {});
+
+            // Loop jump back to the start of the bar while playing
+            transport.setPpqPosition(0.0);
+            render(proc, transport, buffer, midi, sr, 0.25, [] (int, juce::MidiBuffer&) {});
+            proc.dispatchPendingControllerChanges();
+        }
+
+        proc.releaseResources();
+        proc.setPlayHead(nullptr);
+    }
+    const int routingFailures = checkOversizedBlocks() + checkGateEvents();
+
+    const auto stats = metrog::rt::getInterposerStats();
+    if (! metrog::rt::interposesCRuntime())
+        std::cout << "Note: malloc/free and mutex interposition unavailable on this platform; checked operator new/delete only." << std::endl;
+
+    if (stats.violations == 0 && routingFailures == 0)
+        std::cout << "All RT safety tests passed (" << cases << " cases)." << std::endl;
+    else if (stats.violations != 0)
+        std::cout << stats.violations << " RT violation(s) in processBlock across " << cases << " cases." << std::endl;
+
+    return stats.violations == 0 && routingFailures == 0 ? 0 : 1;
+}
+
+int main()
+{
+    return runTests();
+}
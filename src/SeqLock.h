@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace metrog
+{
+    // Single-writer sequence lock for small trivially copyable values. The writer never waits (audio thread);
+    // readers retry until they copy a version that no write overlapped. The payload is held in atomic
+    // words, so concurrent access is well-defined (and ThreadSanitizer-clean) without locks.
+    template <typename T>
+    class SeqLock
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "SeqLock values must be trivially copyable");
+        static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    public:
+        SeqLock() noexcept { store(T{}); }
+
+        // Writer side (one thread only)
+        void store (const T& value) noexcept
+        {
+            std::array<uint64_t, kWords> words{};
+            std::memcpy(words.data(), &value, sizeof(T));
+
+            // Release on each word keeps the odd sequence visible before any new payload word (no fences,
+            // which ThreadSanitizer does not model; on x86/ARM64 these are plain or stlr stores)
+            const uint32_t s = sequence.load(std::memory_order_relaxed);
+            sequence.store(s + 1, std::memory_order_relaxed); // odd: write in progress
+            for (size_t i = 0; i < kWords; ++i)
+                data[i].store(words[i], std::memory_order_release);
+            sequence.store(s + 2, std::memory_order_release);
+        }
+
+        // Reader side: one attempt; false if a write was in progress or overlapped the copy
+        bool tryLoad (T& out) const noexcept
+        {
+            const uint32_t before = sequence.load(std::memory_order_acquire);
+            if ((before & 1u) != 0)
+                return false;
+
+            std::array<uint64_t, kWords> words;
+            for (size_t i = 0; i < kWords; ++i)
+                words[i] = data[i].load(std::memory_order_acquire); // keeps the re-check below after the copy
+
+            if (sequence.load(std::memory_order_relaxed) != before)
+                return false;
+
+            std::memcpy(static_cast<void*>(&out), words.data(), sizeof(T));
+            return true;
+        }
+
+        // Reader side: retries until a consistent copy is obtained (writes are a few stores long)
+        T load() const noexcept
+        {
+            T value;
+            while (! tryLoad(value)) {}
+            return value;
+        }
+
+    private:
+        alignas(64) std::atomic<uint32_t> sequence { 0 };
+        std::array<std::atomic<uint64_t>, kWords> data{};
+    };
+}
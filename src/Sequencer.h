@@ -0,0 +1,626 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include "Timing.h"
+#include "StepMask.h"
+#include "ClickQueue.h"
+#include "Groove.h"
+
+namespace metrog
+{
+    // One playhead reading as reported by the host; zero/negative fields mean "not provided".
+    struct HostPosition
+    {
+        bool isPlaying = false;
+        double bpm = 0.0;
+        int timeSigNumerator = 0;
+        int timeSigDenominator = 0;
+        double ppqPosition = 0.0;
+        bool hasLastBarStart = false;   // lastBarStartPpq may be negative (count-ins), so it has a flag
+        double lastBarStartPpq = 0.0;
+        int64_t barCount = -1;          // bars before lastBarStartPpq
+    };
+
+    // Merge a playhead reading into cached transport info, keeping last known values for omitted fields.
+    inline void applyHostPosition (HostTransportInfo& host, const HostPosition& pos) noexcept
+    {
+        // Always update play/stop state
+        host.isPlaying = pos.isPlaying;
+
+        // Update known-good fields only; keep cached values if host omits (returns 0/<=0)
+        if (pos.bpm > 0.0)
+            host.tempoBPM = pos.bpm;
+
+        if (pos.timeSigNumerator > 0)
+            host.timeSigNumerator = pos.timeSigNumerator;
+
+        if (pos.timeSigDenominator > 0)
+            host.timeSigDenominator = pos.timeSigDenominator;
+
+        // PPQ: allow 0.0 at the exact start when playing; otherwise, if host provides non-zero, accept it.
+        if (pos.isPlaying || pos.ppqPosition != 0.0)
+        {
+            host.ppqPosition = pos.ppqPosition;
+
+            // Bars count from the host's last bar line, so after a meter change they follow the new meter
+            // from where the host put it. Without one (or one past the position), from ppq 0, which is
+            // right for a song in one meter. Without a bar count, the bar line's index is estimated in the
+            // current meter; it only numbers bars and steps, never moves a click.
+            if (pos.hasLastBarStart && pos.lastBarStartPpq <= pos.ppqPosition + 1e-9)
+            {
+                host.barStartPpq = std::min(pos.lastBarStartPpq, pos.ppqPosition);
+                host.barStartIndex = pos.barCount >= 0 ? (int)pos.barCount
+                                                       : (int)std::floor(host.barStartPpq / TimingEngine::quartersPerBar(host) + 0.5);
+            }
+            else
+            {
+                host.barStartPpq = 0.0;
+                host.barStartIndex = 0;
+            }
+        }
+    }
+
+    // A complete step pattern, as stored in a pattern bank slot and installed by a pattern switch
+    struct Pattern
+    {
+        StepMask stepMask = StepMask::allEnabled();
+        StepMask accentMask;            // accented steps
+        StepVelocityArray velocities = fullVelocities();
+        StepRatchetArray ratchets = singleRatchets();
+        int stepCount = 8;              // 1..StepMask::kMaxSteps
+        int subdivisionsPerBar = 4;     // the time signature numerator parameter
+    };
+
+    // Per-block sequencer inputs, read from parameters by the caller
+    struct SequencerParams
+    {
+        int stepCount = 8;                              // 1..StepMask::kMaxSteps
+        StepMask stepMask = StepMask::allEnabled();     // bit i set = step i enabled
+
+        // Click level and timbre: per-step velocities (null = all full), accented steps, and whether the
+        // first subdivision of every bar is accented too
+        const AtomicStepVelocities* velocities = nullptr;
+        StepMask accentMask;
+        bool accentDownbeats = false;
+
+        // Clicks per step, spread evenly across its subdivision (null = one each)
+        const AtomicStepRatchets* ratchets = nullptr;
+
+        // Pattern that replaces the above at the next bar line (bar-quantized switch), or null. The block
+        // that reaches the bar line reports barSwitch; the caller then makes it its current pattern.
+        const Pattern* atNextBar = nullptr;
+
+        // Timing feel. advance() looks for boundaries lookaheadSamples ahead of the block, and each click
+        // sounds that much plus its offset later: swing on every second subdivision of the bar (a fraction
+        // of a subdivision, 0..0.5), the groove template's offset, and offsetSamples (negative = early).
+        // A click can be early by at most the lookahead.
+        int lookaheadSamples = 0;
+        int offsetSamples = 0;
+        float swing = 0.0f;
+        const GrooveTemplate* groove = nullptr;
+    };
+
+    // A click starting in a block: the step's gate or one of its ratchet repeats
+    struct ClickEvent
+    {
+        int sample = 0;         // in the block as seen lookaheadSamples ahead
+        int delay = 0;          // samples from there until the click sounds
+        float level = 1.0f;
+        bool accent = false;
+        int step = -1;          // the step it belongs to (a ratchet repeat's is its gated step's)...
+        int bar = -1;           // ...and that step's bar
+    };
+
+    // What happened in the last advanced block (gate fields are -1 when no click was triggered)
+    struct SequencerBlock
+    {
+        // The last step's remaining repeats, the gate and the new step's repeats
+        static constexpr int kMaxClicks = 2 * kMaxRatchets;
+
+        SubdivisionCrossing crossing{};
+        bool playing = false;
+        bool playStateChanged = false;
+        bool suppressedBoundary = false; // play started exactly on a bar line; first boundary skipped
+        bool idle = false;               // stopped with nothing to update or render; the block was skipped
+        bool barSwitch = false;          // params.atNextBar took over at this block's bar line
+        int globalIndex = -1;            // global subdivision counter at the crossing
+        int gateSample = -1;             // in the block as seen lookaheadSamples ahead
+        int gateStepIndex = -1;
+        int gateBarIndex = -1;
+        float gateLevel = 1.0f;          // click gain from the step's velocity
+        bool gateAccent = false;         // accent timbre
+        int gateDelay = 0;               // samples from gateSample until the click sounds (lookahead + offset)
+
+        // Every click starting in this block, gate included, in sample order
+        std::array<ClickEvent, kMaxClicks> clicks{};
+        int numClicks = 0;
+    };
+
+    // Short sine burst with exponential decay (RT-safe, no allocations)
+    class ClickVoice
+    {
+    public:
+        static constexpr double kAccentPitchRatio = 1.5; // accented clicks sound a fifth higher
+
+        void prepare (double sampleRate, double frequencyHz = 3000.0) noexcept
+        {
+            setSampleRate(sampleRate, frequencyHz);
+            phase = 0.0;
+            phaseInc = normalPhaseInc;
+            active = false;
+            env = 0.0;
+            sampleIndex = 0;
+        }
+
+        // Recomputes the rate-dependent coefficients (short sine burst with exponential decay). A click
+        // still ringing carries on from the same point in time, at the new rate.
+        void setSampleRate (double sampleRate, double frequencyHz = 3000.0) noexcept
+        {
+            const double clickMs = 10.0; // 10 ms max length
+            maxSamples = static_cast<int>(std::round((clickMs * 0.001) * sampleRate));
+            if (maxSamples < 1) maxSamples = 1;
+            const double decayMs = 4.0; // ~4 ms decay constant
+            const double tauSamples = (decayMs * 0.001) * sampleRate;
+            if (tauSamples > 0.0)
+                decay = std::exp(-1.0 / tauSamples);
+            else
+                decay = 0.0;
+            normalPhaseInc = twoPi * frequencyHz / std::max(1.0, sampleRate);
+            accentPhaseInc = normalPhaseInc * kAccentPitchRatio;
+            if (active && rate > 0.0)
+                sampleIndex = static_cast<int>(std::lround(sampleIndex * sampleRate / rate));
+            phaseInc = accented ? accentPhaseInc : normalPhaseInc;
+            rate = sampleRate;
+        }
+
+        // Retrigger the envelope (sample-accurate; call right before rendering the gate sample) at a level
+        // (the caller multiplies it into the gain passed to next()) and timbre
+        void trigger (float newLevel = 1.0f, bool accent = false) noexcept
+        {
+            level = newLevel;
+            accented = accent;
+            phaseInc = accent ? accentPhaseInc : normalPhaseInc;
+            active = true;
+            env = 1.0;
+            sampleIndex = 0;
+            phase = 0.0; // reset for sharp transient
+        }
+
+        bool isActive() const noexcept { return active; }
+        float getLevel() const noexcept { return level; }
+        bool isAccent() const noexcept { return accented; }
+
+        // Next output sample scaled by gain; 0 when idle
+        float next (float gain) noexcept
+        {
+            if (! active)
+                return 0.0f;
+
+            const float tone = static_cast<float>(std::sin(phase));
+            phase += phaseInc;
+            if (phase >= twoPi)
+                phase -= twoPi;
+
+            const float e = static_cast<float>(env);
+            const float value = e * tone * gain;
+
+            // advance envelope
+            env *= decay;
+            ++sampleIndex;
+            if (sampleIndex >= maxSamples || env < 1.0e-4)
+                active = false;
+            return value;
+        }
+
+    private:
+        static constexpr double twoPi = 6.283185307179586476925286766559;
+
+        bool active = false;
+        int sampleIndex = 0;
+        int maxSamples = 0;   // computed from sample rate (e.g., 10 ms)
+        double rate = 0.0;
+        double env = 0.0;     // exponential decay envelope
+        double decay = 0.999; // per-sample multiplier
+        double phase = 0.0;
+        double phaseInc = 0.0; // for the current click
+        double normalPhaseInc = 0.0, accentPhaseInc = 0.0;
+        float level = 1.0f;
+        bool accented = false;
+    };
+
+    // Host-locked step sequencer and click renderer: everything processBlock does after reading
+    // parameters and the playhead. Pure C++ so offline renders and tests run the exact audio path.
+    // advance()/render() run on the audio thread; the step/parity getters are safe from any thread.
+    class Sequencer
+    {
+    public:
+        void prepare (double newSampleRate, int maxBlockSize) noexcept
+        {
+            sampleRate = newSampleRate;
+            timing.prepare(sampleRate, maxBlockSize);
+            pending.clear();
+            sampleClock = 0;
+
+            // Reset UI indices/parity
+            currentStepIndex.store(-1);
+            danceParity.store(0);
+            globalSubdivisionCounter.store(0);
+            lastStepCount = -1; // the first block after prepare is never idle
+            uiGeneration.store(uiGeneration.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+            for (auto& voice : voices)
+                voice.prepare(sampleRate);
+            nextVoice = 0;
+            ratchet = {};
+        }
+
+        // Takes a new sample rate or maximum block size without the reset prepare() does: the step
+        // position, dance parity, clicks waiting for their sample and clicks still ringing all carry on,
+        // the waiting ones rescheduled for the same time at the new rate. A host that changes its buffer
+        // size mid-session (toggling low-latency monitoring, say) then neither drops a beat nor resets
+        // the editor.
+        void reconfigure (double newSampleRate, int maxBlockSize) noexcept
+        {
+            const double ratio = newSampleRate / sampleRate;
+            sampleRate = newSampleRate;
+            timing.prepare(sampleRate, maxBlockSize);
+            if (ratio == 1.0)
+                return;
+
+            pending.rescale(sampleClock, ratio);
+            for (auto& voice : voices)
+                voice.setSampleRate(sampleRate);
+            ratchet.delay = (int)std::lround(ratchet.delay * ratio);
+            // The same lookahead in time (as the caller works it out) is not a relocation
+            lastLookaheadSamples = (int)std::lround(lastLookaheadSamples * ratio);
+        }
+
+        void setSubdivisionsPerBar (int count) noexcept
+        {
+            if (timing.getSubdivisionsPerBar() != count)
+                timing.setSubdivisionsPerBar(count);
+        }
+        int getSubdivisionsPerBar() const noexcept { return timing.getSubdivisionsPerBar(); }
+
+        // Advance the sequence over one block: align to the host, detect the subdivision crossing and
+        // decide the gate. Returns the block's events for render() and diagnostics. While playing, all of
+        // this happens params.lookaheadSamples ahead of the transport (so the step index runs that far
+        // ahead too); render() delays the click back into place.
+        const SequencerBlock& advance (const HostTransportInfo& transport, const SequencerParams& params, int numSamples) noexcept
+        {
+            const HostTransportInfo host = lookaheadPosition(transport, params.lookaheadSamples, sampleRate);
+            const int stepCount = params.stepCount;
+            const int subdivisionsPerBar = timing.getSubdivisionsPerBar();
+
+            // Everything below would reproduce the previous block, so skip it
+            if (isIdle(host, stepCount))
+            {
+                block = SequencerBlock{};
+                block.idle = true;
+                return block;
+            }
+            lastStepCount = stepCount;
+            lastTimeSigNumerator = host.timeSigNumerator;
+            lastTimeSigDenominator = host.timeSigDenominator;
+            lastBarStartPpq = host.barStartPpq;
+            lastSubdivisionsPerBar = subdivisionsPerBar;
+
+            const int stepBefore = currentStepIndex.load(std::memory_order_relaxed);
+            const int parityBefore = danceParity.load(std::memory_order_relaxed);
+
+            // Compute host-aligned indices and debounce start-of-transport glitches
+            const double ppqNow = host.ppqPosition;
+            const bool isPlayingNow = host.isPlaying;
+            const bool playStateChanged = (isPlayingNow != lastHostIsPlaying);
+            const bool ppqAdvanced = (ppqNow > lastHostPPQ + 1e-9) || playStateChanged;
+
+            // A new lookahead moves the position we look at like a relocation: realign, and forget clicks
+            // scheduled from the old one (they would sound twice). Stopping drops the clicks still ahead.
+            const bool lookaheadChanged = params.lookaheadSamples != lastLookaheadSamples;
+            lastLookaheadSamples = params.lookaheadSamples;
+            if (lookaheadChanged || (playStateChanged && ! isPlayingNow))
+                pending.clear();
+
+            // Bars of the host's meter, counted from its bar line
+            const double beatsPerBarD = TimingEngine::quartersPerBar(host);
+            const double fromBarLine = ppqNow - host.barStartPpq;
+
+            auto computeGlobalFromHost = [&]() -> int
+            {
+                // Before the bar line (a pre-roll or count-in before bar 1): subdivisions count up to it
+                if (fromBarLine < 0.0)
+                {
+                    const double subLenBeats = beatsPerBarD / (double)subdivisionsPerBar;
+                    return host.barStartIndex * subdivisionsPerBar + (int)std::floor(fromBarLine / subLenBeats);
+                }
+                const int barIdx = host.barStartIndex + (int)std::floor(fromBarLine / beatsPerBarD);
+                const int subIdx = TimingEngine::subdivisionIndexInBar(fromBarLine, beatsPerBarD, subdivisionsPerBar);
+                const int global = barIdx * subdivisionsPerBar + subIdx;
+                return global >= 0 ? global : 0;
+            };
+
+            if (!isPlayingNow)
+            {
+                // When stopped, reflect host playhead position in UI without emitting gates
+                const int globalHost = computeGlobalFromHost();
+                const int stepIdx = (stepCount > 0) ? ((globalHost % stepCount) + stepCount) % stepCount : 0;
+                currentStepIndex.store(stepIdx);
+            }
+            else if (playStateChanged || lookaheadChanged)
+            {
+                // Align our global counter with host position on play start or play/stop toggle
+                const int globalHost = computeGlobalFromHost();
+                globalSubdivisionCounter.store(globalHost);
+                const int stepIdx = (stepCount > 0) ? ((globalHost % stepCount) + stepCount) % stepCount : 0;
+                currentStepIndex.store(stepIdx);
+                danceParity.store(globalHost & 1);
+            }
+
+            block = SequencerBlock{};
+            block.playing = isPlayingNow;
+            block.playStateChanged = playStateChanged;
+
+            // Compute subdivision crossing for this block only if host position advanced
+            bool suppressFirstBlockBoundary = false;
+            if (isPlayingNow)
+            {
+                double barPosBeats = std::fmod(std::max(fromBarLine, 0.0), beatsPerBarD);
+                if (barPosBeats < 0.0) barPosBeats = 0.0;
+                const double eps = 1e-9 * beatsPerBarD;
+                const bool atBoundary = (barPosBeats <= eps) || (beatsPerBarD - barPosBeats <= eps);
+                suppressFirstBlockBoundary = playStateChanged && atBoundary;
+            }
+            block.suppressedBoundary = suppressFirstBlockBoundary;
+            if (isPlayingNow && ppqAdvanced && !suppressFirstBlockBoundary)
+                block.crossing = timing.findFirstSubdivisionCrossing(host, numSamples);
+
+            // Repeats of the last gated step still to come before this block's crossing, unless playback
+            // restarted or moved back (its subdivision is then somewhere else)
+            if (! isPlayingNow || playStateChanged || lookaheadChanged || ! ppqAdvanced)
+                ratchet.count = 0;
+            addRatchetClicks(host, 0, block.crossing.crosses ? block.crossing.firstCrossingSample : numSamples);
+
+            if (block.crossing.crosses)
+            {
+                // A queued pattern takes over on the bar line: this crossing already plays it, and later
+                // blocks find its subdivisions in the timing engine
+                ratchet.count = 0; // the last step's subdivision is over
+                int crossingStepCount = stepCount;
+                const StepMask* crossingMask = &params.stepMask;
+                const StepMask* crossingAccents = &params.accentMask;
+                const Pattern* switchedTo = nullptr;
+                if (params.atNextBar != nullptr && block.crossing.subdivisionIndex == 0)
+                {
+                    switchedTo = params.atNextBar;
+                    crossingStepCount = params.atNextBar->stepCount;
+                    crossingMask = &params.atNextBar->stepMask;
+                    crossingAccents = &params.atNextBar->accentMask;
+                    setSubdivisionsPerBar(params.atNextBar->subdivisionsPerBar);
+                    lastStepCount = crossingStepCount;
+                    lastSubdivisionsPerBar = timing.getSubdivisionsPerBar();
+                    block.barSwitch = true;
+                }
+
+                // Use a global counter to avoid resetting on each bar; guarantees full sequence progression
+                const int globalIdx = globalSubdivisionCounter.fetch_add(1) + 1; // post-increment returns previous
+                block.globalIndex = globalIdx;
+                const int stepIdx = (crossingStepCount > 0) ? ((globalIdx % crossingStepCount) + crossingStepCount) % crossingStepCount : 0;
+                // Update UI-visible current step index regardless of enabled state
+                currentStepIndex.store(stepIdx);
+                // Flip dance parity on every subdivision crossing for smooth alternation
+                danceParity.fetch_xor(1);
+
+                const bool stepEnabled = crossingMask->test(stepIdx);
+                if (stepEnabled)
+                {
+                    block.gateSample = block.crossing.firstCrossingSample;
+                    block.gateStepIndex = stepIdx;
+                    block.gateBarIndex = block.crossing.barIndex;
+
+                    // Level and timbre are decided once per click, not per sample
+                    uint8_t velocity = 127;
+                    if (switchedTo != nullptr)
+                        velocity = switchedTo->velocities[(size_t)stepIdx];
+                    else if (params.velocities != nullptr)
+                        velocity = params.velocities->get(stepIdx);
+                    block.gateLevel = velocityToGain(velocity);
+                    block.gateAccent = crossingAccents->test(stepIdx)
+                                       || (params.accentDownbeats && block.crossing.subdivisionIndex == 0);
+
+                    // When it sounds: back from the lookahead, then swing/groove (scaled to this tempo's
+                    // subdivision) and the fixed offset
+                    const double samplesPerSubdivision = TimingEngine::quartersPerBar(host) / (double)timing.getSubdivisionsPerBar() * 60.0 / host.tempoBPM * sampleRate;
+                    const double offset = grooveOffset(block.crossing.subdivisionIndex, params.swing, params.groove) * samplesPerSubdivision
+                                          + (double)params.offsetSamples;
+                    block.gateDelay = std::max(0, params.lookaheadSamples + (int)std::lround(offset));
+                    block.clicks[(size_t)block.numClicks++] = { block.gateSample, block.gateDelay, block.gateLevel, block.gateAccent,
+                                                                stepIdx, block.gateBarIndex };
+
+                    // Its repeats: this block's now, later ones in the blocks they fall in
+                    ratchet.count = switchedTo != nullptr ? (int)switchedTo->ratchets[(size_t)stepIdx]
+                                                          : (params.ratchets != nullptr ? (int)params.ratchets->get(stepIdx) : 1);
+                    const double beatsPerSample = host.tempoBPM / 60.0 / sampleRate;
+                    ratchet.boundaryPpq = timing.subdivisionStartPpq(host, host.ppqPosition + block.gateSample * beatsPerSample);
+                    ratchet.delay = block.gateDelay;
+                    ratchet.level = block.gateLevel;
+                    ratchet.accent = block.gateAccent;
+                    ratchet.step = stepIdx;
+                    ratchet.bar = block.gateBarIndex;
+                    addRatchetClicks(host, block.gateSample + 1, numSamples);
+                }
+            }
+
+            // Publish a new UI generation only when something the editor draws has changed
+            if (currentStepIndex.load(std::memory_order_relaxed) != stepBefore
+                || danceParity.load(std::memory_order_relaxed) != parityBefore)
+                uiGeneration.store(uiGeneration.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+            // Update last-known host state
+            lastHostPPQ = ppqNow;
+            lastHostIsPlaying = isPlayingNow;
+            return block;
+        }
+
+        // Render the ringing click and start the clicks due in this block, each exactly at its sample
+        // (the block's gate plus its delay; zero-latency when there is none). Adds into the channels, which
+        // the caller has cleared. Spans between click starts, each at one constant gain. Call once after
+        // every advance(): the block length also moves the sample clock clicks are scheduled on.
+        void render (float* const* channels, int numChannels, int numSamples, float volume) noexcept
+        {
+            render(channels, numChannels, channels, numChannels, numSamples, volume);
+        }
+
+        // The same, with accented clicks added into accentChannels instead (for separate outputs)
+        void render (float* const* channels, int numChannels, float* const* accentChannels, int numAccentChannels,
+                     int numSamples, float volume) noexcept
+        {
+            for (int i = 0; i < block.numClicks; ++i)
+            {
+                const auto& c = block.clicks[(size_t)i];
+                if (c.sample < numSamples)
+                    pending.push({ sampleClock + c.sample + c.delay, c.level, 0, c.accent });
+            }
+
+            // Nothing to add between clicks (and always when idle)
+            if (! pending.empty() || isClickActive())
+            {
+                for (int start = 0; start < numSamples;)
+                {
+                    // Each click on the next voice, so fast repeats let the previous ones ring out
+                    for (; ! pending.empty() && pending.front().due <= sampleClock + start; pending.pop())
+                    {
+                        voices[(size_t)nextVoice].trigger(pending.front().level, pending.front().accent);
+                        nextVoice = (nextVoice + 1) % kNumVoices;
+                    }
+
+                    const int end = pending.empty() ? numSamples : (int)std::min<int64_t>(numSamples, pending.front().due - sampleClock);
+                    renderSpan(channels, numChannels, accentChannels, numAccentChannels, start, end, volume);
+                    start = end;
+                }
+            }
+            sampleClock += numSamples;
+        }
+
+        // Whether the next render() adds anything (after advance(); false between clicks and when idle)
+        bool willRender() const noexcept { return block.numClicks > 0 || ! pending.empty() || isClickActive(); }
+
+        // Idle: stopped last block and this one, no click tail ringing or waiting, and nothing that places
+        // the stopped playhead moved. advance() then skips the block; a caller can check first and skip
+        // its own per-block work too (no lookahead applies while stopped, so the transport is compared as is).
+        bool isIdle (const HostTransportInfo& host, int stepCount) const noexcept
+        {
+            return ! host.isPlaying && ! lastHostIsPlaying && ! isClickActive() && pending.empty()
+                && host.ppqPosition == lastHostPPQ && host.timeSigNumerator == lastTimeSigNumerator
+                && host.timeSigDenominator == lastTimeSigDenominator && host.barStartPpq == lastBarStartPpq
+                && stepCount == lastStepCount && timing.getSubdivisionsPerBar() == lastSubdivisionsPerBar;
+        }
+
+        const SequencerBlock& getLastBlock() const noexcept { return block; }
+        bool isClickActive() const noexcept
+        {
+            for (const auto& voice : voices)
+                if (voice.isActive())
+                    return true;
+            return false;
+        }
+        bool hasPendingClicks() const noexcept { return ! pending.empty(); }
+
+    private:
+        // One voice at a time, each a plain loop at its own constant gain; idle voices cost one test
+        void renderSpan (float* const* channels, int numChannels, float* const* accentChannels, int numAccentChannels,
+                         int start, int end, float volume) noexcept
+        {
+            for (auto& voice : voices)
+            {
+                float* const* out = voice.isAccent() ? accentChannels : channels;
+                const int numOut = voice.isAccent() ? numAccentChannels : numChannels;
+                const float gain = volume * voice.getLevel();
+                for (int s = start; s < end && voice.isActive(); ++s)
+                {
+                    const float sampleValue = voice.next(gain);
+                    for (int ch = 0; ch < numOut; ++ch)
+                        out[ch][s] += sampleValue;
+                }
+            }
+        }
+
+        // Appends the active ratchet's repeats in [fromSample, toSample) to the block's clicks
+        void addRatchetClicks (const HostTransportInfo& host, int fromSample, int toSample) noexcept
+        {
+            if (ratchet.count <= 1)
+                return;
+            std::array<int, kMaxRatchets> hits;
+            const int n = timing.findRatchetHits(host, ratchet.boundaryPpq, ratchet.count, fromSample, toSample, hits.data(), (int)hits.size());
+            for (int i = 0; i < n && block.numClicks < SequencerBlock::kMaxClicks; ++i)
+                block.clicks[(size_t)block.numClicks++] = { hits[(size_t)i], ratchet.delay, ratchet.level, ratchet.accent, ratchet.step, ratchet.bar };
+        }
+
+    public:
+        // UI timing info for dance mode (updated on every subdivision crossing)
+        int getCurrentStepIndex() const noexcept { return currentStepIndex.load(); }
+        int getDanceParity() const noexcept { return danceParity.load(); }
+
+        // Incremented (audio thread only) whenever the step index or dance parity changes; a reader that
+        // sees the same value twice can skip redrawing them
+        uint32_t getUiGeneration() const noexcept { return uiGeneration.load(std::memory_order_acquire); }
+
+    private:
+        // Audio-thread state, touched every block and by nothing else: kept contiguous
+        TimingEngine timing;
+        SequencerBlock block;
+        double sampleRate = 48000.0;
+
+        // Click voices, used in turn
+        static constexpr int kNumVoices = 4;
+        std::array<ClickVoice, kNumVoices> voices{};
+        int nextVoice = 0;
+
+        // The last gated step's repeats: where its subdivision starts, how many, and how they sound
+        struct ActiveRatchet
+        {
+            double boundaryPpq = 0.0;
+            int count = 0;
+            int delay = 0;
+            float level = 1.0f;
+            bool accent = false;
+            int step = -1;
+            int bar = -1;
+        };
+        ActiveRatchet ratchet;
+
+        // Clicks scheduled for later blocks (delayed by lookahead, swing or offset), on a clock counting
+        // rendered samples. At most kMaxRatchets clicks per subdivision, delayed by at most the lookahead,
+        // the offset and half a subdivision, keep this well under the capacity.
+        ClickQueue<128> pending;
+        int64_t sampleClock = 0;
+        int lastLookaheadSamples = 0;
+
+        // Global subdivision counter to ensure full sequence progression regardless of time signature
+        std::atomic<int> globalSubdivisionCounter { 0 };
+
+        // Track last-known host state to align stepping and avoid repeated triggers
+        double lastHostPPQ { -1.0 };
+        bool lastHostIsPlaying { false };
+
+        // Inputs of the last non-idle block that position a stopped playhead (idle detection)
+        int lastStepCount { -1 };
+        int lastTimeSigNumerator { 0 };
+        int lastTimeSigDenominator { 0 };
+        double lastBarStartPpq { 0.0 };
+        int lastSubdivisionsPerBar { 0 };
+
+        // UI timing info for dance mode (updated on every subdivision crossing). Readable from any thread,
+        // so it starts its own cache line: a reader polling it never shares a line with the state above,
+        // and the class's size rounds up so whatever follows a Sequencer doesn't share this one.
+        alignas(64) std::atomic<int> currentStepIndex { -1 };
+        std::atomic<int> danceParity { 0 }; // flips on every subdivision crossing for smooth dance alternation
+        std::atomic<uint32_t> uiGeneration { 0 };
+    };
+
+    static_assert(alignof(Sequencer) == 64 && sizeof(Sequencer) % 64 == 0,
+                  "Sequencer's cross-thread atomics must own their cache line");
+}
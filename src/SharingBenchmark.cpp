@@ -0,0 +1,154 @@
+// False-sharing benchmark: times the audio path (Sequencer advance + render + UI snapshot publish, as in
+// processBlock) alone and while another thread polls the playhead state as fast as it can, i.e. a
+// worst-case editor. With the cross-thread atomics on their own cache lines, the only lines the poller
+// pulls away from the audio thread are the ones it actually reads (the snapshot and step atomics), never
+// the click or timing state. A packed/padded control pair shows what an unrelated neighbour on the same
+// line would cost on this machine. A measuring tool, not a test: not run by ctest.
+//
+//   MetroGnome_SharingBenchmark [blocks]     (default 2000000)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "Sequencer.h"
+#include "SeqLock.h"
+#include "UiSnapshot.h"
+
+using namespace metrog;
+
+namespace
+{
+    constexpr double kSampleRate = 48000.0;
+    constexpr int kBlockSize = 64;
+
+    double nanosPerIteration (std::chrono::steady_clock::duration elapsed, long iterations)
+    {
+        return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / (double) iterations;
+    }
+
+    // Runs `body` on this thread `iterations` times, optionally with `poll` spinning on a second thread.
+    // Best of three runs, in ns per iteration.
+    template <typename Body, typename Poll>
+    double timeLoop (long iterations, bool withPoller, Body&& body, Poll&& poll)
+    {
+        double best = 1.0e300;
+        for (int run = 0; run < 3; ++run)
+        {
+            std::atomic<bool> running { true };
+            std::thread poller;
+            if (withPoller)
+                poller = std::thread([&] { while (running.load(std::memory_order_relaxed)) poll(); });
+
+            const auto start = std::chrono::steady_clock::now();
+            for (long i = 0; i < iterations; ++i)
+                body();
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+
+            running.store(false);
+            if (poller.joinable())
+                poller.join();
+            best = std::min(best, nanosPerIteration(elapsed, iterations));
+        }
+        return best;
+    }
+
+    struct AudioPath
+    {
+        Sequencer sequencer;
+        SeqLock<UiSnapshot> snapshot;
+        HostTransportInfo host;
+        SequencerParams params;
+        std::vector<float> left = std::vector<float>(kBlockSize), right = std::vector<float>(kBlockSize);
+
+        AudioPath()
+        {
+            sequencer.prepare(kSampleRate, kBlockSize);
+            sequencer.setSubdivisionsPerBar(4);
+            host.sampleRate = kSampleRate;
+            host.tempoBPM = 120.0;
+            host.isPlaying = true;
+            params.stepCount = 8;
+            params.stepMask = StepMask::fromBits(0x55u);
+        }
+
+        void processBlock() noexcept
+        {
+            float* channels[2] = { left.data(), right.data() };
+            std::fill(left.begin(), left.end(), 0.0f);
+            std::fill(right.begin(), right.end(), 0.0f);
+
+            sequencer.advance(host, params, kBlockSize);
+            sequencer.render(channels, 2, kBlockSize, 0.8f);
+
+            UiSnapshot ui;
+            ui.generation = sequencer.getUiGeneration();
+            ui.currentStep = (int16_t) sequencer.getCurrentStepIndex();
+            ui.danceParity = (uint8_t) sequencer.getDanceParity();
+            ui.playing = 1;
+            snapshot.store(ui);
+
+            host.ppqPosition += (host.tempoBPM / 60.0) * (kBlockSize / kSampleRate);
+        }
+
+        // What the editor reads each frame (and the legacy per-field getters)
+        void poll() const noexcept
+        {
+            volatile int sink = 0;
+            sink = sequencer.getCurrentStepIndex() + sequencer.getDanceParity() + (int) sequencer.getUiGeneration();
+            sink = snapshot.load().currentStep;
+            (void) sink;
+        }
+    };
+
+    // Control: an audio-written counter and a flag another thread keeps writing, on one line or on two
+    struct Packed
+    {
+        std::atomic<uint64_t> audioCounter { 0 };
+        std::atomic<uint64_t> uiFlag { 0 };
+    };
+
+    struct Padded
+    {
+        alignas(64) std::atomic<uint64_t> audioCounter { 0 };
+        alignas(64) std::atomic<uint64_t> uiFlag { 0 };
+    };
+
+    template <typename Layout>
+    double timeControl (long iterations, bool withWriter)
+    {
+        static Layout layout;
+        return timeLoop(iterations, withWriter,
+                        [] { layout.audioCounter.store(layout.audioCounter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); },
+                        [] { layout.uiFlag.fetch_add(1, std::memory_order_relaxed); });
+    }
+}
+
+int main (int argc, char** argv)
+{
+    const long blocks = argc > 1 ? std::max(1L, std::atol(argv[1])) : 2000000L;
+
+    if (std::thread::hardware_concurrency() < 2)
+        std::printf("Warning: one hardware thread; the poller time-slices with the audio loop, so these numbers\n"
+                    "measure scheduling, not cache-line traffic.\n");
+
+    static AudioPath path; // static: 64-byte aligned members
+    const double alone = timeLoop(blocks, false, [] { path.processBlock(); }, [] {});
+    const double polled = timeLoop(blocks, true, [] { path.processBlock(); }, [] { path.poll(); });
+
+    std::printf("Audio path (%d-sample blocks, %ld blocks, best of 3)\n", kBlockSize, blocks);
+    std::printf("  alone:              %8.1f ns/block\n", alone);
+    std::printf("  with UI poll thread:%8.1f ns/block (%+.1f%%)\n", polled, (polled / alone - 1.0) * 100.0);
+
+    const long writes = blocks * 8;
+    const double packedAlone = timeControl<Packed>(writes, false), packedShared = timeControl<Packed>(writes, true);
+    const double paddedAlone = timeControl<Padded>(writes, false), paddedShared = timeControl<Padded>(writes, true);
+
+    std::printf("Control: audio-thread store with another thread writing a neighbouring field\n");
+    std::printf("  same cache line:    %8.2f -> %8.2f ns/store\n", packedAlone, packedShared);
+    std::printf("  separate lines:     %8.2f -> %8.2f ns/store\n", paddedAlone, paddedShared);
+    return 0;
+}
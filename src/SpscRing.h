@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace metrog
+{
+    // Wait-free single-producer/single-consumer ring of trivially copyable records.
+    // Storage is inline (no allocation); Capacity must be a power of two. Producer and consumer indices
+    // live on separate cache lines so the audio thread and the reader never share a line on push/pop.
+    template <typename T, size_t Capacity>
+    class SpscRing
+    {
+        static_assert((Capacity & (Capacity - 1)) == 0 && Capacity >= 2, "Capacity must be a power of two");
+        static_assert(std::is_trivially_copyable<T>::value, "SpscRing records must be trivially copyable");
+
+    public:
+        // Producer side. Returns false (and counts a drop) when the ring is full.
+        bool push (const T& item) noexcept
+        {
+            const size_t w = writeIndex.load(std::memory_order_relaxed);
+            if (w - cachedReadIndex >= Capacity)
+            {
+                cachedReadIndex = readIndex.load(std::memory_order_acquire);
+                if (w - cachedReadIndex >= Capacity)
+                {
+                    dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    return false;
+                }
+            }
+            slots[w & (Capacity - 1)] = item;
+            writeIndex.store(w + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side. Returns false when the ring is empty.
+        bool pop (T& out) noexcept
+        {
+            const size_t r = readIndex.load(std::memory_order_relaxed);
+            if (r == cachedWriteIndex)
+            {
+                cachedWriteIndex = writeIndex.load(std::memory_order_acquire);
+                if (r == cachedWriteIndex)
+                    return false;
+            }
+            out = slots[r & (Capacity - 1)];
+            readIndex.store(r + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side: pops up to maxItems into dest; returns how many were copied.
+        size_t popInto (T* dest, size_t maxItems) noexcept
+        {
+            size_t n = 0;
+            while (n < maxItems && pop(dest[n]))
+                ++n;
+            return n;
+        }
+
+        // Approximate fill level (exact when called from either endpoint's own thread while the other is idle)
+        size_t size() const noexcept
+        {
+            return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_acquire);
+        }
+
+        // Records rejected because the consumer fell behind
+        size_t getDroppedCount() const noexcept { return dropped.load(std::memory_order_relaxed); }
+
+        static constexpr size_t capacity() noexcept { return Capacity; }
+
+    private:
+        std::array<T, Capacity> slots{};
+
+        alignas(64) std::atomic<size_t> writeIndex { 0 };
+        size_t cachedReadIndex = 0;                // producer's last view of readIndex
+        std::atomic<size_t> dropped { 0 };
+
+        alignas(64) std::atomic<size_t> readIndex { 0 };
+        size_t cachedWriteIndex = 0;               // consumer's last view of writeIndex
+    };
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace metrog
+{
+    // Enabled/disabled state of up to kMaxSteps sequencer steps, one bit per step.
+    struct StepMask
+    {
+        static constexpr int kMaxSteps = 128;
+        static constexpr int kWords = kMaxSteps / 64;
+
+        std::array<uint64_t, kWords> words{};
+
+        // Steps 0..63 from a plain integer (bit i = step i)
+        static StepMask fromBits (uint64_t lowBits) noexcept
+        {
+            StepMask m;
+            m.words[0] = lowBits;
+            return m;
+        }
+
+        static StepMask allEnabled() noexcept
+        {
+            StepMask m;
+            for (auto& w : m.words)
+                w = ~uint64_t(0);
+            return m;
+        }
+
+        bool test (int step) const noexcept
+        {
+            return step >= 0 && step < kMaxSteps && ((words[(size_t)(step >> 6)] >> (step & 63)) & 1u) != 0;
+        }
+
+        void set (int step, bool enabled) noexcept
+        {
+            if (step < 0 || step >= kMaxSteps)
+                return;
+            const uint64_t bit = uint64_t(1) << (step & 63);
+            auto& w = words[(size_t)(step >> 6)];
+            w = enabled ? (w | bit) : (w & ~bit);
+        }
+
+        StepMask operator^ (const StepMask& other) const noexcept
+        {
+            StepMask m;
+            for (size_t i = 0; i < words.size(); ++i)
+                m.words[i] = words[i] ^ other.words[i];
+            return m;
+        }
+
+        bool any() const noexcept
+        {
+            for (auto w : words)
+                if (w != 0)
+                    return true;
+            return false;
+        }
+
+        bool operator== (const StepMask& other) const noexcept { return words == other.words; }
+        bool operator!= (const StepMask& other) const noexcept { return words != other.words; }
+    };
+
+    // StepMask shared between threads. Each step's bit is updated atomically on its own, so concurrent
+    // writers of different steps never lose each other's changes; a load may mix two updates to
+    // different words, which is harmless because steps are independent.
+    class AtomicStepMask
+    {
+    public:
+        StepMask load() const noexcept
+        {
+            StepMask m;
+            for (size_t i = 0; i < words.size(); ++i)
+                m.words[i] = words[i].load(std::memory_order_relaxed);
+            return m;
+        }
+
+        void store (const StepMask& m) noexcept
+        {
+            for (size_t i = 0; i < words.size(); ++i)
+                words[i].store(m.words[i], std::memory_order_relaxed);
+        }
+
+        void set (int step, bool enabled) noexcept
+        {
+            if (step < 0 || step >= StepMask::kMaxSteps)
+                return;
+            const uint64_t bit = uint64_t(1) << (step & 63);
+            auto& w = words[(size_t)(step >> 6)];
+            if (enabled)
+                w.fetch_or(bit, std::memory_order_relaxed);
+            else
+                w.fetch_and(~bit, std::memory_order_relaxed);
+        }
+
+    private:
+        std::array<std::atomic<uint64_t>, StepMask::kWords> words{};
+    };
+
+    // Click velocity per step (0..127, MIDI-style), one byte each; 127 plays at the full volume.
+    using StepVelocityArray = std::array<uint8_t, StepMask::kMaxSteps>;
+
+    inline StepVelocityArray fullVelocities() noexcept
+    {
+        StepVelocityArray v;
+        v.fill(127);
+        return v;
+    }
+
+    // Velocity of a click as a gain: squared, so equal velocity steps sound roughly evenly spaced in
+    // loudness, and exactly 1 at 127
+    inline float velocityToGain (uint8_t velocity) noexcept
+    {
+        const float x = (float)(velocity > 127 ? 127 : velocity) / 127.0f;
+        return x * x;
+    }
+
+    // Ratchet count per step: the step plays 1..kMaxRatchets evenly spaced clicks across its subdivision
+    static constexpr int kMaxRatchets = 8;
+    using StepRatchetArray = std::array<uint8_t, StepMask::kMaxSteps>;
+
+    inline StepRatchetArray singleRatchets() noexcept
+    {
+        StepRatchetArray r;
+        r.fill(1);
+        return r;
+    }
+
+    // One byte per step shared between threads (velocities, ratchet counts), clamped to Min..Max: each
+    // step's byte is loaded and stored on its own. The audio thread reads one byte per click.
+    template <uint8_t Min, uint8_t Max, uint8_t Default>
+    class AtomicStepBytes
+    {
+    public:
+        using Array = std::array<uint8_t, StepMask::kMaxSteps>;
+
+        AtomicStepBytes() noexcept
+        {
+            for (auto& v : values)
+                v.store(Default, std::memory_order_relaxed);
+        }
+
+        uint8_t get (int step) const noexcept
+        {
+            return (step >= 0 && step < StepMask::kMaxSteps) ? values[(size_t)step].load(std::memory_order_relaxed) : Default;
+        }
+
+        void set (int step, uint8_t value) noexcept
+        {
+            if (step >= 0 && step < StepMask::kMaxSteps)
+                values[(size_t)step].store(clamp(value), std::memory_order_relaxed);
+        }
+
+        Array load() const noexcept
+        {
+            Array a;
+            for (size_t i = 0; i < a.size(); ++i)
+                a[i] = values[i].load(std::memory_order_relaxed);
+            return a;
+        }
+
+        void store (const Array& a) noexcept
+        {
+            for (size_t i = 0; i < a.size(); ++i)
+                values[i].store(clamp(a[i]), std::memory_order_relaxed);
+        }
+
+    private:
+        static uint8_t clamp (uint8_t v) noexcept { return v < Min ? Min : (v > Max ? Max : v); }
+
+        std::array<std::atomic<uint8_t>, StepMask::kMaxSteps> values;
+    };
+
+    using AtomicStepVelocities = AtomicStepBytes<0, 127, 127>;
+    using AtomicStepRatchets = AtomicStepBytes<1, (uint8_t)kMaxRatchets, 1>;
+}
@@ -0,0 +1,266 @@
+// Concurrency stress harness: runs a simulated audio callback thread, a MIDI CC flood generator and a UI
+// polling thread against the message thread's MIDI-learn / state operations, checking MIDI-map invariants
+// as it goes. Build with -DMETROG_ENABLE_TSAN=ON to have ThreadSanitizer report any data race.
+//
+//   MetroGnome_StressTests [--seconds N]     (or METROG_STRESS_SECONDS=N; default 5)
+#include <JuceHeader.h>
+#include <atomic>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <thread>
+#include <vector>
+#include "PluginProcessor.h"
+#include "OfflineTransport.h"
+#include "SpscRing.h"
+
+namespace
+{
+    struct CCEvent
+    {
+        uint8_t controller = 0;
+        uint8_t value = 0;
+    };
+
+    // Parameters the message thread maps and unmaps (subset of the layout, including all kinds)
+    const char* const kLearnTargets[] = { "volume", "stepCount", "timeSigNum", "danceMode",
+                                          "stepEnabled_1", "stepEnabled_2", "stepEnabled_8", "stepEnabled_16",
+                                          "stepEnabled_65", "stepEnabled_128" };
+
+    double durationSeconds (int argc, char** argv)
+    {
+        for (int i = 1; i + 1 < argc; ++i)
+            if (juce::String(argv[i]) == "--seconds")
+                return juce::String(argv[i + 1]).getDoubleValue();
+
+        const auto env = juce::SystemStats::getEnvironmentVariable("METROG_STRESS_SECONDS", {});
+        return env.isNotEmpty() ? env.getDoubleValue() : 5.0;
+    }
+
+    // "No CC maps to a stale parameter": the fast CC map and the MidiMap state must agree both ways.
+    int checkMidiMapInvariants (const MetroGnomeAudioProcessor& proc)
+    {
+        int failures = 0;
+        for (int cc = 0; cc < 128; ++cc)
+        {
+            const auto id = proc.getParameterIDForCC(cc);
+            if (id.isNotEmpty() && proc.getMappedCC(id) != cc)
+            {
+                std::cerr << "CC " << cc << " drives " << id << ", but state maps it to CC " << proc.getMappedCC(id) << "\n";
+                ++failures;
+            }
+        }
+        for (const auto* id : kLearnTargets)
+        {
+            const int cc = proc.getMappedCC(id);
+            if (cc >= 0 && proc.getParameterIDForCC(cc) != juce::String(id))
+            {
+                std::cerr << "State maps " << id << " to CC " << cc << ", but that CC drives '" << proc.getParameterIDForCC(cc) << "'\n";
+                ++failures;
+            }
+        }
+        return failures;
+    }
+}
+
+static int runTests (double seconds)
+{
+    const juce::ScopedJuceInitialiser_GUI juceInit; // this thread is the message thread
+
+    constexpr double sampleRate = 48000.0;
+    constexpr int maxBlockSize = 512;
+
+    MetroGnomeAudioProcessor proc;
+    metrog::OfflineTransport transport;
+    transport.setSampleRate(sampleRate);
+    transport.setPlaying(true);
+    proc.setPlayHead(&transport);
+    proc.setRateAndBufferSizeDetails(sampleRate, maxBlockSize);
+    proc.prepareToPlay(sampleRate, maxBlockSize);
+
+    static metrog::SpscRing<CCEvent, 4096> midiQueue; // flood thread -> audio thread
+    std::atomic<bool> running { true };
+    std::atomic<uint64_t> blocks { 0 }, ccSent { 0 }, uiPolls { 0 };
+    std::atomic<int> uiFailures { 0 };
+
+    // Audio thread: variable block sizes, play/stop and loop jumps, CCs drained from the flood queue
+    std::thread audio ([&]
+    {
+        juce::AudioBuffer<float> buffer (2, maxBlockSize);
+        juce::MidiBuffer midi;
+        midi.ensureSize(4096);
+        std::mt19937 rng (1);
+
+        while (running.load(std::memory_order_relaxed))
+        {
+            const int n = 1 + (int) (rng() % maxBlockSize);
+            buffer.setSize(2, n, false, false, true);
+
+            midi.clear();
+            CCEvent e;
+            for (int i = 0; i < 64 && midiQueue.pop(e); ++i)
+                midi.addEvent(juce::MidiMessage::controllerEvent(1, e.controller, e.value), i % n);
+
+            switch (rng() % 512)
+            {
+                case 0: transport.setPlaying(! transport.isPlaying()); break;
+                case 1: transport.setPpqPosition(4.0 * (double) (rng() % 8)); break;
+                case 2: transport.setTempo(60.0 + (double) (rng() % 180)); break;
+                default: break;
+            }
+
+            proc.processBlock(buffer, midi);
+            transport.advance(n);
+            blocks.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    // MIDI flood: dense CC traffic, concentrated on a few controllers so learned mappings are hit constantly
+    std::thread flood ([&]
+    {
+        std::mt19937 rng (2);
+        while (running.load(std::memory_order_relaxed))
+        {
+            CCEvent e;
+            e.controller = (uint8_t) ((rng() % 4) == 0 ? rng() % 128 : rng() % 8);
+            e.value = (uint8_t) (rng() % 128);
+            if (midiQueue.push(e))
+                ccSent.fetch_add(1, std::memory_order_relaxed);
+            else
+                std::this_thread::yield();
+        }
+    });
+
+    // UI poll: what the editor timer reads, at a much higher rate than 60 Hz
+    std::thread ui ([&]
+    {
+        metrog::DspLoadSample samples[256];
+        metrog::GateEvent gates[64];
+        while (running.load(std::memory_order_relaxed))
+        {
+            const auto snap = proc.getUiSnapshot();
+            const int step = snap.currentStep;
+            const int parity = snap.danceParity;
+            if (step < -1 || step >= metrog::StepMask::kMaxSteps || (parity != 0 && parity != 1) || snap.stepCount < 1 || snap.stepCount > metrog::StepMask::kMaxSteps)
+            {
+                std::cerr << "UI read out-of-range step " << step << " / parity " << parity << " / count " << snap.stepCount << "\n";
+                uiFailures.fetch_add(1);
+            }
+            const double progress = metrog::subdivisionProgress(snap, metrog::extrapolatePpq(snap, metrog::monotonicNanos()));
+            if (! (progress >= 0.0 && progress <= 1.0))
+            {
+                std::cerr << "UI playhead progress out of range: " << progress << "\n";
+                uiFailures.fetch_add(1);
+            }
+            proc.popDspLoadSamples(samples, 256);
+            for (size_t i = 0, n = proc.popGateEvents(gates, 64); i < n; ++i)
+            {
+                if (gates[i].stepIndex < 0 || gates[i].stepIndex >= metrog::StepMask::kMaxSteps || gates[i].audibleNs == 0
+                    || gates[i].lane < metrog::GateEvent::kMainLane || gates[i].lane >= metrog::LaneConfig::kMaxExtraLanes)
+                {
+                    std::cerr << "UI read malformed gate event: step " << gates[i].stepIndex << "\n";
+                    uiFailures.fetch_add(1);
+                }
+            }
+            uiPolls.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    // Message thread: MIDI learn, unmapping, state recall and host notification, checking invariants throughout
+    int failures = 0;
+    uint64_t commits = 0, clears = 0, stateLoads = 0, iterations = 0;
+    std::mt19937 rng (3);
+    juce::MemoryBlock savedState;
+    proc.getStateInformation(savedState);
+
+    const auto deadline = juce::Time::getMillisecondCounterHiRes() + seconds * 1000.0;
+    while (juce::Time::getMillisecondCounterHiRes() < deadline)
+    {
+        ++iterations;
+        const char* target = kLearnTargets[rng() % std::size(kLearnTargets)];
+
+        switch (rng() % 8)
+        {
+            case 0: case 1: case 2:
+            {
+                proc.armMidiLearn(target);
+                for (int spin = 0; spin < 1000 && ! proc.hasPendingMidiLearn(); ++spin)
+                    std::this_thread::yield();
+                if (proc.commitPendingMidiLearn())
+                    ++commits;
+                else
+                    proc.cancelMidiLearn();
+                break;
+            }
+            case 3:
+                proc.clearMidiMapping(target);
+                ++clears;
+                break;
+            case 4:
+                if (rng() % 2 == 0)
+                    proc.getStateInformation(savedState);
+                else
+                {
+                    proc.setStateInformation(savedState.getData(), (int) savedState.getSize());
+                    ++stateLoads;
+                }
+                break;
+            case 5:
+                if (auto* p = proc.getAPVTS().getParameter("stepCount"))
+                    p->setValueNotifyingHost((float) (rng() % 1000) / 999.0f);
+                proc.setVisualLatencyMs((float) (rng() % 200));
+                proc.setStepVelocity((int) (rng() % metrog::StepMask::kMaxSteps), (int) (rng() % 160) - 16);
+                proc.setStepAccent((int) (rng() % metrog::StepMask::kMaxSteps), rng() % 2 == 0);
+                proc.setStepRatchet((int) (rng() % metrog::StepMask::kMaxSteps), 1 + (int) (rng() % metrog::kMaxRatchets));
+                if (rng() % 4 == 0)
+                    proc.storePattern((int) (rng() % metrog::PatternBank::kNumPatterns));
+                proc.selectPattern((int) (rng() % metrog::PatternBank::kNumPatterns), rng() % 2 == 0);
+                {
+                    metrog::LaneConfig lanes;
+                    lanes.numLanes = (int) (rng() % (metrog::LaneConfig::kMaxExtraLanes + 1));
+                    for (auto& lane : lanes.lanes)
+                        lane.subdivisionsPerBar = lane.stepCount = 1 + (int) (rng() % 16);
+                    proc.setLaneConfig(lanes);
+                }
+                break;
+            default:
+                proc.dispatchPendingControllerChanges();
+                break;
+        }
+
+        failures += checkMidiMapInvariants(proc);
+        if (failures > 20)
+            break;
+    }
+
+    running.store(false);
+    audio.join();
+    flood.join();
+    ui.join();
+    proc.releaseResources();
+
+    failures += uiFailures.load();
+    failures += checkMidiMapInvariants(proc);
+
+    std::cout << "Ran " << seconds << " s: " << blocks.load() << " blocks, " << ccSent.load() << " CCs, "
+              << uiPolls.load() << " UI polls, " << iterations << " message-thread operations ("
+              << commits << " learns, " << clears << " clears, " << stateLoads << " state loads)" << std::endl;
+
+    if (blocks.load() == 0 || commits == 0)
+    {
+        std::cerr << "Stress run made no progress\n";
+        ++failures;
+    }
+
+    if (failures == 0)
+        std::cout << "All stress tests passed." << std::endl;
+    else
+        std::cout << failures << " stress invariant violation(s)." << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
+
+int main (int argc, char** argv)
+{
+    return runTests(durationSeconds(argc, argv));
+}
@@ -0,0 +1,387 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace metrog
+{
+    // Tempo and time signature over a song, for offline renders and tests (hosts report tempo per block;
+    // this is what a scripted transport reports instead). Tempo points and meter points are kept in two
+    // sorted arrays with their absolute time and bar precomputed, so any lookup is one binary search.
+    // Positions are in quarter notes (ppq), as hosts report them. Not for the audio thread to modify.
+    class TempoMap
+    {
+    public:
+        struct TempoPoint
+        {
+            double ppq = 0.0;
+            double seconds = 0.0;              // time at ppq
+            double secondsPerQuarter = 0.5;    // from ppq to the next point
+        };
+
+        struct MeterPoint
+        {
+            double ppq = 0.0;
+            double bar = 0.0;                  // bars before ppq (fractional if the change falls mid-bar)
+            int numerator = 4;
+            int denominator = 4;
+
+            double quartersPerBar() const noexcept { return (double)numerator * 4.0 / (double)denominator; }
+        };
+
+        explicit TempoMap (double bpm = 120.0, int numerator = 4, int denominator = 4)
+        {
+            tempos.push_back({ 0.0, 0.0, 60.0 / clampBpm(bpm) });
+            meters.push_back({ 0.0, 0.0, std::max(1, numerator), std::max(1, denominator) });
+        }
+
+        // Changes from ppq on (replacing one at the same position); later points keep their ppq
+        void setTempo (double ppq, double bpm)
+        {
+            ppq = std::max(0.0, ppq);
+            const auto it = std::lower_bound(tempos.begin(), tempos.end(), ppq, [] (const TempoPoint& p, double x) { return p.ppq < x; });
+            const auto index = (size_t)(it - tempos.begin());
+            if (it != tempos.end() && it->ppq == ppq)
+                it->secondsPerQuarter = 60.0 / clampBpm(bpm);
+            else
+                tempos.insert(it, { ppq, 0.0, 60.0 / clampBpm(bpm) });
+            for (size_t i = std::max<size_t>(index, 1); i < tempos.size(); ++i)
+                tempos[i].seconds = tempos[i - 1].seconds + (tempos[i].ppq - tempos[i - 1].ppq) * tempos[i - 1].secondsPerQuarter;
+        }
+
+        void setMeter (double ppq, int numerator, int denominator)
+        {
+            ppq = std::max(0.0, ppq);
+            const auto it = std::lower_bound(meters.begin(), meters.end(), ppq, [] (const MeterPoint& p, double x) { return p.ppq < x; });
+            const auto index = (size_t)(it - meters.begin());
+            if (it != meters.end() && it->ppq == ppq)
+            {
+                it->numerator = std::max(1, numerator);
+                it->denominator = std::max(1, denominator);
+            }
+            else
+                meters.insert(it, { ppq, 0.0, std::max(1, numerator), std::max(1, denominator) });
+            for (size_t i = std::max<size_t>(index, 1); i < meters.size(); ++i)
+                meters[i].bar = meters[i - 1].bar + (meters[i].ppq - meters[i - 1].ppq) / meters[i - 1].quartersPerBar();
+        }
+
+        double secondsAtPpq (double ppq) const noexcept
+        {
+            const auto& p = tempoAt(ppq);
+            return p.seconds + (ppq - p.ppq) * p.secondsPerQuarter;
+        }
+
+        double ppqAtSeconds (double seconds) const noexcept
+        {
+            auto it = std::upper_bound(tempos.begin(), tempos.end(), seconds, [] (double x, const TempoPoint& p) { return x < p.seconds; });
+            const auto& p = it == tempos.begin() ? tempos.front() : *(it - 1);
+            return p.ppq + (seconds - p.seconds) / p.secondsPerQuarter;
+        }
+
+        double bpmAtPpq (double ppq) const noexcept { return 60.0 / tempoAt(ppq).secondsPerQuarter; }
+
+        const MeterPoint& meterAtPpq (double ppq) const noexcept
+        {
+            auto it = std::upper_bound(meters.begin(), meters.end(), ppq, [] (double x, const MeterPoint& p) { return x < p.ppq; });
+            return it == meters.begin() ? meters.front() : *(it - 1);
+        }
+
+        // Position of a (fractional) bar count from the start
+        double ppqAtBar (double bar) const noexcept
+        {
+            auto it = std::upper_bound(meters.begin(), meters.end(), bar, [] (double x, const MeterPoint& p) { return x < p.bar; });
+            const auto& m = it == meters.begin() ? meters.front() : *(it - 1);
+            return m.ppq + (bar - m.bar) * m.quartersPerBar();
+        }
+
+        // The last bar line at or before ppq (what a host reports as the last bar start), and the whole
+        // bars before it. Rounding can put the bar line a hair past ppq; it is then taken as ppq.
+        double lastBarStartAtPpq (double ppq, int64_t& outBarCount) const noexcept
+        {
+            ppq = std::max(0.0, ppq);
+            const auto& m = meterAtPpq(ppq);
+            const double bars = std::floor(m.bar + (ppq - m.ppq) / m.quartersPerBar());
+            outBarCount = (int64_t)bars;
+            return std::min(ppqAtBar(bars), ppq);
+        }
+
+        // Time of the first tempo change after the given time (infinity if none)
+        double nextTempoChangeSeconds (double seconds) const noexcept
+        {
+            auto it = std::upper_bound(tempos.begin(), tempos.end(), seconds, [] (double x, const TempoPoint& p) { return x < p.seconds; });
+            return it == tempos.end() ? std::numeric_limits<double>::infinity() : it->seconds;
+        }
+
+        // Length of a render block starting at the given time: maxSamples, or less to split it around the
+        // next tempo change. A block's subdivision crossings are worked out at one tempo and count only
+        // when they land on one of its samples, so the block runs just past the first sample at or after
+        // the change (a beat on the change, where they usually are, falls inside it; at most two samples
+        // go by at the old tempo) and the next starts at the new tempo. When that doesn't fit, the block
+        // ends before the change and the next one takes it.
+        int blockSamplesAt (double seconds, double sampleRate, int maxSamples) const noexcept
+        {
+            const double untilChange = (nextTempoChangeSeconds(seconds + 1.0e-9) - seconds) * sampleRate;
+            if (! (untilChange < (double)maxSamples))
+                return maxSamples;
+            const int before = (int)std::floor(untilChange);
+            return before + 2 <= maxSamples ? before + 2 : (before > 1 ? before : 1);
+        }
+
+        const std::vector<TempoPoint>& getTempoPoints() const noexcept { return tempos; }
+        const std::vector<MeterPoint>& getMeterPoints() const noexcept { return meters; }
+
+    private:
+        static double clampBpm (double bpm) noexcept { return bpm > 1.0 ? (bpm < 1000.0 ? bpm : 1000.0) : 1.0; }
+
+        const TempoPoint& tempoAt (double ppq) const noexcept
+        {
+            auto it = std::upper_bound(tempos.begin(), tempos.end(), ppq, [] (double x, const TempoPoint& p) { return x < p.ppq; });
+            return it == tempos.begin() ? tempos.front() : *(it - 1);
+        }
+
+        std::vector<TempoPoint> tempos; // never empty; the first is at ppq 0
+        std::vector<MeterPoint> meters; // likewise
+    };
+
+    // Reads the tempo map of a Standard MIDI File (format 0, 1 or 2) from a stream, keeping only its set-tempo
+    // (FF 51) and time signature (FF 58) meta events. The file is read in one pass through a small
+    // buffer: other events are skipped without being stored, so memory depends on the number of tempo and
+    // meter changes, not on the file's size. In a format 2 file (independent patterns) only the first track
+    // counts. Without tempo events the map is 120 BPM 4/4, as the SMF spec says. Returns false with a
+    // description on malformed or truncated input, and for SMPTE time division (no quarter-note position).
+    class SmfTempoMapReader
+    {
+    public:
+        static bool read (std::istream& in, TempoMap& out, std::string& error)
+        {
+            SmfTempoMapReader reader (in);
+            if (! reader.readAll())
+            {
+                error = reader.error;
+                return false;
+            }
+            out = reader.buildMap();
+            return true;
+        }
+
+    private:
+        struct MetaEvent
+        {
+            uint64_t tick = 0;
+            bool isTempo = true;
+            uint32_t value = 0;     // microseconds per quarter, or numerator << 8 | denominator power
+        };
+
+        explicit SmfTempoMapReader (std::istream& s) : in (s) {}
+
+        bool fail (const char* message) { error = message; return false; }
+
+        bool readBytes (uint8_t* dest, size_t n)
+        {
+            in.read(reinterpret_cast<char*>(dest), (std::streamsize)n);
+            return (size_t)in.gcount() == n;
+        }
+
+        bool readBigEndian (uint32_t& value, int numBytes)
+        {
+            uint8_t bytes[4] {};
+            if (! readBytes(bytes, (size_t)numBytes))
+                return false;
+            value = 0;
+            for (int i = 0; i < numBytes; ++i)
+                value = (value << 8) | bytes[i];
+            return true;
+        }
+
+        bool skip (uint64_t n)
+        {
+            // ignore() on a large count is fine; gcount tells whether the stream had that many bytes
+            while (n > 0)
+            {
+                const auto chunk = (std::streamsize)std::min<uint64_t>(n, 1u << 30);
+                in.ignore(chunk);
+                if (in.gcount() != chunk)
+                    return false;
+                n -= (uint64_t)chunk;
+            }
+            return true;
+        }
+
+        // Track reading: every byte is counted against the chunk length
+        bool trackByte (uint8_t& b)
+        {
+            if (trackRemaining == 0 || ! readBytes(&b, 1))
+                return false;
+            --trackRemaining;
+            return true;
+        }
+
+        bool trackSkip (uint32_t n)
+        {
+            if (n > trackRemaining || ! skip(n))
+                return false;
+            trackRemaining -= n;
+            return true;
+        }
+
+        bool trackVarLen (uint32_t& value)
+        {
+            value = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                uint8_t b = 0;
+                if (! trackByte(b))
+                    return false;
+                value = (value << 7) | (b & 0x7fu);
+                if ((b & 0x80u) == 0)
+                    return true;
+            }
+            return false; // longer than the 4 bytes the spec allows
+        }
+
+        bool readAll()
+        {
+            uint8_t id[4] {};
+            uint32_t headerLength = 0, format = 0, numTracks = 0, division = 0;
+            if (! readBytes(id, 4) || std::string(id, id + 4) != "MThd")
+                return fail("not a Standard MIDI File (no MThd header)");
+            if (! readBigEndian(headerLength, 4) || headerLength < 6
+                || ! readBigEndian(format, 2) || ! readBigEndian(numTracks, 2) || ! readBigEndian(division, 2)
+                || ! skip(headerLength - 6))
+                return fail("truncated MThd header");
+            if (format > 2)
+                return fail("unknown SMF format");
+            if ((division & 0x8000u) != 0)
+                return fail("SMPTE time division is not supported (no quarter-note positions)");
+            if (division == 0)
+                return fail("zero ticks per quarter note");
+            ticksPerQuarter = division;
+
+            const uint32_t tracksToRead = format == 2 ? std::min<uint32_t>(numTracks, 1) : numTracks;
+            for (uint32_t track = 0; track < tracksToRead;)
+            {
+                uint32_t length = 0;
+                if (! readBytes(id, 4) || ! readBigEndian(length, 4))
+                    return fail("truncated file: missing track chunks");
+                if (std::string(id, id + 4) != "MTrk")
+                {
+                    if (! skip(length)) // unknown chunk types are skipped, as the spec asks
+                        return fail("truncated chunk");
+                    continue;
+                }
+                trackRemaining = length;
+                if (! readTrack())
+                    return false;
+                ++track;
+            }
+            return true;
+        }
+
+        bool readTrack()
+        {
+            uint64_t tick = 0;
+            uint8_t runningStatus = 0;
+            while (trackRemaining > 0)
+            {
+                uint32_t delta = 0;
+                uint8_t status = 0;
+                if (! trackVarLen(delta) || ! trackByte(status))
+                    return fail("truncated or malformed track event");
+                tick += delta;
+
+                if (status == 0xff)
+                {
+                    uint8_t type = 0;
+                    uint32_t length = 0;
+                    if (! trackByte(type) || ! trackVarLen(length))
+                        return fail("truncated meta event");
+                    runningStatus = 0;
+                    if (type == 0x2f)
+                        return trackSkip(trackRemaining) || fail("truncated track");  // end of track
+                    if ((type == 0x51 && length == 3) || (type == 0x58 && length >= 2))
+                    {
+                        uint8_t data[3] {};
+                        for (uint32_t i = 0; i < std::min<uint32_t>(length, 3); ++i)
+                            if (! trackByte(data[i]))
+                                return fail("truncated meta event");
+                        if (length > 3 && ! trackSkip(length - 3))
+                            return fail("truncated meta event");
+                        MetaEvent e;
+                        e.tick = tick;
+                        e.isTempo = type == 0x51;
+                        e.value = e.isTempo ? ((uint32_t)data[0] << 16 | (uint32_t)data[1] << 8 | data[2])
+                                            : ((uint32_t)data[0] << 8 | data[1]);
+                        events.push_back(e);
+                    }
+                    else if (! trackSkip(length))
+                        return fail("truncated meta event");
+                }
+                else if (status == 0xf0 || status == 0xf7)
+                {
+                    uint32_t length = 0;
+                    if (! trackVarLen(length) || ! trackSkip(length))
+                        return fail("truncated sysex event");
+                    runningStatus = 0;
+                }
+                else if (status >= 0x80)
+                {
+                    if (status >= 0xf0)
+                        return fail("system message inside a track");
+                    runningStatus = status;
+                    if (! trackSkip(channelDataBytes(status)))
+                        return fail("truncated channel event");
+                }
+                else
+                {
+                    // Running status: this byte was the first data byte
+                    if (runningStatus == 0)
+                        return fail("data byte without a status (running status not set)");
+                    if (! trackSkip(channelDataBytes(runningStatus) - 1))
+                        return fail("truncated channel event");
+                }
+            }
+            return true;
+        }
+
+        static uint32_t channelDataBytes (uint8_t status) noexcept
+        {
+            const uint8_t kind = status & 0xf0;
+            return (kind == 0xc0 || kind == 0xd0) ? 1 : 2;
+        }
+
+        TempoMap buildMap()
+        {
+            // Stable: at equal ticks the event later in the file wins, as it would when played
+            std::stable_sort(events.begin(), events.end(), [] (const MetaEvent& a, const MetaEvent& b) { return a.tick < b.tick; });
+            TempoMap map;
+            for (const auto& e : events)
+            {
+                const double ppq = (double)e.tick / (double)ticksPerQuarter;
+                if (e.isTempo)
+                {
+                    if (e.value > 0)
+                        map.setTempo(ppq, 60.0e6 / (double)e.value);
+                }
+                else
+                {
+                    const int powerOfTwo = (int)(e.value & 0xff);
+                    const int numerator = (int)(e.value >> 8);
+                    if (numerator > 0 && powerOfTwo < 8)
+                        map.setMeter(ppq, numerator, 1 << powerOfTwo);
+                }
+            }
+            return map;
+        }
+
+        std::istream& in;
+        std::string error;
+        uint32_t ticksPerQuarter = 96;
+        uint32_t trackRemaining = 0;
+        std::vector<MetaEvent> events;
+    };
+}
@@ -0,0 +1,448 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "TempoMap.h"
+#include "Sequencer.h"
+
+using namespace metrog;
+
+namespace
+{
+    // Builds Standard MIDI Files in memory
+    struct SmfWriter
+    {
+        std::string bytes;
+
+        void byte (int b) { bytes.push_back((char)(uint8_t)b); }
+        void bigEndian (uint32_t v, int n) { for (int i = n - 1; i >= 0; --i) byte((int)((v >> (8 * i)) & 0xff)); }
+        void varLen (uint32_t v)
+        {
+            uint8_t out[5];
+            int n = 0;
+            out[n++] = (uint8_t)(v & 0x7f);
+            while ((v >>= 7) != 0)
+                out[n++] = (uint8_t)(0x80 | (v & 0x7f));
+            while (n > 0)
+                byte(out[--n]);
+        }
+
+        void header (int format, int numTracks, int division)
+        {
+            bytes += "MThd";
+            bigEndian(6, 4);
+            bigEndian((uint32_t)format, 2);
+            bigEndian((uint32_t)numTracks, 2);
+            bigEndian((uint32_t)division, 2);
+        }
+
+        void chunk (const char* id, const std::string& body)
+        {
+            bytes += id;
+            bigEndian((uint32_t)body.size(), 4);
+            bytes += body;
+        }
+    };
+
+    // One track's events (delta times in ticks)
+    struct TrackWriter
+    {
+        SmfWriter w;
+
+        void tempo (uint32_t delta, double bpm)
+        {
+            const auto micros = (uint32_t)std::lround(60.0e6 / bpm);
+            w.varLen(delta); w.byte(0xff); w.byte(0x51); w.varLen(3); w.bigEndian(micros, 3);
+        }
+        void timeSig (uint32_t delta, int numerator, int powerOfTwo)
+        {
+            w.varLen(delta); w.byte(0xff); w.byte(0x58); w.varLen(4); w.byte(numerator); w.byte(powerOfTwo); w.byte(24); w.byte(8);
+        }
+        void text (uint32_t delta, const std::string& s)
+        {
+            w.varLen(delta); w.byte(0xff); w.byte(0x01); w.varLen((uint32_t)s.size()); w.bytes += s;
+        }
+        void sysex (uint32_t delta, int length)
+        {
+            w.varLen(delta); w.byte(0xf0); w.varLen((uint32_t)length);
+            for (int i = 0; i < length - 1; ++i) w.byte(0x10);
+            w.byte(0xf7);
+        }
+        void noteOn (uint32_t delta, int note, bool runningStatus)
+        {
+            w.varLen(delta);
+            if (! runningStatus) w.byte(0x90);
+            w.byte(note); w.byte(100);
+        }
+        void programChange (uint32_t delta, int program) { w.varLen(delta); w.byte(0xc0); w.byte(program); }
+        void endOfTrack (uint32_t delta) { w.varLen(delta); w.byte(0xff); w.byte(0x2f); w.byte(0); }
+    };
+
+    bool parse (const std::string& file, TempoMap& map, std::string& error)
+    {
+        std::istringstream in (file);
+        return SmfTempoMapReader::read(in, map, error);
+    }
+
+    bool near (double a, double b, double eps = 1e-9) { return std::abs(a - b) <= eps; }
+
+    // Format 1, 480 ticks per quarter: tempo and meter in track 0, notes (with running status), sysex and
+    // a late tempo change in track 1, an unknown chunk in between
+    std::string songFile()
+    {
+        TrackWriter conductor;
+        conductor.text(0, "Song");
+        conductor.tempo(0, 100.0);
+        conductor.timeSig(0, 3, 2);                  // 3/4
+        conductor.tempo(480 * 6, 150.0);             // two 3/4 bars in
+        conductor.timeSig(0, 7, 3);                  // 7/8 from the same point
+        conductor.endOfTrack(480 * 8);
+
+        TrackWriter notes;
+        notes.programChange(0, 5);
+        notes.noteOn(0, 60, false);
+        for (int i = 0; i < 50; ++i)
+            notes.noteOn(48, 60 + i % 12, true);
+        notes.sysex(10, 6);
+        notes.noteOn(0, 64, false);
+        notes.tempo(480 * 12 - 48 * 50 - 10, 75.0);  // at ppq 12
+        notes.endOfTrack(0);
+
+        SmfWriter file;
+        file.header(1, 2, 480);
+        file.chunk("MTrk", conductor.w.bytes);
+        file.chunk("XFIH", "vendor data");
+        file.chunk("MTrk", notes.w.bytes);
+        return file.bytes;
+    }
+
+    int checkParse()
+    {
+        int failures = 0;
+        TempoMap map;
+        std::string error;
+        if (! parse(songFile(), map, error)) { std::cerr << "song: parse failed: " << error << "\n"; return 1; }
+
+        const auto& tempos = map.getTempoPoints();
+        if (tempos.size() != 3 || ! near(tempos[0].ppq, 0.0) || ! near(tempos[1].ppq, 6.0) || ! near(tempos[2].ppq, 12.0))
+            { std::cerr << "song: " << tempos.size() << " tempo points, expected 3 at ppq 0, 6, 12\n"; ++failures; }
+        if (! near(map.bpmAtPpq(1.0), 100.0, 1e-3) || ! near(map.bpmAtPpq(7.0), 150.0, 1e-3) || ! near(map.bpmAtPpq(20.0), 75.0, 1e-3))
+            { std::cerr << "song: wrong tempos\n"; ++failures; }
+
+        // 6 quarters at 100 BPM, 6 at 150, then 75
+        const double at12 = 6 * 0.6 + 6 * 0.4;
+        if (! near(map.secondsAtPpq(12.0), at12, 1e-6) || ! near(map.secondsAtPpq(14.0), at12 + 1.6, 1e-6))
+            { std::cerr << "song: secondsAtPpq " << map.secondsAtPpq(12.0) << ", expected " << at12 << "\n"; ++failures; }
+
+        const auto& meter = map.meterAtPpq(6.5);
+        if (map.getMeterPoints().size() != 2 || meter.numerator != 7 || meter.denominator != 8 || ! near(meter.bar, 2.0))
+            { std::cerr << "song: expected 7/8 from bar 2\n"; ++failures; }
+        if (map.meterAtPpq(5.9).numerator != 3)
+            { std::cerr << "song: expected 3/4 before ppq 6\n"; ++failures; }
+        if (! near(map.ppqAtBar(1.0), 3.0) || ! near(map.ppqAtBar(4.0), 6.0 + 2 * 3.5))
+            { std::cerr << "song: ppqAtBar wrong\n"; ++failures; }
+        return failures;
+    }
+
+    int checkDefaultsAndFormats()
+    {
+        int failures = 0;
+        std::string error;
+
+        // No tempo events: 120 BPM 4/4
+        {
+            TrackWriter t;
+            t.noteOn(0, 60, false);
+            t.endOfTrack(96);
+            SmfWriter file;
+            file.header(0, 1, 96);
+            file.chunk("MTrk", t.w.bytes);
+            TempoMap map (90.0, 7);
+            if (! parse(file.bytes, map, error) || ! near(map.bpmAtPpq(3.0), 120.0) || map.meterAtPpq(3.0).numerator != 4)
+                { std::cerr << "defaults: expected 120 BPM 4/4 " << error << "\n"; ++failures; }
+        }
+
+        // Format 2: the first pattern's tempo only
+        {
+            TrackWriter a, b;
+            a.tempo(0, 90.0);
+            a.endOfTrack(0);
+            b.tempo(0, 180.0);
+            b.endOfTrack(0);
+            SmfWriter file;
+            file.header(2, 2, 96);
+            file.chunk("MTrk", a.w.bytes);
+            file.chunk("MTrk", b.w.bytes);
+            TempoMap map;
+            if (! parse(file.bytes, map, error) || ! near(map.bpmAtPpq(0.0), 90.0, 1e-3))
+                { std::cerr << "format 2: expected the first track's tempo " << error << "\n"; ++failures; }
+        }
+
+        // Same tick in two tracks: the later one in the file wins
+        {
+            TrackWriter a, b;
+            a.tempo(96, 90.0);
+            a.endOfTrack(0);
+            b.tempo(96, 110.0);
+            b.endOfTrack(0);
+            SmfWriter file;
+            file.header(1, 2, 96);
+            file.chunk("MTrk", a.w.bytes);
+            file.chunk("MTrk", b.w.bytes);
+            TempoMap map;
+            if (! parse(file.bytes, map, error) || ! near(map.bpmAtPpq(1.0), 110.0, 1e-3))
+                { std::cerr << "tie: expected the later tempo to win " << error << "\n"; ++failures; }
+        }
+        return failures;
+    }
+
+    int checkMalformed()
+    {
+        int failures = 0;
+        const std::string song = songFile();
+
+        auto expectFailure = [&failures] (const char* name, const std::string& bytes)
+        {
+            TempoMap map;
+            std::string error;
+            if (parse(bytes, map, error))
+                { std::cerr << "malformed (" << name << "): parsed without error\n"; ++failures; }
+            else if (error.empty())
+                { std::cerr << "malformed (" << name << "): no error message\n"; ++failures; }
+        };
+
+        expectFailure("empty", "");
+        expectFailure("not an SMF", "RIFF....WAVEfmt ");
+        for (size_t cut : { (size_t)10, (size_t)20, song.size() / 2, song.size() - 1 })
+            expectFailure("truncated", song.substr(0, cut));
+
+        SmfWriter smpte;
+        smpte.header(1, 0, 0xe728); // -25 fps, 40 ticks per frame
+        expectFailure("SMPTE division", smpte.bytes);
+
+        TrackWriter noStatus;
+        noStatus.noteOn(0, 60, true); // running status before any status byte
+        SmfWriter a;
+        a.header(0, 1, 96);
+        a.chunk("MTrk", noStatus.w.bytes);
+        expectFailure("running status unset", a.bytes);
+
+        SmfWriter b;
+        b.header(0, 1, 96);
+        b.chunk("MTrk", std::string("\xff\xff\xff\xff\x7f\x90\x3c\x40", 8)); // 5-byte delta time
+        expectFailure("delta time too long", b.bytes);
+
+        // An event running past its chunk
+        TrackWriter overrun;
+        overrun.text(0, "0123456789");
+        SmfWriter c;
+        c.header(0, 1, 96);
+        c.chunk("MTrk", overrun.w.bytes.substr(0, overrun.w.bytes.size() - 4));
+        c.bytes += "0123"; // the rest of the text follows the chunk
+        expectFailure("event past chunk end", c.bytes);
+        return failures;
+    }
+
+    // Lookups agree with walking the points one by one, and time and position convert back and forth
+    int checkLookups()
+    {
+        int failures = 0;
+        TempoMap map;
+        uint32_t seed = 12345;
+        auto random = [&seed] { seed = seed * 1664525u + 1013904223u; return (double)(seed >> 8) / (double)(1u << 24); };
+        for (int i = 1; i <= 200; ++i)
+            map.setTempo(i * 2.0 + random(), 40.0 + 200.0 * random());
+        map.setTempo(100.0, 60.0); // replaces or inserts mid-map; later points move in time
+
+        const auto& points = map.getTempoPoints();
+        for (int i = 0; i < 2000; ++i)
+        {
+            const double ppq = random() * 420.0;
+            double seconds = 0.0, at = 0.0;
+            for (size_t p = 0; p < points.size() && points[p].ppq <= ppq; ++p)
+            {
+                if (p > 0)
+                    seconds += (points[p].ppq - at) * points[p - 1].secondsPerQuarter;
+                at = points[p].ppq;
+                if (p + 1 == points.size() || points[p + 1].ppq > ppq)
+                    seconds += (ppq - at) * points[p].secondsPerQuarter;
+            }
+            if (! near(map.secondsAtPpq(ppq), seconds, 1e-7))
+                { std::cerr << "lookup: secondsAtPpq(" << ppq << ") " << map.secondsAtPpq(ppq) << ", walked " << seconds << "\n"; ++failures; break; }
+            if (! near(map.ppqAtSeconds(seconds), ppq, 1e-7))
+                { std::cerr << "lookup: ppqAtSeconds does not invert secondsAtPpq at " << ppq << "\n"; ++failures; break; }
+        }
+        return failures;
+    }
+
+    // Drift: a sequencer driven through a song with dozens of tempo changes (every other one on a beat),
+    // blocks split at each change as the offline transport does, clicks exactly where the map puts each subdivision (within the
+    // sample of rounding the timing engine allows anywhere)
+    int checkRenderAlongMap()
+    {
+        constexpr double sr = 48000.0;
+        constexpr int blockSize = 512, numerator = 4;
+        TempoMap map (120.0, numerator);
+        for (int i = 1; i < 48; ++i)
+            map.setTempo(i * 2.5, 70.0 + (i * 37) % 110);
+
+        Sequencer seq;
+        seq.prepare(sr, blockSize);
+        seq.setSubdivisionsPerBar(numerator);
+        SequencerParams params;
+        params.stepCount = 4;
+        HostTransportInfo host;
+        host.sampleRate = sr;
+        host.isPlaying = true;
+        host.timeSigNumerator = numerator;
+
+        const double endPpq = 130.0;
+        const auto totalSamples = (int64_t)std::llround(map.secondsAtPpq(endPpq) * sr);
+        std::vector<int64_t> clicks;
+        std::vector<float> out (blockSize);
+        double ppq = 0.0;
+        for (int64_t pos = 0; pos < totalSamples;)
+        {
+            const int n = (int)std::min<int64_t>(map.blockSamplesAt(map.secondsAtPpq(ppq), sr, blockSize), totalSamples - pos);
+
+            host.ppqPosition = ppq;
+            host.tempoBPM = map.bpmAtPpq(ppq);
+            const auto& block = seq.advance(host, params, n);
+            float* channels[1] = { out.data() };
+            seq.render(channels, 1, n, 0.8f);
+            if (block.gateSample >= 0)
+                clicks.push_back(pos + block.gateSample);
+
+            pos += n;
+            ppq = map.ppqAtSeconds((double)pos / sr);
+        }
+
+        int failures = 0;
+        // Play starts on the bar line, so the first click is the second beat (the sequencer's start rule)
+        if (clicks.size() != (size_t)endPpq - 1)
+            { std::cerr << "render along map: " << clicks.size() << " clicks, expected " << (size_t)endPpq - 1 << "\n"; return 1; }
+        double worst = 0.0;
+        for (size_t i = 0; i < clicks.size(); ++i)
+        {
+            const double expected = map.secondsAtPpq((double)(i + 1)) * sr;
+            worst = std::max(worst, std::abs((double)clicks[i] - expected));
+        }
+        if (worst > 1.0)
+            { std::cerr << "render along map: a click is " << worst << " samples from its position in the map\n"; ++failures; }
+        return failures;
+    }
+
+    // Meter changes: 3/4, then 4/4, then 6/8, with two subdivisions a bar. The transport reports the
+    // map's meter and last bar line as a host would (see OfflineTransport), and every click lands on the
+    // map's half bars with the map's bar numbers, not on bars counted in the current meter from ppq 0
+    int checkRenderAcrossMeters()
+    {
+        constexpr double sr = 48000.0;
+        constexpr int blockSize = 512;
+        TempoMap map (120.0, 3, 4);
+        map.setMeter(6.0, 4, 4);    // after two bars of 3/4
+        map.setMeter(14.0, 6, 8);   // after two bars of 4/4
+
+        Sequencer seq;
+        seq.prepare(sr, blockSize);
+        seq.setSubdivisionsPerBar(2);
+        SequencerParams params;
+        params.stepCount = 2;
+        HostTransportInfo host;
+        host.sampleRate = sr;
+
+        const double endPpq = 26.0; // four bars of 6/8
+        const auto totalSamples = (int64_t)std::llround(map.secondsAtPpq(endPpq) * sr);
+        struct Click { int64_t sample; int bar; };
+        std::vector<Click> clicks;
+        std::vector<float> out (blockSize);
+        for (int64_t pos = 0; pos < totalSamples; pos += blockSize)
+        {
+            const int n = (int)std::min<int64_t>(blockSize, totalSamples - pos);
+            HostPosition reading;
+            reading.isPlaying = true;
+            reading.ppqPosition = map.ppqAtSeconds((double)pos / sr);
+            reading.bpm = map.bpmAtPpq(reading.ppqPosition);
+            reading.timeSigNumerator = map.meterAtPpq(reading.ppqPosition).numerator;
+            reading.timeSigDenominator = map.meterAtPpq(reading.ppqPosition).denominator;
+            reading.hasLastBarStart = true;
+            reading.lastBarStartPpq = map.lastBarStartAtPpq(reading.ppqPosition, reading.barCount);
+            applyHostPosition(host, reading);
+
+            const auto& block = seq.advance(host, params, n);
+            float* channels[1] = { out.data() };
+            seq.render(channels, 1, n, 0.8f);
+            if (block.gateSample >= 0)
+                clicks.push_back({ pos + block.gateSample, block.gateBarIndex });
+        }
+
+        // Bars 0-1 in 3/4, 2-3 in 4/4, 4-7 in 6/8; play starts on the first bar line, which is skipped
+        const int numBars = 8;
+        if (clicks.size() != (size_t)(numBars * 2 - 1))
+            { std::cerr << "render across meters: " << clicks.size() << " clicks, expected " << numBars * 2 - 1 << "\n"; return 1; }
+        int failures = 0;
+        for (size_t i = 0; i < clicks.size(); ++i)
+        {
+            const double halfBars = (double)(i + 1) * 0.5;
+            const double expected = map.secondsAtPpq(map.ppqAtBar(halfBars)) * sr;
+            if (std::abs((double)clicks[i].sample - expected) > 1.0 || clicks[i].bar != (int)std::floor(halfBars))
+            {
+                std::cerr << "render across meters: click " << i << " at sample " << clicks[i].sample << " in bar " << clicks[i].bar
+                          << ", expected " << expected << " in bar " << (int)std::floor(halfBars) << "\n";
+                ++failures;
+            }
+        }
+        return failures;
+    }
+
+    // A long file full of note events parses in one pass at a rate far beyond any song's size
+    int checkLargeFile()
+    {
+        TrackWriter notes;
+        notes.tempo(0, 120.0);
+        notes.noteOn(0, 60, false);
+        for (int i = 0; i < 1000000; ++i)
+        {
+            notes.noteOn(12, 60 + i % 24, true);
+            if (i % 10000 == 0)
+            {
+                notes.tempo(0, 100.0 + i / 10000);
+                notes.noteOn(0, 60, false); // meta events cancel running status
+            }
+        }
+        notes.endOfTrack(0);
+        SmfWriter file;
+        file.header(0, 1, 480);
+        file.chunk("MTrk", notes.w.bytes);
+
+        TempoMap map;
+        std::string error;
+        const auto start = std::chrono::steady_clock::now();
+        const bool ok = parse(file.bytes, map, error);
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (! ok || map.getTempoPoints().size() != 101)
+            { std::cerr << "large file: " << (ok ? std::to_string(map.getTempoPoints().size()) + " tempo points, expected 101" : error) << "\n"; return 1; }
+        std::cout << "Parsed " << file.bytes.size() / 1024 << " KiB of MIDI events in " << ms << " ms\n";
+        return 0;
+    }
+}
+
+static int runTests()
+{
+    const int failures = checkParse() + checkDefaultsAndFormats() + checkMalformed() + checkLookups()
+                       + checkRenderAlongMap() + checkRenderAcrossMeters() + checkLargeFile();
+    if (failures == 0)
+        std::cout << "All TempoMap tests passed." << std::endl;
+    else
+        std::cout << failures << " TempoMap test(s) failed." << std::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+int main()
+{
+    return runTests();
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <cmath>
 #include <limits>
@@ -11,7 +12,10 @@ namespace metrog
         double tempoBPM = 120.0;              // Host tempo in BPM
         double ppqPosition = 0.0;             // Host musical position in quarter notes (can be fractional)
         bool isPlaying = false;               // Host transport is playing
-        int timeSigNumerator = 4;             // We assume quarter-note denominator per requirements
+        int timeSigNumerator = 4;             // Beats per bar...
+        int timeSigDenominator = 4;           // ...each a 1/denominator note, so a bar is numerator * 4 / denominator quarters
+        double barStartPpq = 0.0;             // A bar line at or before ppqPosition (the host's last bar start)...
+        int barStartIndex = 0;                // ...and its bar index: bars repeat from there, so a meter change moves later ones
         double sampleRate = 48000.0;          // Current sample rate
     };
 
@@ -35,6 +39,14 @@ namespace metrog
         void setSubdivisionsPerBar(int count) noexcept { subdivisionsPerBar = count > 0 ? count : 4; }
         int getSubdivisionsPerBar() const noexcept { return subdivisionsPerBar; }
 
+        // Length of the host's bar in quarter notes
+        static double quartersPerBar(const HostTransportInfo& host) noexcept
+        {
+            const int numerator = host.timeSigNumerator > 0 ? host.timeSigNumerator : 4;
+            const int denominator = host.timeSigDenominator > 0 ? host.timeSigDenominator : 4;
+            return static_cast<double>(numerator) * 4.0 / static_cast<double>(denominator);
+        }
+
         // Compute bar index and beat index (0-based) from PPQ.
         static void computeBarBeat(double ppqPosition, int timeSigNumerator, int& outBarIndex, int& outBeatInBar) noexcept
         {
@@ -50,9 +62,14 @@ namespace metrog
         // Compute equal subdivision index (0-based) within current bar.
         static int computeSubdivisionIndex(double ppqPosition, int timeSigNumerator, int subdivisionsPerBar) noexcept
         {
-            if (timeSigNumerator <= 0) timeSigNumerator = 4;
+            return subdivisionIndexInBar(ppqPosition, static_cast<double>(timeSigNumerator > 0 ? timeSigNumerator : 4), subdivisionsPerBar);
+        }
+
+        // The same for bars of any length, counted from a bar line at ppq 0 (callers pass the position
+        // relative to the host's bar line).
+        static int subdivisionIndexInBar(double ppqPosition, double beatsPerBar, int subdivisionsPerBar) noexcept
+        {
             if (subdivisionsPerBar <= 0) subdivisionsPerBar = 4;
-            const double beatsPerBar = static_cast<double>(timeSigNumerator);
             const double barPosBeats = std::fmod(std::max(ppqPosition, 0.0), beatsPerBar);
             if (barPosBeats < 0.0) return 0;
             const double frac = barPosBeats / beatsPerBar; // 0..1
@@ -72,11 +89,12 @@ namespace metrog
             const double secondsPerSample = 1.0 / sr;
             const double beatsPerSample = beatsPerSecond * secondsPerSample;
 
-            // Compute bar and subdivision at block start
-            int startBar = 0, startBeatInBar = 0;
-            computeBarBeat(host.ppqPosition, host.timeSigNumerator, startBar, startBeatInBar);
-            const double beatsPerBar = static_cast<double>(host.timeSigNumerator);
-            const double startBarBeats = host.ppqPosition - (startBar * beatsPerBar);
+            // Compute bar and subdivision at block start, counting bars from the host's bar line
+            const double beatsPerBar = quartersPerBar(host);
+            const double fromBarLine = host.ppqPosition - host.barStartPpq;
+            const int barsFromBarLine = std::max(0, static_cast<int>(std::floor(fromBarLine / beatsPerBar)));
+            const int startBar = host.barStartIndex + barsFromBarLine;
+            const double startBarBeats = fromBarLine - (barsFromBarLine * beatsPerBar);
 
             const double subLenBeats = beatsPerBar / static_cast<double>(subdivisionsPerBar);
             const double startSubIndexF = startBarBeats / subLenBeats; // fractional index
@@ -89,7 +107,7 @@ namespace metrog
             {
                 result.crosses = true;
                 result.firstCrossingSample = 0;
-                const int idxAtStart = computeSubdivisionIndex(host.ppqPosition, host.timeSigNumerator, subdivisionsPerBar);
+                const int idxAtStart = subdivisionIndexInBar(fromBarLine, beatsPerBar, subdivisionsPerBar);
                 result.subdivisionIndex = idxAtStart;
                 result.barIndex = startBar;
                 return result;
@@ -118,6 +136,41 @@ namespace metrog
             return result;
         }
 
+        // Position (ppq) of the subdivision boundary at or before ppqPosition; boundaries repeat every
+        // subdivision from the host's bar line, since a bar holds a whole number of them
+        double subdivisionStartPpq (const HostTransportInfo& host, double ppqPosition) const noexcept
+        {
+            const double subLenBeats = quartersPerBar(host) / static_cast<double>(subdivisionsPerBar);
+            return host.barStartPpq + std::floor(std::max(ppqPosition - host.barStartPpq, 0.0) / subLenBeats + 1e-9) * subLenBeats;
+        }
+
+        // Ratchets: a step starting at the subdivision boundary boundaryPpq repeats `count` times evenly
+        // across its subdivision. Writes the sample offsets of the repeats (not the step's own click at the
+        // boundary) that fall in [fromSample, toSample) of the block, in order, and returns how many. Each
+        // repeat's position is computed directly from its index, with the same sample rounding as a
+        // subdivision crossing, so they follow tempo changes and never accumulate error.
+        int findRatchetHits (const HostTransportInfo& host, double boundaryPpq, int count, int fromSample, int toSample,
+                             int* outSamples, int maxOut) const noexcept
+        {
+            if (count <= 1 || fromSample >= toSample || sr <= 0.0 || host.tempoBPM <= 0.0)
+                return 0;
+
+            const double beatsPerSample = host.tempoBPM / 60.0 / sr;
+            const double subLenBeats = quartersPerBar(host) / static_cast<double>(subdivisionsPerBar);
+            const double spacing = subLenBeats / static_cast<double>(count);
+            int found = 0;
+            for (int k = 1; k < count && found < maxOut; ++k)
+            {
+                const double beatsFromStart = boundaryPpq + k * spacing - host.ppqPosition;
+                const long long sample = static_cast<long long>(std::ceil(beatsFromStart / beatsPerSample - 1e-12));
+                if (sample >= toSample)
+                    break;
+                if (sample >= fromSample)
+                    outSamples[found++] = static_cast<int>(sample);
+            }
+            return found;
+        }
+
     private:
         double sr = 48000.0;
         int subdivisionsPerBar = 4;
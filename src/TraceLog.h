@@ -0,0 +1,206 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include "SpscRing.h"
+
+namespace metrog
+{
+    // One fixed-size record per traced processBlock (audio thread → TraceWriter thread).
+    struct TraceRecord
+    {
+        enum Flags : uint8_t
+        {
+            kPlaying            = 1 << 0,
+            kPlayStateChanged   = 1 << 1,
+            kCrossing           = 1 << 2,  // a subdivision boundary fell inside the block
+            kGate               = 1 << 3,  // ...and its step was enabled, so a click was triggered
+            kSuppressedBoundary = 1 << 4   // play started exactly on a bar line; first boundary skipped
+        };
+
+        uint64_t blockStartNs = 0;     // monotonicNanos() at callback entry
+        double ppq = 0.0;              // host PPQ at block start
+        double tempoBPM = 0.0;
+        int32_t numSamples = 0;
+        int32_t crossingSample = -1;   // first boundary sample offset, -1 if none
+        int32_t stepIndex = -1;        // step at the crossing (or current step when none)
+        int32_t globalIndex = -1;      // global subdivision counter at the crossing
+        int32_t barIndex = -1;
+        uint8_t flags = 0;
+        // Phase durations inside the callback
+        uint32_t midiNs = 0, transportNs = 0, crossingNs = 0, renderNs = 0;
+    };
+
+    using TraceRing = SpscRing<TraceRecord, 4096>;
+
+    namespace trace
+    {
+        // Locale-independent fixed-point formatting (hosts may change LC_NUMERIC under us)
+        inline void appendFixed (std::string& out, double value, int decimals)
+        {
+            if (value < 0.0) { out += '-'; value = -value; }
+            uint64_t scale = 1;
+            for (int i = 0; i < decimals; ++i) scale *= 10;
+            const uint64_t scaled = static_cast<uint64_t>(value * static_cast<double>(scale) + 0.5);
+            out += std::to_string(scaled / scale);
+            if (decimals > 0)
+            {
+                std::string frac = std::to_string(scaled % scale);
+                out += '.';
+                out.append(static_cast<size_t>(decimals) - frac.size(), '0');
+                out += frac;
+            }
+        }
+
+        inline void appendMicros (std::string& out, uint64_t ns)
+        {
+            out += std::to_string(ns / 1000);
+            out += '.';
+            const std::string frac = std::to_string(ns % 1000);
+            out.append(3 - frac.size(), '0');
+            out += frac;
+        }
+
+        inline void appendCompleteEvent (std::string& out, const char* name, uint64_t startNs, uint64_t durNs)
+        {
+            out += ",\n{\"name\":\"";
+            out += name;
+            out += "\",\"cat\":\"audio\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":";
+            appendMicros(out, startNs);
+            out += ",\"dur\":";
+            appendMicros(out, durNs);
+            out += '}';
+        }
+
+        // Appends the Chrome trace events for one record: the block and its phases as complete ("X")
+        // events, plus an instant ("i") event at the gate's sample position when a click fired.
+        inline void appendChromeEvents (std::string& out, const TraceRecord& r, double sampleRate)
+        {
+            const uint64_t total = uint64_t(r.midiNs) + r.transportNs + r.crossingNs + r.renderNs;
+            out += ",\n{\"name\":\"processBlock\",\"cat\":\"audio\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":";
+            appendMicros(out, r.blockStartNs);
+            out += ",\"dur\":";
+            appendMicros(out, total);
+            out += ",\"args\":{\"ppq\":";
+            appendFixed(out, r.ppq, 6);
+            out += ",\"bpm\":";
+            appendFixed(out, r.tempoBPM, 3);
+            out += ",\"samples\":" + std::to_string(r.numSamples);
+            out += ",\"crossingSample\":" + std::to_string(r.crossingSample);
+            out += ",\"step\":" + std::to_string(r.stepIndex);
+            out += ",\"global\":" + std::to_string(r.globalIndex);
+            out += ",\"bar\":" + std::to_string(r.barIndex);
+            out += ",\"playing\":" + std::string((r.flags & TraceRecord::kPlaying) ? "true" : "false");
+            out += ",\"playStateChanged\":" + std::string((r.flags & TraceRecord::kPlayStateChanged) ? "true" : "false");
+            out += ",\"gate\":" + std::string((r.flags & TraceRecord::kGate) ? "true" : "false");
+            out += ",\"suppressedBoundary\":" + std::string((r.flags & TraceRecord::kSuppressedBoundary) ? "true" : "false");
+            out += "}}";
+
+            uint64_t t = r.blockStartNs;
+            appendCompleteEvent(out, "midi", t, r.midiNs);          t += r.midiNs;
+            appendCompleteEvent(out, "transport", t, r.transportNs); t += r.transportNs;
+            appendCompleteEvent(out, "crossing", t, r.crossingNs);   t += r.crossingNs;
+            appendCompleteEvent(out, "render", t, r.renderNs);
+
+            if ((r.flags & TraceRecord::kCrossing) != 0 && r.crossingSample >= 0 && sampleRate > 0.0)
+            {
+                // Place the boundary at its audio-timeline position within the block
+                const uint64_t offsetNs = static_cast<uint64_t>(static_cast<double>(r.crossingSample) * 1.0e9 / sampleRate);
+                out += ",\n{\"name\":\"";
+                out += (r.flags & TraceRecord::kGate) ? "gate" : "boundary (step off)";
+                out += "\",\"cat\":\"sequencer\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":2,\"ts\":";
+                appendMicros(out, r.blockStartNs + offsetNs);
+                out += ",\"args\":{\"step\":" + std::to_string(r.stepIndex);
+                out += ",\"bar\":" + std::to_string(r.barIndex);
+                out += ",\"sample\":" + std::to_string(r.crossingSample) + "}}";
+            }
+        }
+    }
+
+    // Background thread that drains a TraceRing into a Chrome trace-event JSON file
+    // (load it in chrome://tracing or https://ui.perfetto.dev). start/stop from the message thread.
+    class TraceWriter
+    {
+    public:
+        ~TraceWriter() { stop(); }
+
+        bool start (TraceRing& ringToDrain, const std::string& path, double sampleRateForEvents)
+        {
+            stop();
+            file.open(path, std::ios::out | std::ios::trunc);
+            if (! file.is_open())
+                return false;
+
+            // Discard records left over from a previous session (the producer is idle while not tracing)
+            TraceRecord stale;
+            while (ringToDrain.pop(stale)) {}
+
+            ring = &ringToDrain;
+            sampleRate.store(sampleRateForEvents);
+            file << "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"MetroGnome\"}}";
+            running.store(true);
+            worker = std::thread([this] { run(); });
+            return true;
+        }
+
+        // Drains whatever is left, terminates the JSON array and closes the file
+        void stop()
+        {
+            if (! running.exchange(false))
+                return;
+            if (worker.joinable())
+                worker.join();
+            drain();
+            file << "\n]\n";
+            file.close();
+            ring = nullptr;
+        }
+
+        bool isRunning() const noexcept { return running.load(); }
+        void setSampleRate (double sr) noexcept { sampleRate.store(sr); }
+        uint64_t getRecordsWritten() const noexcept { return recordsWritten.load(); }
+
+    private:
+        void run()
+        {
+            while (running.load())
+            {
+                drain();
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        }
+
+        void drain()
+        {
+            TraceRecord r;
+            std::string chunk;
+            const double sr = sampleRate.load();
+            while (ring != nullptr && ring->pop(r))
+            {
+                trace::appendChromeEvents(chunk, r, sr);
+                recordsWritten.fetch_add(1);
+                if (chunk.size() > 64 * 1024)
+                {
+                    file << chunk;
+                    chunk.clear();
+                }
+            }
+            if (! chunk.empty())
+            {
+                file << chunk;
+                file.flush();
+            }
+        }
+
+        TraceRing* ring = nullptr;
+        std::ofstream file;
+        std::thread worker;
+        std::atomic<bool> running { false };
+        std::atomic<double> sampleRate { 48000.0 };
+        std::atomic<uint64_t> recordsWritten { 0 };
+    };
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+namespace metrog
+{
+    // Wait-free single-writer/single-reader handoff of the latest value of a trivially copyable type.
+    // The writer fills its private slot and swaps it with the shared middle slot; the reader swaps the
+    // middle slot for its own when a new value is flagged. Neither side ever waits for the other or
+    // touches a slot the other owns, which a two-slot buffer cannot guarantee without the writer
+    // waiting for the reader to let go. Values published faster than the reader takes them coalesce
+    // (only the latest is seen). Storage is inline; no allocation.
+    template <typename T>
+    class TripleBuffer
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "TripleBuffer values must be trivially copyable");
+        static constexpr uint8_t kIndexMask = 0x3;
+        static constexpr uint8_t kFresh = 0x4; // middle slot holds a value the reader hasn't taken
+
+    public:
+        // Writer side (one thread only)
+        void publish (const T& value) noexcept
+        {
+            slots[writeSlot] = value;
+            writeSlot = static_cast<uint8_t>(middle.exchange(static_cast<uint8_t>(writeSlot | kFresh), std::memory_order_acq_rel) & kIndexMask);
+        }
+
+        // Reader side (one thread only): whether take() would find a new value
+        bool hasNew() const noexcept { return (middle.load(std::memory_order_relaxed) & kFresh) != 0; }
+
+        // Reader side (one thread only): copies the latest published value into out; false if nothing new
+        bool take (T& out) noexcept
+        {
+            if ((middle.load(std::memory_order_relaxed) & kFresh) == 0)
+                return false;
+
+            readSlot = static_cast<uint8_t>(middle.exchange(readSlot, std::memory_order_acq_rel) & kIndexMask);
+            out = slots[readSlot];
+            return true;
+        }
+
+    private:
+        std::array<T, 3> slots{};
+        alignas(64) uint8_t writeSlot = 0;             // writer-owned
+        alignas(64) std::atomic<uint8_t> middle { 1 }; // shared: index | kFresh
+        alignas(64) uint8_t readSlot = 2;              // reader-owned
+    };
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "StepMask.h"
+
+namespace metrog
+{
+    // Playhead and pattern state as processed by one block, published through a SeqLock so a reader
+    // never mixes fields from different blocks.
+    struct UiSnapshot
+    {
+        uint32_t generation = 0;   // changes whenever currentStep or danceParity does
+        StepMask stepMask;         // enabled steps (after enable/disable-all)
+        double tempoBPM = 120.0;
+        double ppqPosition = 0.0;  // host position at the end of the block...
+        uint64_t timeNs = 0;       // ...and the monotonicNanos() time it corresponds to
+        float beatsPerBar = 4.0f;  // bar length in quarters (host meter)
+        float barPpq = -1.0f;      // quarters from the host's last bar line to ppqPosition; negative = bars from ppq 0
+        int16_t stepCount = 8;
+        int16_t currentStep = -1;  // -1 before the first block
+        int16_t subdivisionsPerBar = 8;
+        uint8_t danceParity = 0;
+        uint8_t playing = 0;
+    };
+
+    static_assert(sizeof(UiSnapshot) <= 64, "UiSnapshot must fit in one cache line");
+
+    // One click, as the editor should flash it: pushed by the audio thread for every click (gates, ratchet
+    // repeats and lane clicks), stamped with the monotonicNanos() time it is expected to leave the speakers
+    struct GateEvent
+    {
+        static constexpr int16_t kMainLane = -1;
+
+        uint64_t audibleNs = 0;
+        int32_t barIndex = 0;
+        int16_t stepIndex = 0;
+        int16_t lane = kMainLane;   // or the polymetric lane's index (its step, not a main step)
+    };
+
+    // Playhead position at nowNs, extrapolated from the snapshot at its tempo. Stopped transports don't move.
+    inline double extrapolatePpq (const UiSnapshot& s, uint64_t nowNs) noexcept
+    {
+        if (s.playing == 0)
+            return s.ppqPosition;
+
+        const double elapsedSeconds = nowNs >= s.timeNs ? (double)(nowNs - s.timeNs) * 1.0e-9
+                                                        : -(double)(s.timeNs - nowNs) * 1.0e-9;
+        return s.ppqPosition + elapsedSeconds * s.tempoBPM / 60.0;
+    }
+
+    // How far (0..1) ppq is through the subdivision the snapshot ended in, i.e. the one currentStep
+    // belongs to. Clamped, so a frame that runs ahead of the next block holds at 1 instead of
+    // wrapping before the audio thread has actually moved to the next step.
+    inline double subdivisionProgress (const UiSnapshot& s, double ppq) noexcept
+    {
+        const double beatsPerBar = s.beatsPerBar > 0.0f ? (double)s.beatsPerBar : 4.0;
+        const double subLenBeats = beatsPerBar / (double)(s.subdivisionsPerBar > 0 ? s.subdivisionsPerBar : 4);
+        const double base = std::max(s.ppqPosition, 0.0);
+        const double barStart = s.barPpq >= 0.0f ? s.ppqPosition - (double)s.barPpq
+                                                 : std::floor(base / beatsPerBar) * beatsPerBar;
+        const double subStart = barStart + std::floor((base - barStart) / subLenBeats + 1e-9) * subLenBeats;
+        return std::clamp((ppq - subStart) / subLenBeats, 0.0, 1.0);
+    }
+}